@@ -0,0 +1,174 @@
+// Barriers and barrier commands RenderGraph records per frame, and the CPU time execute() takes, with
+//  vkCmdPipelineBarrier and with vkCmdPipelineBarrier2. Counted by bench/NullVulkan.cpp, which
+//  records nothing, so the time is the graph's own.
+//  BarrierBench [frame count, defaults to 100000]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "BenchUtils.h"
+#include "NullVulkan.h"
+#include "RenderGraph.h"
+#include "VulkanDevices.h"
+
+namespace
+{
+	const uint32_t kRepeatCount = 5;
+	const VkExtent2D kExtent = { 1920, 1080 };
+
+	void recordNothing(VkCommandBuffer, RenderGraph::PassContext const &)
+	{
+	}
+
+	RenderGraph::ImageDesc makeImageDesc(VkFormat format, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT)
+	{
+		RenderGraph::ImageDesc desc{};
+		desc.format = format;
+		desc.extent = kExtent;
+		desc.aspect = aspect;
+		return desc;
+	}
+
+	uint32_t importSwapChain(RenderGraph &renderGraph)
+	{
+		uint32_t swapChain = renderGraph.importImage(
+			"swap chain", makeImageDesc(VK_FORMAT_B8G8R8A8_SRGB), ResourceUsage::Present, ResourceUsage::Present, false);
+		renderGraph.setImportedImage(swapChain, nullVulkan::makeHandle<VkImage>(), nullVulkan::makeHandle<VkImageView>());
+		return swapChain;
+	}
+
+	// main.cpp's graph with GPU culling: reset the draw count, cull, draw indirect into the swap chain
+	void declareSceneGraph(RenderGraph &renderGraph)
+	{
+		uint32_t swapChain = importSwapChain(renderGraph);
+		uint32_t depth = renderGraph.createImage("depth", makeImageDesc(VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT));
+
+		uint32_t drawBuffer = renderGraph.importBuffer("draws", ResourceUsage::IndirectCommandRead, ResourceUsage::IndirectCommandRead);
+		uint32_t countBuffer = renderGraph.importBuffer("draw count", ResourceUsage::IndirectCommandRead, ResourceUsage::IndirectCommandRead);
+		renderGraph.setImportedBuffer(drawBuffer, nullVulkan::makeHandle<VkBuffer>());
+		renderGraph.setImportedBuffer(countBuffer, nullVulkan::makeHandle<VkBuffer>());
+
+		uint32_t resetPass = renderGraph.addPass("reset draw count", RenderGraph::PassType::Transfer, recordNothing);
+		renderGraph.use(resetPass, countBuffer, ResourceUsage::TransferDst);
+
+		uint32_t cullPass = renderGraph.addPass("cull", RenderGraph::PassType::Compute, recordNothing);
+		renderGraph.use(cullPass, drawBuffer, ResourceUsage::ComputeShaderStorageWrite);
+		renderGraph.use(cullPass, countBuffer, ResourceUsage::ComputeShaderStorageWrite);
+
+		uint32_t scenePass = renderGraph.addPass("scene", RenderGraph::PassType::Graphics, recordNothing);
+		renderGraph.writeColor(scenePass, swapChain, VkClearColorValue{ { 0.0f, 0.0f, 0.0f, 1.0f } });
+		renderGraph.writeDepth(scenePass, depth, VkClearDepthStencilValue{ 1.0f, 0 });
+		renderGraph.use(scenePass, drawBuffer, ResourceUsage::IndirectCommandRead);
+		renderGraph.use(scenePass, countBuffer, ResourceUsage::IndirectCommandRead);
+	}
+
+	// A deferred frame, for a graph with more passes and more kinds of reads than the renderer's
+	void declareDeferredGraph(RenderGraph &renderGraph)
+	{
+		uint32_t swapChain = importSwapChain(renderGraph);
+
+		uint32_t shadowMap = renderGraph.createImage("shadow map", makeImageDesc(VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT));
+		uint32_t depth = renderGraph.createImage("depth", makeImageDesc(VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT));
+		uint32_t albedo = renderGraph.createImage("albedo", makeImageDesc(VK_FORMAT_R8G8B8A8_SRGB));
+		uint32_t normals = renderGraph.createImage("normals", makeImageDesc(VK_FORMAT_R16G16B16A16_SFLOAT));
+		uint32_t occlusion = renderGraph.createImage("occlusion", makeImageDesc(VK_FORMAT_R8G8B8A8_UNORM));
+		uint32_t hdr = renderGraph.createImage("hdr", makeImageDesc(VK_FORMAT_R16G16B16A16_SFLOAT));
+		uint32_t bloom = renderGraph.createImage("bloom", makeImageDesc(VK_FORMAT_R16G16B16A16_SFLOAT));
+
+		uint32_t shadowPass = renderGraph.addPass("shadows", RenderGraph::PassType::Graphics, recordNothing);
+		renderGraph.writeDepth(shadowPass, shadowMap, VkClearDepthStencilValue{ 1.0f, 0 });
+
+		uint32_t geometryPass = renderGraph.addPass("geometry", RenderGraph::PassType::Graphics, recordNothing);
+		renderGraph.writeColor(geometryPass, albedo, VkClearColorValue{});
+		renderGraph.writeColor(geometryPass, normals, VkClearColorValue{});
+		renderGraph.writeDepth(geometryPass, depth, VkClearDepthStencilValue{ 1.0f, 0 });
+
+		uint32_t occlusionPass = renderGraph.addPass("occlusion", RenderGraph::PassType::Compute, recordNothing);
+		renderGraph.use(occlusionPass, depth, ResourceUsage::ComputeShaderSampled);
+		renderGraph.use(occlusionPass, normals, ResourceUsage::ComputeShaderSampled);
+		renderGraph.use(occlusionPass, occlusion, ResourceUsage::ComputeShaderStorageWrite);
+
+		uint32_t lightingPass = renderGraph.addPass("lighting", RenderGraph::PassType::Graphics, recordNothing);
+		renderGraph.writeColor(lightingPass, hdr, VkClearColorValue{});
+		renderGraph.readDepth(lightingPass, depth);
+		renderGraph.use(lightingPass, albedo, ResourceUsage::FragmentShaderSampled);
+		renderGraph.use(lightingPass, normals, ResourceUsage::FragmentShaderSampled);
+		renderGraph.use(lightingPass, occlusion, ResourceUsage::FragmentShaderSampled);
+		renderGraph.use(lightingPass, shadowMap, ResourceUsage::FragmentShaderSampled);
+
+		uint32_t bloomPass = renderGraph.addPass("bloom", RenderGraph::PassType::Compute, recordNothing);
+		renderGraph.use(bloomPass, hdr, ResourceUsage::ComputeShaderSampled);
+		renderGraph.use(bloomPass, bloom, ResourceUsage::ComputeShaderStorageWrite);
+
+		uint32_t tonemapPass = renderGraph.addPass("tonemap", RenderGraph::PassType::Graphics, recordNothing);
+		renderGraph.writeColor(tonemapPass, swapChain);
+		renderGraph.use(tonemapPass, hdr, ResourceUsage::FragmentShaderSampled);
+		renderGraph.use(tonemapPass, bloom, ResourceUsage::FragmentShaderSampled);
+	}
+
+	void measure(
+		char const *name,
+		void (*declareGraph)(RenderGraph &),
+		VkPhysicalDevice physicalDevice,
+		VkDevice device,
+		VulkanDeviceFeatures const &deviceFeatures,
+		bool useSynchronization2,
+		uint32_t frameCount )
+	{
+		RenderGraph renderGraph;
+		renderGraph.lazyInit(physicalDevice, device);
+		if (useSynchronization2) {
+			renderGraph.useSynchronization2(deviceFeatures);
+		}
+
+		declareGraph(renderGraph);
+		renderGraph.compile();
+
+		VkCommandBuffer commandBuffer = nullVulkan::makeHandle<VkCommandBuffer>();
+
+		// Counted again every run, so what is printed is one run's worth
+		double bestMs = benchUtils::bestOf(kRepeatCount, [&]() {
+			nullVulkan::resetCounts();
+
+			benchUtils::Clock::time_point start = benchUtils::Clock::now();
+			for (uint32_t frame = 0; frame < frameCount; ++frame) {
+				renderGraph.execute(commandBuffer);
+			}
+			return benchUtils::millisecondsSince(start);
+		});
+
+		nullVulkan::Counts const &counts = nullVulkan::getCounts();
+		std::printf("%10s %24s %10.1f %10.1f %12.1f\n",
+			name,
+			renderGraph.usesSynchronization2() ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier",
+			static_cast<double>(counts.barrierCommands) / frameCount,
+			static_cast<double>(counts.barriers) / frameCount,
+			bestMs * 1.0e6 / frameCount);
+
+		renderGraph.cleanUp();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frameCount = 100000;
+	if (argc > 1) {
+		frameCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	VkPhysicalDevice physicalDevice = nullVulkan::makeHandle<VkPhysicalDevice>();
+	VkDevice device = nullVulkan::makeHandle<VkDevice>();
+
+	VulkanDeviceFeatures deviceFeatures;
+	deviceFeatures.query(nullVulkan::makeHandle<VkInstance>(), physicalDevice, VK_API_VERSION_1_3);
+
+	std::printf("Per frame over %u frames, best of %u\n\n", frameCount, kRepeatCount);
+	std::printf("%10s %24s %10s %10s %12s\n", "graph", "recorded with", "commands", "barriers", "execute ns");
+
+	for (bool useSynchronization2 : { false, true }) {
+		measure("scene", declareSceneGraph, physicalDevice, device, deviceFeatures, useSynchronization2, frameCount);
+		measure("deferred", declareDeferredGraph, physicalDevice, device, deviceFeatures, useSynchronization2, frameCount);
+	}
+
+	return 0;
+}
\ No newline at end of file
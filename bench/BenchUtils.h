@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Timing shared by the benchmarks. Every number they print is the best of a few runs, the fastest
+ *  run being the one the rest of the machine got in the way of least. Nothing in here needs Vulkan,
+ *  the CPU only benchmarks use it too.
+ */
+namespace benchUtils
+{
+	using Clock = std::chrono::steady_clock;
+
+	inline double millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// fn(run) if it wants to know which run it is, fn() otherwise
+	template<typename Fn>
+	decltype(auto) callRun(Fn &fn, uint32_t run)
+	{
+		if constexpr (std::is_invocable_v<Fn &, uint32_t>) {
+			return fn(run);
+		} else {
+			return fn();
+		}
+	}
+
+	// Smallest of what runCount runs of fn return, for runs that only time part of what they do
+	template<typename Fn>
+	double bestOf(uint32_t runCount, Fn fn)
+	{
+		double best = 0.0;
+
+		for (uint32_t run = 0; run < runCount; ++run) {
+			double result = callRun(fn, run);
+
+			if (run == 0 || result < best) {
+				best = result;
+			}
+		}
+
+		return best;
+	}
+
+	// Best of runCount runs of fn, all of it timed
+	template<typename Fn>
+	double bestMilliseconds(uint32_t runCount, Fn fn)
+	{
+		return bestOf(runCount, [&fn](uint32_t run) {
+			Clock::time_point start = Clock::now();
+			callRun(fn, run);
+			return millisecondsSince(start);
+		});
+	}
+}
+
+#endif // BENCH_UTILS_H
\ No newline at end of file
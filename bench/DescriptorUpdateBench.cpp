@@ -0,0 +1,131 @@
+// CPU cost of DescriptorUpdateTemplate::update with an update template, against the 1.0 path that
+//  builds a VkWriteDescriptorSet per descriptor. Both end in bench/NullVulkan.cpp, which reads every
+//  descriptor info the way a driver copying them into the set would, and nothing more.
+//  DescriptorUpdateBench [set count, defaults to 10000]
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "DescriptorUpdateTemplate.h"
+#include "NullVulkan.h"
+#include "VulkanDevices.h"
+
+namespace
+{
+	const uint32_t kRepeatCount = 5;
+	const uint32_t kMaterialTextureCount = 8;
+
+	// Set 0 of the scene shaders, laid out like main.cpp's SceneDescriptors
+	struct SceneDescriptors
+	{
+		VkDescriptorBufferInfo ubo;
+		VkDescriptorImageInfo texture;
+	};
+
+	// A heavier set: a material's parameters and its array of textures
+	struct MaterialDescriptors
+	{
+		VkDescriptorBufferInfo parameters;
+		VkDescriptorImageInfo textures[kMaterialTextureCount];
+	};
+
+	std::vector<DescriptorUpdateTemplate::Entry> getSceneEntries()
+	{
+		std::vector<DescriptorUpdateTemplate::Entry> entries(2);
+
+		entries[0].binding = 0;
+		entries[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		entries[0].offset = offsetof(SceneDescriptors, ubo);
+
+		entries[1].binding = 1;
+		entries[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		entries[1].offset = offsetof(SceneDescriptors, texture);
+
+		return entries;
+	}
+
+	std::vector<DescriptorUpdateTemplate::Entry> getMaterialEntries()
+	{
+		std::vector<DescriptorUpdateTemplate::Entry> entries(2);
+
+		entries[0].binding = 0;
+		entries[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		entries[0].offset = offsetof(MaterialDescriptors, parameters);
+
+		entries[1].binding = 1;
+		entries[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		entries[1].offset = offsetof(MaterialDescriptors, textures);
+		entries[1].count = kMaterialTextureCount;
+		entries[1].stride = sizeof(VkDescriptorImageInfo);
+
+		return entries;
+	}
+
+	// Nanoseconds per set, best of kRepeatCount passes over all of them
+	template<typename Descriptors>
+	double measure(
+		VkDevice device,
+		VulkanDeviceFeatures const &deviceFeatures,
+		std::vector<DescriptorUpdateTemplate::Entry> const &entries,
+		std::vector<Descriptors> const &descriptors,
+		bool useTemplate )
+	{
+		DescriptorUpdateTemplate update;
+		update.lazyInit(device, deviceFeatures, nullVulkan::makeHandle<VkDescriptorSetLayout>(), entries, useTemplate);
+
+		std::vector<VkDescriptorSet> sets = nullVulkan::makeHandles<VkDescriptorSet>(static_cast<uint32_t>(descriptors.size()));
+
+		double bestMs = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+			for (size_t set = 0; set < sets.size(); ++set) {
+				update.update(sets[set], &descriptors[set]);
+			}
+		});
+
+		update.cleanUp();
+
+		return bestMs * 1.0e6 / sets.size();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t setCount = 10000;
+	if (argc > 1) {
+		setCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	VkDevice device = nullVulkan::makeHandle<VkDevice>();
+
+	VulkanDeviceFeatures deviceFeatures;
+	deviceFeatures.query(nullVulkan::makeHandle<VkInstance>(), nullVulkan::makeHandle<VkPhysicalDevice>(), VK_API_VERSION_1_3);
+
+	std::vector<SceneDescriptors> sceneDescriptors(setCount);
+	std::vector<MaterialDescriptors> materialDescriptors(setCount);
+
+	for (uint32_t set = 0; set < setCount; ++set) {
+		sceneDescriptors[set].ubo = { nullVulkan::makeHandle<VkBuffer>(), 0, 192 };
+		sceneDescriptors[set].texture = {
+			nullVulkan::makeHandle<VkSampler>(), nullVulkan::makeHandle<VkImageView>(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+		materialDescriptors[set].parameters = { nullVulkan::makeHandle<VkBuffer>(), 0, 256 };
+		for (VkDescriptorImageInfo &texture : materialDescriptors[set].textures) {
+			texture = {
+				nullVulkan::makeHandle<VkSampler>(), nullVulkan::makeHandle<VkImageView>(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		}
+	}
+
+	std::printf("%u sets each, ns per set, best of %u\n\n", setCount, kRepeatCount);
+	std::printf("%10s %12s %10s %10s\n", "set", "descriptors", "writes", "template");
+
+	std::printf("%10s %12u %10.1f %10.1f\n", "scene", 2u,
+		measure(device, deviceFeatures, getSceneEntries(), sceneDescriptors, false),
+		measure(device, deviceFeatures, getSceneEntries(), sceneDescriptors, true));
+	std::printf("%10s %12u %10.1f %10.1f\n", "material", 1 + kMaterialTextureCount,
+		measure(device, deviceFeatures, getMaterialEntries(), materialDescriptors, false),
+		measure(device, deviceFeatures, getMaterialEntries(), materialDescriptors, true));
+
+	return 0;
+}
\ No newline at end of file
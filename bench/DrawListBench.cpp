@@ -0,0 +1,132 @@
+// Cost of DrawList::sort and DrawList::record, and the binds sorting saves, on the CPU only.
+//  DrawListBench [worker count for the parallel sort, defaults to one per hardware thread less one]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "DrawList.h"
+#include "JobSystem.h"
+#include "NullVulkan.h"
+
+namespace
+{
+	const uint32_t kDrawCounts[] = { 10000, 25000, 50000, 100000 };
+	const uint32_t kPipelineCount = 16;
+	const uint32_t kMaterialCount = 256;
+	const uint32_t kMeshCount = 64;
+	const uint32_t kRepeatCount = 5;
+
+	// Draws in the order a scene traversal would find them, i.e. with no regard for their state
+	std::vector<DrawItem> makeScene(uint32_t drawCount)
+	{
+		static std::vector<VkPipeline> const pipelines = nullVulkan::makeHandles<VkPipeline>(kPipelineCount);
+		static std::vector<VkPipelineLayout> const pipelineLayouts = nullVulkan::makeHandles<VkPipelineLayout>(kPipelineCount);
+		static std::vector<VkDescriptorSet> const descriptorSets = nullVulkan::makeHandles<VkDescriptorSet>(kMaterialCount);
+		static std::vector<VkBuffer> const vertexBuffers = nullVulkan::makeHandles<VkBuffer>(kMeshCount);
+		static std::vector<VkBuffer> const indexBuffers = nullVulkan::makeHandles<VkBuffer>(kMeshCount);
+
+		std::mt19937 random(drawCount);
+		std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+
+		std::vector<DrawItem> draws(drawCount);
+
+		for (uint32_t i = 0; i < drawCount; ++i) {
+			uint32_t material = random() % kMaterialCount;
+			uint32_t pipeline = material % kPipelineCount;
+			uint32_t mesh = random() % kMeshCount;
+
+			DrawItem &draw = draws[i];
+			draw.sortKey = DrawList::makeSortKey(0, pipeline, material, DrawList::getDepthBucket(depth(random), 0.1f, 1000.0f));
+			draw.pipeline = pipelines[pipeline];
+			draw.pipelineLayout = pipelineLayouts[0];
+			draw.descriptorSet = descriptorSets[material];
+			draw.vertexBuffer = vertexBuffers[mesh];
+			draw.indexBuffer = indexBuffers[mesh];
+			draw.drawData.model[3][0] = static_cast<float>(i);
+			draw.drawData.materialIndex = material;
+			draw.indexCount = 36;
+		}
+
+		return draws;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	if (argc > 1) {
+		workerCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	JobSystem jobSystem;
+	jobSystem.lazyInit(workerCount);
+
+	PerDrawDataBinder drawDataBinder;
+	drawDataBinder.setPushConstantRange({ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PerDrawData) });
+
+	VkCommandBuffer commandBuffer = nullVulkan::makeHandle<VkCommandBuffer>();
+
+	std::printf("%u pipelines, %u materials, %u meshes, %u job system workers\n\n",
+		kPipelineCount, kMaterialCount, kMeshCount, workerCount);
+	std::printf("%7s %8s %8s %10s %13s %12s %16s %14s\n",
+		"draws", "add ms", "sort ms", "jobs sort", "record ms", "sorted rec", "binds unsorted", "binds sorted");
+
+	for (uint32_t drawCount : kDrawCounts) {
+		std::vector<DrawItem> const scene = makeScene(drawCount);
+		DrawList drawList;
+
+		auto addAll = [&]() {
+			drawList.clear();
+			for (DrawItem const &draw : scene) {
+				drawList.add(draw);
+			}
+		};
+
+		double addMs = benchUtils::bestMilliseconds(kRepeatCount, addAll);
+
+		// Every run sorts the draws in the order they were added, not what the run before sorted
+		auto sortAll = [&](JobSystem *pJobSystem) {
+			addAll();
+
+			benchUtils::Clock::time_point start = benchUtils::Clock::now();
+			drawList.sort(pJobSystem);
+			return benchUtils::millisecondsSince(start);
+		};
+
+		double sortMs = benchUtils::bestOf(kRepeatCount, [&]() { return sortAll(nullptr); });
+		double jobSortMs = benchUtils::bestOf(kRepeatCount, [&]() { return sortAll(&jobSystem); });
+
+		// In the order they were added, as if there was no sort
+		auto recordAll = [&](bool sorted) {
+			addAll();
+			if (sorted) {
+				drawList.sort(&jobSystem);
+			}
+
+			benchUtils::Clock::time_point start = benchUtils::Clock::now();
+			nullVulkan::resetCounts();
+			drawList.record(commandBuffer, 0, drawList.size(), drawDataBinder);
+			return benchUtils::millisecondsSince(start);
+		};
+
+		// The same binds every run
+		double unsortedMs = benchUtils::bestOf(kRepeatCount, [&]() { return recordAll(false); });
+		uint64_t unsortedBinds = nullVulkan::getCounts().binds;
+
+		double sortedMs = benchUtils::bestOf(kRepeatCount, [&]() { return recordAll(true); });
+		uint64_t sortedBinds = nullVulkan::getCounts().binds;
+
+		std::printf("%7u %8.2f %8.2f %10.2f %13.2f %12.2f %16llu %14llu\n",
+			drawCount, addMs, sortMs, jobSortMs, unsortedMs, sortedMs,
+			static_cast<unsigned long long>(unsortedBinds), static_cast<unsigned long long>(sortedBinds));
+	}
+
+	std::printf("\nBinds count pipelines, descriptor sets, vertex and index buffers and push constants.\n");
+
+	jobSystem.cleanUp();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+// CPU time FrameCommandRecorder takes to record a frame, against draw count and secondary count.
+//  FrameRecordBench [job system worker count, defaults to one per hardware thread less one]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "DrawList.h"
+#include "FrameCommandRecorder.h"
+#include "JobSystem.h"
+#include "NullVulkan.h"
+
+namespace
+{
+	const uint32_t kDrawCounts[] = { 1000, 10000, 50000, 100000 };
+	const uint32_t kSecondaryCounts[] = { 1, 2, 4, 8 };
+	const uint32_t kFramesInFlight = 2;
+	const uint32_t kFrameCount = 10;
+	const uint32_t kMaterialCount = 256;
+	const uint32_t kMeshCount = 64;
+
+	// Sorted, the way the renderer records them
+	void fillDrawList(DrawList &drawList, uint32_t drawCount, JobSystem &jobSystem)
+	{
+		std::vector<VkPipeline> pipelines = nullVulkan::makeHandles<VkPipeline>(4);
+		std::vector<VkDescriptorSet> descriptorSets = nullVulkan::makeHandles<VkDescriptorSet>(kMaterialCount);
+		std::vector<VkBuffer> buffers = nullVulkan::makeHandles<VkBuffer>(kMeshCount);
+
+		VkPipelineLayout pipelineLayout = nullVulkan::makeHandle<VkPipelineLayout>();
+		std::mt19937 random(drawCount);
+
+		drawList.clear();
+
+		for (uint32_t i = 0; i < drawCount; ++i) {
+			uint32_t material = random() % kMaterialCount;
+			uint32_t pipeline = material % pipelines.size();
+			uint32_t mesh = random() % kMeshCount;
+
+			DrawItem draw;
+			draw.sortKey = DrawList::makeSortKey(0, pipeline, material, static_cast<uint16_t>(random()));
+			draw.pipeline = pipelines[pipeline];
+			draw.pipelineLayout = pipelineLayout;
+			draw.descriptorSet = descriptorSets[material];
+			draw.vertexBuffer = buffers[mesh];
+			draw.indexBuffer = buffers[mesh];
+			draw.drawData.model[3][0] = static_cast<float>(i);
+			draw.drawData.materialIndex = material;
+			draw.indexCount = 36;
+			drawList.add(draw);
+		}
+
+		drawList.sort(&jobSystem);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	if (argc > 1) {
+		workerCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	JobSystem jobSystem;
+	jobSystem.lazyInit(workerCount);
+
+	VkDevice device = nullVulkan::makeHandle<VkDevice>();
+
+	PerDrawDataBinder drawDataBinder;
+	drawDataBinder.setPushConstantRange({ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PerDrawData) });
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = nullVulkan::makeHandle<VkRenderPass>();
+
+	std::printf("job system workers: %u, hardware threads: %u, best of %u frames\n\n",
+		workerCount, std::thread::hardware_concurrency(), kFrameCount);
+	std::printf("%7s %12s", "draws", "inline ms");
+	for (uint32_t secondaryCount : kSecondaryCounts) {
+		std::printf(" %9u sec", secondaryCount);
+	}
+	std::printf("\n");
+
+	for (uint32_t drawCount : kDrawCounts) {
+		DrawList drawList;
+		fillDrawList(drawList, drawCount, jobSystem);
+
+		// Everything into the primary from this thread, no secondaries
+		VkCommandBuffer primary = nullVulkan::makeHandle<VkCommandBuffer>();
+
+		double inlineMs = benchUtils::bestMilliseconds(kFrameCount, [&]() {
+			drawList.record(primary, 0, drawCount, drawDataBinder);
+		});
+
+		std::printf("%7u %12.3f", drawCount, inlineMs);
+
+		for (uint32_t secondaryCount : kSecondaryCounts) {
+			FrameCommandRecorder recorder;
+			recorder.lazyInit(device, 0, kFramesInFlight, secondaryCount, jobSystem);
+
+			// The recorder times itself, from begin() to end()
+			double bestMs = benchUtils::bestOf(kFrameCount, [&](uint32_t frame) {
+				uint32_t frameIndex = frame % kFramesInFlight;
+
+				recorder.resetFrame(frameIndex);
+				recorder.begin(frameIndex);
+				recorder.recordPassDraws(frameIndex, inheritanceInfo, drawCount,
+					[&](VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) {
+						drawList.record(commandBuffer, first, last, drawDataBinder);
+					});
+				recorder.end(frameIndex);
+
+				return recorder.getLastRecordMilliseconds();
+			});
+
+			std::printf(" %13.3f", bestMs);
+
+			recorder.cleanUp();
+		}
+
+		std::printf("\n");
+	}
+
+	jobSystem.cleanUp();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+// CPU cost per frame of N copies of one mesh: N draws with their own per-draw data, against
+//  appending N transforms to the InstanceBuffer and one instanced draw.
+//  InstancingBench [copy count, defaults to 100000]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "DrawList.h"
+#include "InstanceBuffer.h"
+#include "NullVulkan.h"
+
+namespace
+{
+	const uint32_t kFrameCount = 10;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t copyCount = 100000;
+	if (argc > 1) {
+		copyCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	VkPhysicalDevice physicalDevice = nullVulkan::makeHandle<VkPhysicalDevice>();
+	VkDevice device = nullVulkan::makeHandle<VkDevice>();
+	VkCommandBuffer commandBuffer = nullVulkan::makeHandle<VkCommandBuffer>();
+
+	PerDrawDataBinder drawDataBinder;
+	drawDataBinder.setPushConstantRange({ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PerDrawData) });
+
+	InstanceBuffer instanceBuffer;
+	instanceBuffer.lazyInit(physicalDevice, device, 2, copyCount);
+
+	std::vector<glm::mat4> transforms(copyCount, glm::mat4(1.0f));
+	for (uint32_t i = 0; i < copyCount; ++i) {
+		transforms[i][3][0] = static_cast<float>(i);
+	}
+
+	DrawItem mesh;
+	mesh.pipeline = nullVulkan::makeHandle<VkPipeline>();
+	mesh.pipelineLayout = nullVulkan::makeHandle<VkPipelineLayout>();
+	mesh.descriptorSet = nullVulkan::makeHandle<VkDescriptorSet>();
+	mesh.vertexBuffer = nullVulkan::makeHandle<VkBuffer>();
+	mesh.indexBuffer = nullVulkan::makeHandle<VkBuffer>();
+	mesh.indexCount = 11484;	// The viking room
+
+	DrawList drawList;
+
+	// One draw per copy, its transform as the draw's model matrix
+	double perDrawMs = benchUtils::bestMilliseconds(kFrameCount, [&]() {
+		drawList.clear();
+		for (glm::mat4 const &transform : transforms) {
+			DrawItem draw = mesh;
+			draw.drawData.model = transform;
+			drawList.add(draw);
+		}
+		drawList.sort();
+		drawList.record(commandBuffer, 0, drawList.size(), drawDataBinder);
+	});
+
+	nullVulkan::resetCounts();
+	drawList.record(commandBuffer, 0, drawList.size(), drawDataBinder);
+	nullVulkan::Counts perDrawCounts = nullVulkan::getCounts();
+
+	// All copies in one instanced draw
+	double instancedMs = benchUtils::bestMilliseconds(kFrameCount, [&](uint32_t frame) {
+		instanceBuffer.beginFrame(frame % 2);
+
+		DrawItem draw = mesh;
+		draw.instanceBuffer = instanceBuffer.getBuffer(frame % 2);
+		draw.firstInstance = instanceBuffer.add(transforms.data(), copyCount);
+		draw.instanceCount = copyCount;
+
+		drawList.clear();
+		drawList.add(draw);
+		drawList.sort();
+		drawList.record(commandBuffer, 0, drawList.size(), drawDataBinder);
+	});
+
+	nullVulkan::resetCounts();
+	drawList.record(commandBuffer, 0, drawList.size(), drawDataBinder);
+	nullVulkan::Counts instancedCounts = nullVulkan::getCounts();
+
+	std::printf("%u copies of one mesh, best of %u frames\n\n", copyCount, kFrameCount);
+	std::printf("%10s %10s %10s %10s %10s\n", "", "ms", "commands", "draws", "binds");
+	std::printf("%10s %10.3f %10llu %10llu %10llu\n", "per draw", perDrawMs,
+		static_cast<unsigned long long>(perDrawCounts.commands),
+		static_cast<unsigned long long>(perDrawCounts.draws),
+		static_cast<unsigned long long>(perDrawCounts.binds));
+	std::printf("%10s %10.3f %10llu %10llu %10llu\n", "instanced", instancedMs,
+		static_cast<unsigned long long>(instancedCounts.commands),
+		static_cast<unsigned long long>(instancedCounts.draws),
+		static_cast<unsigned long long>(instancedCounts.binds));
+
+	instanceBuffer.cleanUp();
+	return 0;
+}
\ No newline at end of file
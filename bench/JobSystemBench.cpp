@@ -0,0 +1,103 @@
+// Scheduling overhead and scaling of JobSystem, on the CPU only.
+//  JobSystemBench [max worker count, defaults to one per hardware thread less one]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "JobSystem.h"
+
+namespace
+{
+	constexpr uint32_t kEmptyJobCount = 200000;
+	constexpr uint32_t kWorkItemCount = 1u << 22;
+	constexpr uint32_t kRepeatCount = 5;
+
+	// Enough arithmetic per item that a batch of a few thousand outweighs queueing it
+	float work(uint32_t i)
+	{
+		float x = static_cast<float>(i);
+		return std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+	}
+
+	volatile float gSink = 0.0f;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t maxWorkerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	if (argc > 1) {
+		maxWorkerCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	std::printf("hardware threads: %u\n\n", std::thread::hardware_concurrency());
+
+	std::vector<float> results(kWorkItemCount);
+
+	double serialMs = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+		for (uint32_t i = 0; i < kWorkItemCount; ++i) {
+			results[i] = work(i);
+		}
+		gSink = results[kWorkItemCount / 2];
+	});
+
+	std::printf("%7s %14s %14s %14s %16s %9s\n",
+		"workers", "run+wait ns", "chain ns", "parallelFor ms", "serial loop ms", "speedup");
+
+	// None, then doubling up to the maximum
+	std::vector<uint32_t> workerCounts{ 0 };
+	for (uint32_t count = 1; count < maxWorkerCount; count *= 2) {
+		workerCounts.push_back(count);
+	}
+	if (maxWorkerCount > 0) {
+		workerCounts.push_back(maxWorkerCount);
+	}
+
+	for (uint32_t workerCount : workerCounts) {
+		JobSystem jobSystem;
+		jobSystem.lazyInit(workerCount);
+
+		// Cost of queueing, taking and counting down one job that does nothing. Best of kRepeatCount, the
+		//  first run also warms up the workers.
+		double emptyMs = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+			JobCounter counter;
+			for (uint32_t i = 0; i < kEmptyJobCount; ++i) {
+				jobSystem.run([]() {}, &counter);
+			}
+			jobSystem.wait(counter);
+		});
+
+		// Each job only starts once the one before it is done, so nothing runs in parallel
+		double chainMs = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+			std::vector<JobCounter> counters(kEmptyJobCount / 10);
+			jobSystem.run([]() {}, &counters[0]);
+			for (size_t i = 1; i < counters.size(); ++i) {
+				jobSystem.runAfter(counters[i - 1], []() {}, &counters[i]);
+			}
+			for (JobCounter &counter : counters) {
+				jobSystem.wait(counter);
+			}
+		});
+
+		double parallelMs = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+			jobSystem.parallelFor(kWorkItemCount, 4096, [&](uint32_t first, uint32_t last) {
+				for (uint32_t i = first; i < last; ++i) {
+					results[i] = work(i);
+				}
+			});
+			gSink = results[kWorkItemCount / 2];
+		});
+
+		std::printf("%7u %14.1f %14.1f %14.2f %16.2f %8.2fx\n",
+			workerCount,
+			emptyMs * 1.0e6 / kEmptyJobCount,
+			chainMs * 1.0e6 / (kEmptyJobCount / 10),
+			parallelMs, serialMs, serialMs / parallelMs);
+
+		jobSystem.cleanUp();
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+// Time MipGenerator takes for a full chain, per filter, size and number of threads.
+//  MipGeneratorBench [max worker count, defaults to one per hardware thread less one]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+
+namespace
+{
+	const uint32_t kSizes[] = { 512, 1024, 2048, 4096 };
+	const uint32_t kChannels = 4;
+	const uint32_t kRepeatCount = 3;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t maxWorkerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	if (argc > 1) {
+		maxWorkerCount = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10));
+	}
+
+	std::vector<uint32_t> workerCounts{ 0 };
+	for (uint32_t count = 1; count < maxWorkerCount; count *= 2) {
+		workerCounts.push_back(count);
+	}
+	if (maxWorkerCount > 0) {
+		workerCounts.push_back(maxWorkerCount);
+	}
+
+	std::printf("RGBA8 sRGB, full chains, hardware threads: %u\n\n", std::thread::hardware_concurrency());
+	std::printf("%6s %7s %8s %10s %12s\n", "filter", "size", "workers", "ms", "MTexel/s");
+
+	for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser }) {
+		for (uint32_t size : kSizes) {
+			std::vector<MipLevel> levels =
+				MipGenerator::getChainLayout(size, size, MipGenerator::getMipLevelCount(size, size), kChannels);
+			std::vector<uint8_t> chain(MipGenerator::getChainSize(levels));
+
+			// Noise, so nothing about the contents is cheaper than a photo
+			std::mt19937 random(size);
+			for (size_t i = 0; i < levels[0].size; ++i) {
+				chain[i] = static_cast<uint8_t>(random());
+			}
+
+			for (uint32_t workerCount : workerCounts) {
+				JobSystem jobSystem;
+				jobSystem.lazyInit(workerCount);
+
+				MipGenerator generator(filter, 0, &jobSystem);
+				double ms = benchUtils::bestMilliseconds(kRepeatCount, [&]() {
+					generator.generate(chain.data(), levels, kChannels, true);
+				});
+
+				std::printf("%6s %7u %8u %10.2f %12.1f\n",
+					filter == MipGenerator::Filter::Box ? "box" : "kaiser",
+					size, workerCount, ms, double(size) * size / (ms * 1000.0));
+
+				jobSystem.cleanUp();
+			}
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
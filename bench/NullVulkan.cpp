@@ -0,0 +1,533 @@
+#include "NullVulkan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace nullVulkan
+{
+	// Outside the anonymous namespace so reading the descriptor infos can't be optimized away
+	thread_local uint64_t tDescriptorSum = 0;
+}
+
+namespace
+{
+	// Big enough for any format the renderer uses, with room for a full mip chain
+	const VkDeviceSize kMaxTexelSize = 16;
+
+	struct NullBuffer
+	{
+		VkDeviceSize size;
+	};
+
+	struct NullImage
+	{
+		VkDeviceSize size;
+	};
+
+	struct NullDescriptorUpdateTemplate
+	{
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	};
+
+	std::atomic<uint64_t> gNextHandle{ 0 };
+	thread_local nullVulkan::Counts tCounts;
+
+	template<typename Handle>
+	Handle toHandle(void *pObject)
+	{
+		return (Handle) reinterpret_cast<uintptr_t>(pObject);
+	}
+
+	template<typename Object, typename Handle>
+	Object *fromHandle(Handle handle)
+	{
+		return reinterpret_cast<Object *>((uintptr_t) handle);
+	}
+
+	void countCommand()
+	{
+		++tCounts.commands;
+	}
+
+	void countBind()
+	{
+		++tCounts.commands;
+		++tCounts.binds;
+	}
+
+	// What a driver would copy into the set, for one descriptor
+	void readDescriptor(VkDescriptorType type, void const *pInfo)
+	{
+		switch (type) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: {
+			VkDescriptorImageInfo const *pImageInfo = static_cast<VkDescriptorImageInfo const *>(pInfo);
+			nullVulkan::tDescriptorSum += (uint64_t) pImageInfo->sampler + (uint64_t) pImageInfo->imageView;
+			break;
+		}
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			nullVulkan::tDescriptorSum += (uint64_t) *static_cast<VkBufferView const *>(pInfo);
+			break;
+		default: {
+			VkDescriptorBufferInfo const *pBufferInfo = static_cast<VkDescriptorBufferInfo const *>(pInfo);
+			nullVulkan::tDescriptorSum += (uint64_t) pBufferInfo->buffer + pBufferInfo->offset + pBufferInfo->range;
+			break;
+		}
+		}
+
+		++tCounts.descriptorWrites;
+	}
+
+	VKAPI_ATTR void VKAPI_CALL getPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2 *pFeatures)
+	{
+		vkGetPhysicalDeviceFeatures(physicalDevice, &pFeatures->features);
+
+		nullVulkan::Device const &device = nullVulkan::getDevice();
+
+		for (VkBaseOutStructure *pNext = (VkBaseOutStructure *) pFeatures->pNext; pNext; pNext = pNext->pNext) {
+			if (pNext->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES) {
+				((VkPhysicalDeviceTimelineSemaphoreFeatures *) pNext)->timelineSemaphore = VK_TRUE;
+			}
+#ifdef VK_KHR_dynamic_rendering
+			if (pNext->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR) {
+				((VkPhysicalDeviceDynamicRenderingFeaturesKHR *) pNext)->dynamicRendering = device.dynamicRendering;
+			}
+#endif
+#ifdef VK_KHR_synchronization2
+			if (pNext->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+				((VkPhysicalDeviceSynchronization2FeaturesKHR *) pNext)->synchronization2 = device.synchronization2;
+			}
+#endif
+		}
+	}
+
+	VKAPI_ATTR void VKAPI_CALL getPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2 *pProperties)
+	{
+		// Extension structs chained to it keep their zeros
+		vkGetPhysicalDeviceProperties(physicalDevice, &pProperties->properties);
+	}
+
+	VKAPI_ATTR VkResult VKAPI_CALL createDescriptorUpdateTemplate(
+		VkDevice, VkDescriptorUpdateTemplateCreateInfo const *pCreateInfo, VkAllocationCallbacks const *,
+		VkDescriptorUpdateTemplate *pTemplate )
+	{
+		NullDescriptorUpdateTemplate *pNullTemplate = new NullDescriptorUpdateTemplate;
+		pNullTemplate->entries.assign(
+			pCreateInfo->pDescriptorUpdateEntries,
+			pCreateInfo->pDescriptorUpdateEntries + pCreateInfo->descriptorUpdateEntryCount);
+
+		*pTemplate = toHandle<VkDescriptorUpdateTemplate>(pNullTemplate);
+		return VK_SUCCESS;
+	}
+
+	VKAPI_ATTR void VKAPI_CALL destroyDescriptorUpdateTemplate(
+		VkDevice, VkDescriptorUpdateTemplate descriptorUpdateTemplate, VkAllocationCallbacks const * )
+	{
+		delete fromHandle<NullDescriptorUpdateTemplate>(descriptorUpdateTemplate);
+	}
+
+	VKAPI_ATTR void VKAPI_CALL updateDescriptorSetWithTemplate(
+		VkDevice, VkDescriptorSet, VkDescriptorUpdateTemplate descriptorUpdateTemplate, void const *pData )
+	{
+		NullDescriptorUpdateTemplate const *pNullTemplate =
+			fromHandle<NullDescriptorUpdateTemplate>(descriptorUpdateTemplate);
+
+		for (VkDescriptorUpdateTemplateEntry const &entry : pNullTemplate->entries) {
+			for (uint32_t i = 0; i < entry.descriptorCount; ++i) {
+				readDescriptor(entry.descriptorType, static_cast<uint8_t const *>(pData) + entry.offset + i * entry.stride);
+			}
+		}
+	}
+
+#ifdef VK_KHR_synchronization2
+	VKAPI_ATTR void VKAPI_CALL cmdPipelineBarrier2(VkCommandBuffer, VkDependencyInfoKHR const *pDependencyInfo)
+	{
+		countCommand();
+		++tCounts.barrierCommands;
+		tCounts.barriers += pDependencyInfo->memoryBarrierCount
+			+ pDependencyInfo->bufferMemoryBarrierCount
+			+ pDependencyInfo->imageMemoryBarrierCount;
+	}
+#endif
+
+#ifdef VK_KHR_dynamic_rendering
+	VKAPI_ATTR void VKAPI_CALL cmdBeginRendering(VkCommandBuffer, VkRenderingInfoKHR const *)
+	{
+		countCommand();
+	}
+
+	VKAPI_ATTR void VKAPI_CALL cmdEndRendering(VkCommandBuffer)
+	{
+		countCommand();
+	}
+#endif
+
+	struct NamedFunction
+	{
+		char const *pName;
+		PFN_vkVoidFunction pFunction;
+	};
+
+	PFN_vkVoidFunction findFunction(NamedFunction const *pFirst, NamedFunction const *pLast, char const *pName)
+	{
+		NamedFunction const *pFound = std::find_if(pFirst, pLast, [pName](NamedFunction const &function) {
+			return std::strcmp(function.pName, pName) == 0;
+		});
+
+		return pFound != pLast ? pFound->pFunction : nullptr;
+	}
+}
+
+namespace nullVulkan
+{
+	Device &getDevice()
+	{
+		static Device device;
+		return device;
+	}
+
+	Counts const &getCounts()
+	{
+		return tCounts;
+	}
+
+	void resetCounts()
+	{
+		tCounts = {};
+	}
+
+	uint64_t makeHandleValue()
+	{
+		return ++gNextHandle;
+	}
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance, char const *pName)
+{
+	static NamedFunction const kFunctions[] = {
+		{ "vkGetPhysicalDeviceFeatures2", (PFN_vkVoidFunction) getPhysicalDeviceFeatures2 },
+		{ "vkGetPhysicalDeviceProperties2", (PFN_vkVoidFunction) getPhysicalDeviceProperties2 },
+	};
+
+	return findFunction(std::begin(kFunctions), std::end(kFunctions), pName);
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice, char const *pName)
+{
+	static NamedFunction const kFunctions[] = {
+		{ "vkCreateDescriptorUpdateTemplate", (PFN_vkVoidFunction) createDescriptorUpdateTemplate },
+		{ "vkDestroyDescriptorUpdateTemplate", (PFN_vkVoidFunction) destroyDescriptorUpdateTemplate },
+		{ "vkUpdateDescriptorSetWithTemplate", (PFN_vkVoidFunction) updateDescriptorSetWithTemplate },
+#ifdef VK_KHR_synchronization2
+		{ "vkCmdPipelineBarrier2", (PFN_vkVoidFunction) cmdPipelineBarrier2 },
+		{ "vkCmdPipelineBarrier2KHR", (PFN_vkVoidFunction) cmdPipelineBarrier2 },
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		{ "vkCmdBeginRendering", (PFN_vkVoidFunction) cmdBeginRendering },
+		{ "vkCmdBeginRenderingKHR", (PFN_vkVoidFunction) cmdBeginRendering },
+		{ "vkCmdEndRendering", (PFN_vkVoidFunction) cmdEndRendering },
+		{ "vkCmdEndRenderingKHR", (PFN_vkVoidFunction) cmdEndRendering },
+#endif
+	};
+
+	return findFunction(std::begin(kFunctions), std::end(kFunctions), pName);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties *pProperties)
+{
+	nullVulkan::Device const &device = nullVulkan::getDevice();
+
+	*pProperties = {};
+	pProperties->apiVersion = device.apiVersion;
+	pProperties->limits.maxImageDimension2D = 16384;
+	pProperties->limits.maxImageArrayLayers = 2048;
+	pProperties->limits.maxPushConstantsSize = device.maxPushConstantsSize;
+	pProperties->limits.maxBoundDescriptorSets = 8;
+	pProperties->limits.maxUniformBufferRange = 65536;
+	pProperties->limits.minUniformBufferOffsetAlignment = device.minUniformBufferOffsetAlignment;
+	pProperties->limits.minStorageBufferOffsetAlignment = 64;
+	pProperties->limits.nonCoherentAtomSize = 64;
+	pProperties->limits.maxDrawIndirectCount = ~0u;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures *pFeatures)
+{
+	*pFeatures = {};
+	pFeatures->multiDrawIndirect = VK_TRUE;
+	pFeatures->drawIndirectFirstInstance = VK_TRUE;
+	pFeatures->samplerAnisotropy = VK_TRUE;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties *pProperties)
+{
+	// One heap, and one type of memory that is everything at once
+	*pProperties = {};
+	pProperties->memoryTypeCount = 1;
+	pProperties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		| VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		| VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	pProperties->memoryTypes[0].heapIndex = 0;
+	pProperties->memoryHeapCount = 1;
+	pProperties->memoryHeaps[0].size = VkDeviceSize(8) << 30;
+	pProperties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
+	VkPhysicalDevice, char const *, uint32_t *pPropertyCount, VkExtensionProperties * )
+{
+	// Everything the renderer looks for is core in the version getDevice() reports
+	*pPropertyCount = 0;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(
+	VkDevice, VkMemoryAllocateInfo const *pAllocateInfo, VkAllocationCallbacks const *, VkDeviceMemory *pMemory )
+{
+	// calloc, so the pages of big allocations that are never mapped aren't touched either
+	void *pData = std::calloc(std::max<VkDeviceSize>(pAllocateInfo->allocationSize, 1), 1);
+
+	if (!pData) {
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	*pMemory = toHandle<VkDeviceMemory>(pData);
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, VkAllocationCallbacks const *)
+{
+	std::free(fromHandle<void>(memory));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(
+	VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void **ppData )
+{
+	*ppData = fromHandle<uint8_t>(memory) + offset;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(
+	VkDevice, VkBufferCreateInfo const *pCreateInfo, VkAllocationCallbacks const *, VkBuffer *pBuffer )
+{
+	*pBuffer = toHandle<VkBuffer>(new NullBuffer{ pCreateInfo->size });
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, VkAllocationCallbacks const *)
+{
+	delete fromHandle<NullBuffer>(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer, VkMemoryRequirements *pRequirements)
+{
+	pRequirements->size = fromHandle<NullBuffer>(buffer)->size;
+	pRequirements->alignment = 256;
+	pRequirements->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(
+	VkDevice, VkImageCreateInfo const *pCreateInfo, VkAllocationCallbacks const *, VkImage *pImage )
+{
+	VkDeviceSize texels = VkDeviceSize(pCreateInfo->extent.width) * pCreateInfo->extent.height
+		* pCreateInfo->extent.depth * pCreateInfo->arrayLayers;
+
+	*pImage = toHandle<VkImage>(new NullImage{ texels * kMaxTexelSize * 4 / 3 });
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage image, VkAllocationCallbacks const *)
+{
+	delete fromHandle<NullImage>(image);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage image, VkMemoryRequirements *pRequirements)
+{
+	pRequirements->size = fromHandle<NullImage>(image)->size;
+	pRequirements->alignment = 4096;
+	pRequirements->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(
+	VkDevice, VkImageViewCreateInfo const *, VkAllocationCallbacks const *, VkImageView *pView )
+{
+	*pView = nullVulkan::makeHandle<VkImageView>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice, VkImageView, VkAllocationCallbacks const *)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(
+	VkDevice, VkRenderPassCreateInfo const *, VkAllocationCallbacks const *, VkRenderPass *pRenderPass )
+{
+	*pRenderPass = nullVulkan::makeHandle<VkRenderPass>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(VkDevice, VkRenderPass, VkAllocationCallbacks const *)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateFramebuffer(
+	VkDevice, VkFramebufferCreateInfo const *, VkAllocationCallbacks const *, VkFramebuffer *pFramebuffer )
+{
+	*pFramebuffer = nullVulkan::makeHandle<VkFramebuffer>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyFramebuffer(VkDevice, VkFramebuffer, VkAllocationCallbacks const *)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(
+	VkDevice, VkCommandPoolCreateInfo const *, VkAllocationCallbacks const *, VkCommandPool *pCommandPool )
+{
+	*pCommandPool = nullVulkan::makeHandle<VkCommandPool>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice, VkCommandPool, VkAllocationCallbacks const *)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkResetCommandPool(VkDevice, VkCommandPool, VkCommandPoolResetFlags)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateCommandBuffers(
+	VkDevice, VkCommandBufferAllocateInfo const *pAllocateInfo, VkCommandBuffer *pCommandBuffers )
+{
+	for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; ++i) {
+		pCommandBuffers[i] = nullVulkan::makeHandle<VkCommandBuffer>();
+	}
+
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer, VkCommandBufferBeginInfo const *)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSets(
+	VkDevice,
+	uint32_t descriptorWriteCount,
+	VkWriteDescriptorSet const *pDescriptorWrites,
+	uint32_t,
+	VkCopyDescriptorSet const * )
+{
+	for (uint32_t write = 0; write < descriptorWriteCount; ++write) {
+		VkWriteDescriptorSet const &descriptorWrite = pDescriptorWrites[write];
+
+		for (uint32_t i = 0; i < descriptorWrite.descriptorCount; ++i) {
+			void const *pInfo = descriptorWrite.pImageInfo
+				? static_cast<void const *>(descriptorWrite.pImageInfo + i)
+				: descriptorWrite.pBufferInfo
+					? static_cast<void const *>(descriptorWrite.pBufferInfo + i)
+					: static_cast<void const *>(descriptorWrite.pTexelBufferView + i);
+
+			readDescriptor(descriptorWrite.descriptorType, pInfo);
+		}
+	}
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer, VkRenderPassBeginInfo const *, VkSubpassContents)
+{
+	countCommand();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer)
+{
+	countCommand();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdExecuteCommands(VkCommandBuffer, uint32_t, VkCommandBuffer const *)
+{
+	countCommand();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(
+	VkCommandBuffer,
+	VkPipelineStageFlags,
+	VkPipelineStageFlags,
+	VkDependencyFlags,
+	uint32_t memoryBarrierCount,
+	VkMemoryBarrier const *,
+	uint32_t bufferMemoryBarrierCount,
+	VkBufferMemoryBarrier const *,
+	uint32_t imageMemoryBarrierCount,
+	VkImageMemoryBarrier const * )
+{
+	countCommand();
+	++tCounts.barrierCommands;
+	tCounts.barriers += memoryBarrierCount + bufferMemoryBarrierCount + imageMemoryBarrierCount;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline)
+{
+	countBind();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindDescriptorSets(
+	VkCommandBuffer,
+	VkPipelineBindPoint,
+	VkPipelineLayout,
+	uint32_t,
+	uint32_t,
+	VkDescriptorSet const *,
+	uint32_t,
+	uint32_t const * )
+{
+	countBind();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, VkBuffer const *, VkDeviceSize const *)
+{
+	countBind();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType)
+{
+	countBind();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPushConstants(
+	VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, void const * )
+{
+	countBind();
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer, uint32_t, uint32_t, uint32_t, int32_t, uint32_t)
+{
+	countCommand();
+	++tCounts.draws;
+}
\ No newline at end of file
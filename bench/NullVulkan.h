@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef NULL_VULKAN_H
+#define NULL_VULKAN_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * Stands in for the Vulkan loader in the benchmarks that record commands: NullVulkan.cpp defines the
+ *  entry points the measured sources call, and they do as little as a driver could. Commands are only
+ *  counted, handles are made up and device memory is host memory, so mapping it works. What gets
+ *  measured is the renderer's own CPU cost of getting its work to the driver.
+ */
+namespace nullVulkan
+{
+	// What the physical device reports. Change it before VulkanDeviceFeatures::query() to get the other paths.
+	struct Device
+	{
+		uint32_t apiVersion = VK_API_VERSION_1_3;
+		bool synchronization2 = true;
+		bool dynamicRendering = true;
+		uint32_t maxPushConstantsSize = 128;
+		VkDeviceSize minUniformBufferOffsetAlignment = 256;
+	};
+
+	Device &getDevice();
+
+	// Recorded on the calling thread since its last resetCounts()
+	struct Counts
+	{
+		uint64_t commands = 0;	// Every vkCmd*
+		uint64_t draws = 0;
+		uint64_t binds = 0;	// Pipelines, descriptor sets, vertex and index buffers, push constants
+		uint64_t barrierCommands = 0;	// vkCmdPipelineBarrier and vkCmdPipelineBarrier2
+		uint64_t barriers = 0;	// Memory, buffer and image barriers in those
+		uint64_t descriptorWrites = 0;	// Descriptors written, one by one or with a template
+	};
+
+	Counts const &getCounts();
+	void resetCounts();
+
+	// Never the same twice, and never VK_NULL_HANDLE
+	uint64_t makeHandleValue();
+
+	template<typename Handle>
+	Handle makeHandle() { return (Handle) makeHandleValue(); }
+
+	template<typename Handle>
+	std::vector<Handle> makeHandles(uint32_t count)
+	{
+		std::vector<Handle> handles(count);
+		for (Handle &handle : handles) {
+			handle = makeHandle<Handle>();
+		}
+
+		return handles;
+	}
+}
+
+#endif // NULL_VULKAN_H
\ No newline at end of file
@@ -0,0 +1,15 @@
+# Turns a SPIR-V binary into a header holding its words as a constexpr uint32_t array, see embedShaders
+# in utils.cmake. Runs in script mode:
+#   cmake -DINPUT=<.spv> -DOUTPUT=<.h> -DNAME=<array name> -P embedSpirv.cmake
+
+file(READ "${INPUT}" SPIRV_HEX HEX)
+
+# The file is little endian words, swap every 4 bytes back into one literal
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u,\n" SPIRV_WORDS "${SPIRV_HEX}")
+
+file(WRITE "${OUTPUT}"
+	"// Generated from ${INPUT} by embedSpirv.cmake, do not edit\n"
+	"#pragma once\n\n"
+	"#include <cstdint>\n\n"
+	"constexpr uint32_t ${NAME}[] = {\n${SPIRV_WORDS}};\n"
+)
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef BARRIER_BATCHER_H
+#define BARRIER_BATCHER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ResourceUsage.h"
+
+class VulkanDeviceFeatures;
+
+/**
+ * Collects the image, buffer and memory barriers that have to come before the next commands of a
+ *  command buffer, and records all of them with one barrier command on flush(). Masks are derived
+ *  from the usages on either side, each barrier only waits for the stages and writes of those.
+ *
+ * With synchronization2 that is vkCmdPipelineBarrier2, where every barrier carries its own stage
+ *  masks and the finer stages and accesses of getResourceUsageMasks2. Otherwise, or before lazyInit(),
+ *  it is vkCmdPipelineBarrier, whose stage masks are shared by the whole batch.
+ *
+ * Not thread safe, use one per thread recording.
+ */
+class BarrierBatcher
+{
+public:
+	BarrierBatcher() = default;
+
+	void lazyInit(VkDevice, VulkanDeviceFeatures const &);
+
+	bool usesSynchronization2() const;
+
+	// After every usage in previous, into next's layout from oldLayout. UNDEFINED throws the contents away.
+	void addImage(
+		VkImage, VkImageSubresourceRange const &, ResourceUsageSet previous, VkImageLayout oldLayout, ResourceUsage next );
+	// Without preserveContents the image comes from UNDEFINED, previous' layout otherwise
+	void addImage(
+		VkImage, VkImageSubresourceRange const &, ResourceUsage previous, ResourceUsage next, bool preserveContents = true );
+
+	void addBuffer(VkBuffer, VkDeviceSize offset, VkDeviceSize size, ResourceUsageSet previous, ResourceUsage next);
+
+	// Covers every buffer at once, all added until the flush are merged into one
+	void addMemory(ResourceUsageSet previous, ResourceUsage next);
+
+	bool isEmpty() const;
+
+	// One barrier command for everything added since the last flush, none if nothing was
+	void flush(VkCommandBuffer);
+
+	// Barriers, and the commands they were recorded with, since the last resetStats()
+	uint64_t getBarrierCount() const { return mBarrierCount; }
+	uint64_t getCommandCount() const { return mCommandCount; }
+	void resetStats();
+
+private:
+	struct ImageBarrier
+	{
+		VkImage image;
+		VkImageSubresourceRange range;
+		VkImageLayout oldLayout, newLayout;
+		ResourceUsageSet previous;
+		ResourceUsage next;
+	};
+
+	struct BufferBarrier
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset, size;
+		ResourceUsageSet previous;
+		ResourceUsage next;
+	};
+
+	void recordBarrier(VkCommandBuffer);
+	void recordBarrier2(VkCommandBuffer);
+
+	std::vector<ImageBarrier> mImageBarriers;
+	std::vector<BufferBarrier> mBufferBarriers;
+	ResourceUsageSet mMemoryPrevious = 0;
+	ResourceUsageSet mMemoryNext = 0;
+
+	uint64_t mBarrierCount = 0;
+	uint64_t mCommandCount = 0;
+
+#ifdef VK_KHR_synchronization2
+	PFN_vkCmdPipelineBarrier2KHR mpfnCmdPipelineBarrier2 = nullptr;
+#endif
+};
+
+#endif // BARRIER_BATCHER_H
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * Hands out descriptor sets of any layout without anyone having to size a pool for them. Sets come
+ *  from the current pool until it runs out (VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL),
+ *  then from a new one, each twice the size of the last up to a limit.
+ *
+ * Sets are never freed one by one. reset() returns every set at once and keeps the pools around for
+ *  the next allocations, so an allocator per frame in flight can hold that frame's transient sets and
+ *  be reset once the frame is done. Set layouts are PipelineLayoutCache's business.
+ *
+ * Not thread safe.
+ */
+class DescriptorAllocator
+{
+public:
+	// How many descriptors of a type a pool holds per set it can allocate
+	struct PoolSizeRatio
+	{
+		VkDescriptorType type;
+		float descriptorsPerSet;
+	};
+
+	DescriptorAllocator() = default;
+
+	// Without ratios, pools are sized for a few buffers and images of each common type per set
+	void lazyInit(VkDevice, uint32_t initialSetsPerPool = 16, std::vector<PoolSizeRatio> const &ratios = {});
+
+	// Throws only if a new, empty pool can't hold the set either
+	VkDescriptorSet allocate(VkDescriptorSetLayout);
+
+	// Frees every set allocated so far, none of them may be in use by the GPU anymore
+	void reset();
+
+	void cleanUp();
+
+private:
+	VkDescriptorPool getPool();
+	VkDescriptorPool createPool(uint32_t maxSets);
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	std::vector<PoolSizeRatio> mRatios;
+	uint32_t mSetsPerPool = 0;	// Size of the next pool created
+
+	VkDescriptorPool mCurrentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> mFullPools;
+	std::vector<VkDescriptorPool> mFreePools;	// Reset and ready to be allocated from again
+};
+
+#endif // DESCRIPTOR_ALLOCATOR_H
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef DESCRIPTOR_UPDATE_TEMPLATE_H
+#define DESCRIPTOR_UPDATE_TEMPLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class VulkanDeviceFeatures;
+
+/**
+ * Writes every descriptor of a set in one call, from a packed struct holding the VkDescriptorBufferInfo,
+ *  VkDescriptorImageInfo or VkBufferView of each. The entries say where in the struct each binding's
+ *  info is, build them from the bindings the set layout was made of.
+ *
+ * With Vulkan 1.1 the entries become a VkDescriptorUpdateTemplate and a set is updated with
+ *  vkUpdateDescriptorSetWithTemplate, so the driver reads the struct directly instead of a
+ *  VkWriteDescriptorSet per binding being built and walked for every set. On 1.0 the same struct is
+ *  turned into those writes, callers fill the struct either way.
+ */
+class DescriptorUpdateTemplate
+{
+public:
+	struct Entry
+	{
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		size_t offset = 0;	// Of the first descriptor's info in the struct
+		uint32_t count = 1;
+		size_t stride = 0;	// Between the infos of an array's elements
+	};
+
+	DescriptorUpdateTemplate() = default;
+
+	// useTemplate false always writes descriptors the 1.0 way, to compare against
+	void lazyInit(
+		VkDevice,
+		VulkanDeviceFeatures const &,
+		VkDescriptorSetLayout,
+		std::vector<Entry> const &,
+		bool useTemplate = true );
+
+	// pData is the packed struct the entries describe
+	void update(VkDescriptorSet, void const *pData) const;
+
+	bool usesTemplate() const { return mTemplate != VK_NULL_HANDLE; }
+
+	void cleanUp();
+
+private:
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	std::vector<Entry> mEntries;
+
+	VkDescriptorUpdateTemplate mTemplate = VK_NULL_HANDLE;
+	PFN_vkUpdateDescriptorSetWithTemplate mpfnUpdateDescriptorSetWithTemplate = nullptr;
+	PFN_vkDestroyDescriptorUpdateTemplate mpfnDestroyDescriptorUpdateTemplate = nullptr;
+};
+
+#endif // DESCRIPTOR_UPDATE_TEMPLATE_H
\ No newline at end of file
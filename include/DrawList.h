@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+#include "PerDrawData.h"
+
+/**
+ * One indexed draw and everything it binds. Nothing is inherited between draws, DrawList::record
+ *  works out which of these actually change from one draw to the next.
+ */
+struct DrawItem
+{
+	uint64_t sortKey = 0;	// From DrawList::makeSortKey
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;	// Bound to set 0
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;	// 32 bit indices
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;	// Per-instance data at binding 1, not bound if null
+
+	PerDrawData drawData;	// Through the PerDrawDataBinder given to record()
+
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+	uint32_t instanceCount = 1;
+};
+
+/**
+ * The draws of a frame, sorted by a 64 bit key so draws that share state end up next to each other.
+ *  From the most to the least significant bits the key holds:
+ *   - pass, 8 bits: everything of one pass is drawn before the next pass starts
+ *   - pipeline, 16 bits: pipeline switches are the most expensive bind
+ *   - material, 24 bits: descriptor sets and push constants
+ *   - depth bucket, 16 bits: front to back within a material for early depth rejection
+ *  Pipeline and material are small ids the caller hands out, not handles, so they fit.
+ *
+ * The keys are radix sorted, 8 bits per pass, with the histogram and scatter of each pass split
+ *  across the JobSystem. Passes where all keys have the same digit are skipped, which with mostly
+ *  empty high bits is most of them.
+ *
+ * record() can be called for several ranges at once from different threads, e.g. one per secondary
+ *  command buffer; each range starts with nothing bound.
+ */
+class DrawList
+{
+public:
+	struct Stats
+	{
+		uint32_t draws = 0;
+		uint32_t instances = 0;	// Summed instanceCount of those draws
+		uint32_t bindsIssued = 0;	// Pipeline, descriptor set, vertex/index/instance buffer binds and per-draw data recorded
+		uint32_t bindsSkipped = 0;	// The same, left out because the previous draw had already bound it
+	};
+
+	DrawList() = default;
+
+	static uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint16_t depthBucket);
+	// viewDepth between nearPlane and farPlane. Transparent draws want backToFront, so the farthest comes first.
+	static uint16_t getDepthBucket(float viewDepth, float nearPlane, float farPlane, bool backToFront = false);
+
+	// Also resets the stats, call once per frame before adding its draws
+	void clear();
+	void add(DrawItem const &);
+
+	// Without a job system the sort runs on this thread only
+	void sort(JobSystem *pJobSystem = nullptr);
+
+	// Records sorted draws [first, last)
+	void record(VkCommandBuffer, uint32_t first, uint32_t last, PerDrawDataBinder const &);
+
+	uint32_t size() const { return static_cast<uint32_t>(mDraws.size()); }
+	DrawItem const &operator[](uint32_t sorted) const { return mDraws[sorted]; }
+
+	// Summed over every record() since the last clear()
+	Stats getStats() const;
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	using Histogram = std::array<uint32_t, 256>;
+
+	template<typename Fn>
+	void forEachChunk(JobSystem *, uint32_t chunkCount, Fn fn);
+
+	std::vector<DrawItem> mDraws;	// In the order they were added, sorted by key after sort()
+	std::vector<DrawItem> mSortedDraws;	// What sort() moves them into, kept around for its capacity
+	std::vector<SortEntry> mOrder;	// Keys and where they are in mDraws
+	std::vector<SortEntry> mScratch;
+	std::vector<Histogram> mChunkHistograms;
+
+	std::atomic<uint32_t> mRecordedDraws{ 0 };
+	std::atomic<uint32_t> mRecordedInstances{ 0 };
+	std::atomic<uint32_t> mBindsIssued{ 0 };
+	std::atomic<uint32_t> mBindsSkipped{ 0 };
+};
+
+#endif // DRAW_LIST_H
\ No newline at end of file
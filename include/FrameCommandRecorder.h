@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef FRAME_COMMAND_RECORDER_H
+#define FRAME_COMMAND_RECORDER_H
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+
+/**
+ * Records every frame from scratch, so scene changes show up the next frame without re-recording
+ *  anything up front. Each frame in flight owns one transient command pool per worker thread and one
+ *  for its primary command buffer; they are all reset together once the frame's previous submission
+ *  is done.
+ *
+ * The draws are split into contiguous ranges, one per worker. Each worker records its range into a
+ *  secondary command buffer that continues the render pass, and the primary executes them in order,
+ *  so the result is the same as recording all draws on one thread. The workers run as jobs on the
+ *  JobSystem, so a worker is a command pool and secondary, not a thread of its own.
+ *
+ * The render pass itself is begun by whoever records the primary between begin() and end(), e.g.
+ *  the render graph, with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. With dynamic rendering it
+ *  is vkCmdBeginRendering with the secondary command buffer contents flag instead.
+ */
+class FrameCommandRecorder
+{
+public:
+	// Records draws [first, last) into a secondary command buffer that is already inside the render
+	//  pass. Only the render pass is inherited from the primary, so bind everything the draws use.
+	//  Called from several threads at once.
+	using RecordDrawsFn = std::function<void(VkCommandBuffer, uint32_t first, uint32_t last)>;
+
+	FrameCommandRecorder() = default;
+
+	void lazyInit(VkDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t workerCount, JobSystem &);
+
+	// Only once the GPU is done with what was last submitted for this frame, i.e. has reached its timeline value
+	void resetFrame(uint32_t frame);
+
+	// Returns the frame's primary command buffer, recording
+	VkCommandBuffer begin(uint32_t frame);
+	// Records the draws into the secondaries and executes them from the primary, which has to be
+	//  inside the render pass (or dynamic rendering) the inheritance info describes right now. One
+	//  render pass per frame, the secondaries are reused within it.
+	void recordPassDraws(
+		uint32_t frame, VkCommandBufferInheritanceInfo const &, uint32_t drawCount, RecordDrawsFn const &);
+	// Returns the primary again, ready to submit
+	VkCommandBuffer end(uint32_t frame);
+
+	// CPU time from the last begin() to end(), primary and all workers
+	double getLastRecordMilliseconds() const { return mLastRecordMilliseconds; }
+
+	uint32_t getWorkerCount() const { return mWorkerCount; }
+
+	void cleanUp();
+
+private:
+	struct FrameCommands
+	{
+		VkCommandPool primaryPool = VK_NULL_HANDLE;
+		VkCommandBuffer primary = VK_NULL_HANDLE;
+
+		// One pool per worker, command pools can't be used from two threads at once
+		std::vector<VkCommandPool> workerPools;
+		std::vector<VkCommandBuffer> secondaries;
+	};
+
+	VkCommandPool createCommandPool();
+	VkCommandBuffer allocateCommandBuffer(VkCommandPool, VkCommandBufferLevel);
+
+	void recordSecondary(VkCommandBuffer, VkCommandBufferInheritanceInfo const &, uint32_t, uint32_t, RecordDrawsFn const &);
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	JobSystem *mpJobSystem = nullptr;
+	uint32_t mQueueFamilyIndex = 0;
+	uint32_t mWorkerCount = 1;
+
+	std::vector<FrameCommands> mFrames;
+
+	std::chrono::high_resolution_clock::time_point mRecordStartTime;
+	double mLastRecordMilliseconds = 0.0;
+};
+
+#endif // FRAME_COMMAND_RECORDER_H
\ No newline at end of file
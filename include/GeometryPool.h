@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Vertex.h"
+#include "VulkanBuffer.h"
+#include "VulkanCommandBuffers.h"
+#include "VulkanTimeline.h"
+
+/**
+ * Where a mesh landed in a GeometryPool. Its draws use vertexOffset = firstVertex and start at firstIndex,
+ *  the indices themselves stay relative to the mesh.
+ */
+struct MeshAllocation
+{
+	uint32_t firstVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+/**
+ * Hands out ranges of [0, capacity), first fit. Freed ranges are merged with their free neighbours, so
+ *  space left by several small meshes can take a bigger one later.
+ */
+class FreeListAllocator
+{
+public:
+	static const uint32_t kInvalidOffset = UINT32_MAX;
+
+	FreeListAllocator() = default;
+
+	void lazyInit(uint32_t capacity);
+
+	// kInvalidOffset if no free range is that big
+	uint32_t allocate(uint32_t size);
+	void free(uint32_t offset, uint32_t size);
+
+	uint32_t getFreeSize() const { return mFreeSize; }
+
+private:
+	std::map<uint32_t, uint32_t> mFreeRanges;	// Offset to size, never two that touch
+	uint32_t mFreeSize = 0;
+};
+
+/**
+ * One device local vertex buffer and one index buffer that every mesh is sub-allocated from, so
+ *  binding them once covers all draws and they can all go into one multi-draw indirect call.
+ *
+ * Uploads don't wait. They go through the single time command pool, which submits to the same queue
+ *  as the frames, and end with a barrier into vertex input, so frames submitted later can draw them.
+ */
+class GeometryPool
+{
+public:
+	GeometryPool() = default;
+
+	void lazyInit(
+		VkPhysicalDevice, VkDevice, SingleTimeCommandPool &, VulkanTimeline &, uint32_t maxVertices, uint32_t maxIndices );
+
+	// Throws if either buffer has no free range big enough left
+	MeshAllocation addMesh(std::vector<Vertex> const &, std::vector<uint32_t> const &);
+	// Stop drawing the mesh first; its ranges are reused once the GPU is done with what was submitted so far
+	void removeMesh(MeshAllocation const &);
+
+	void bind(VkCommandBuffer) const;
+
+	VkBuffer getVertexBuffer() const { return mVertexBuffer.getBufferHandle(); }
+	VkBuffer getIndexBuffer() const { return mIndexBuffer.getBufferHandle(); }
+
+	void cleanUp();
+
+private:
+	VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	SingleTimeCommandPool *mpSingleTimeCommands = nullptr;
+	VulkanTimeline *mpTimeline = nullptr;
+
+	VulkanBuffer mVertexBuffer;
+	VulkanBuffer mIndexBuffer;
+
+	// In vertices and indices, not bytes
+	FreeListAllocator mVertexRanges;
+	FreeListAllocator mIndexRanges;
+};
+
+#endif // GEOMETRY_POOL_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <vulkan/vulkan.h>
+
+#include "DescriptorAllocator.h"
+#include "PipelineLayoutCache.h"
+#include "VulkanBuffer.h"
+#include "VulkanDevices.h"
+
+/**
+ * One object to draw, as cull.comp reads it (std430, so keep the vec4 alignment). The draw it turns
+ *  into starts at instance i, so the per-instance vertex data for it has to be at slot i.
+ */
+struct GpuInstance
+{
+	glm::mat4 model{ 1.0f };
+	glm::vec4 boundingSphere{ 0.0f };	// Center in model space, radius in w
+
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t padding = 0;
+};
+
+/**
+ * Frustum culling on the GPU. A compute pass tests the bounding sphere of every instance and writes
+ *  a VkDrawIndexedIndirectCommand for each visible one, so the CPU records the same few commands no
+ *  matter how many objects there are or how many of them are visible.
+ *
+ * With VK_KHR_draw_indirect_count the commands are compacted and their count is read by the GPU as
+ *  well. Without it every instance keeps its own slot and the culled ones draw 0 instances. Without
+ *  multiDrawIndirect that slot array is drawn one vkCmdDrawIndexedIndirect at a time.
+ *
+ * Each frame: recordReset() in a transfer pass, recordCull() in a compute pass, recordDraws() inside
+ *  the render pass. The barriers between them are up to the caller, e.g. the render graph with the
+ *  draw and count buffers imported.
+ */
+class GpuCuller
+{
+public:
+	GpuCuller() = default;
+
+	void lazyInit(
+		VkPhysicalDevice,
+		VkDevice,
+		VulkanDeviceFeatures const &,
+		uint32_t maxInstances,
+		std::vector<uint32_t> const &cullShaderCode,
+		DescriptorAllocator &,	// Its set comes from here, the allocator must outlive the culler
+		PipelineLayoutCache &,	// Owns its set layout
+		VkPipelineCache = VK_NULL_HANDLE );
+
+	// Only while no frame that culls or draws the instances is in flight
+	void setInstances(std::vector<GpuInstance> const &);
+
+	// Storage buffer of GpuInstance, for the culling pass
+	VkBuffer getInstanceBuffer() const { return mInstanceBuffer.getBufferHandle(); }
+	VkDeviceSize getInstanceBufferSize() const { return sizeof(GpuInstance) * mMaxInstances; }
+
+	VkBuffer getDrawBuffer() const { return mDrawBuffer.getBufferHandle(); }
+	VkBuffer getCountBuffer() const { return mCountBuffer.getBufferHandle(); }
+
+	bool usesDrawCount() const { return mpDrawIndexedIndirectCount != nullptr; }
+
+	// Count buffer is written with vkCmdFillBuffer, a transfer
+	void recordReset(VkCommandBuffer);
+	// Draw and count buffers are written by the compute shader
+	void recordCull(VkCommandBuffer, glm::mat4 const &viewProjection);
+	// Inside the render pass, with the pipeline, descriptor sets, vertex and index buffers bound
+	void recordDraws(VkCommandBuffer);
+
+	void cleanUp();
+
+private:
+	void createDescriptorSet(DescriptorAllocator &, PipelineLayoutCache &);
+	void createPipeline(std::vector<uint32_t> const &, VkPipelineCache);
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	uint32_t mMaxInstances = 0;
+	uint32_t mInstanceCount = 0;
+	bool mMultiDrawIndirect = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR mpDrawIndexedIndirectCount = nullptr;
+
+	VulkanBuffer mInstanceBuffer;	// Host visible, stays mapped
+	VulkanBuffer mDrawBuffer;
+	VulkanBuffer mCountBuffer;
+	GpuInstance *mpInstances = nullptr;
+
+	VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline mPipeline = VK_NULL_HANDLE;
+};
+
+#endif // GPU_CULLER_H
\ No newline at end of file
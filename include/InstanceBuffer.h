@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <vulkan/vulkan.h>
+
+#include "Vertex.h"
+#include "VulkanBuffer.h"
+
+/**
+ * The per-instance vertex data of each frame in flight, bound to InstanceData's binding. Every frame
+ *  starts empty and its transforms are appended as the draws are built, so N copies of a mesh cost one
+ *  append and one draw with instanceCount N instead of N draws.
+ *
+ * One host visible buffer per frame in flight, kept mapped. A frame's buffer is only written after the
+ *  frame's previous submission is known to be done, like its command buffers.
+ */
+class InstanceBuffer
+{
+public:
+	InstanceBuffer() = default;
+
+	void lazyInit(VkPhysicalDevice, VkDevice, uint32_t frameCount, uint32_t maxInstancesPerFrame);
+
+	void beginFrame(uint32_t frame);
+
+	// Returns the firstInstance to draw them with. Throws if the frame has no room left for count more.
+	uint32_t add(glm::mat4 const *pTransforms, uint32_t count);
+
+	VkBuffer getBuffer(uint32_t frame) const { return mFrames[frame]->getBufferHandle(); }
+	uint32_t getInstanceCount() const { return mInstanceCount; }
+
+	void cleanUp();
+
+private:
+	uint32_t mMaxInstances = 0;
+
+	std::vector<std::unique_ptr<VulkanBuffer>> mFrames;
+	std::vector<InstanceData *> mMappedFrames;
+
+	uint32_t mFrame = 0;
+	uint32_t mInstanceCount = 0;	// Added to mFrame so far
+};
+
+#endif // INSTANCE_BUFFER_H
\ No newline at end of file
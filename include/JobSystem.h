@@ -0,0 +1,147 @@
+#pragma once
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Counts the jobs that are still to finish. Every job run() with it counts up, every one that
+ *  finishes counts down, and it is done at zero. Jobs queued with runAfter() on it are started
+ *  the moment it gets there. Only destroy one after JobSystem::wait() on it has returned.
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(JobCounter const &) = delete;
+	JobCounter &operator=(JobCounter const &) = delete;
+
+	bool isDone() const { return mCount.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> mCount{ 0 };
+
+	// Guards the continuations, and the count dropping to zero so none slip in after the last job
+	std::mutex mMutex;
+	std::vector<std::pair<std::function<void()>, JobCounter *>> mContinuations;
+};
+
+/**
+ * Work stealing job scheduler. Every worker thread has its own deque: it pushes and pops jobs at
+ *  the back, so what it just queued runs next while the data is still in cache, and idle workers
+ *  steal from the front of the others, where the oldest and usually biggest jobs are. Threads
+ *  outside the system share one more deque.
+ *
+ * The thread that waits on a counter runs jobs too instead of blocking, so waiting from inside a
+ *  job is fine and a system with no workers still gets everything done. Jobs must not throw.
+ */
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	JobSystem() = default;
+	// Joins the workers if cleanUp() wasn't called, e.g. when an exception skipped it
+	~JobSystem() { cleanUp(); }
+	JobSystem(JobSystem const &) = delete;
+	JobSystem &operator=(JobSystem const &) = delete;
+
+	// workerCount of 0 starts one worker per hardware thread, less the one that calls lazyInit
+	void lazyInit(uint32_t workerCount = 0);
+
+	void run(Job, JobCounter *pCounter = nullptr);
+	// Queues the job once dependency is done, pCounter counts it from now on already
+	void runAfter(JobCounter &dependency, Job, JobCounter *pCounter = nullptr);
+
+	void wait(JobCounter &);
+
+	// Calls fn(first, last) on ranges that cover [0, count), each at least minBatchSize long except
+	//  maybe the last, spread over all threads, the calling one included. Returns once all are done.
+	template<typename Fn>
+	void parallelFor(uint32_t count, uint32_t minBatchSize, Fn fn);
+
+	uint32_t getWorkerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+	// Workers plus whichever thread is waiting
+	uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+
+	// Lets the workers finish what is queued, then joins them. Does nothing the second time.
+	void cleanUp();
+
+private:
+	struct QueuedJob
+	{
+		Job job;
+		JobCounter *pCounter = nullptr;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+	};
+
+	void push(QueuedJob);
+	bool pop(uint32_t queueIndex, QueuedJob &);
+	bool steal(uint32_t thiefIndex, QueuedJob &);
+	bool tryRunOne(uint32_t queueIndex);
+	void finish(JobCounter *);
+
+	void workerLoop(uint32_t queueIndex);
+	uint32_t getQueueIndex() const;
+
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;	// [0] for threads outside the system, then one per worker
+	std::vector<std::thread> mWorkers;
+
+	std::atomic<uint32_t> mQueuedJobs{ 0 };	// Queued and not yet taken by anyone
+
+	// Idle workers sleep on this rather than spin
+	std::mutex mSleepMutex;
+	std::condition_variable mWakeUp;
+	bool mStopping = false;
+};
+
+template<typename Fn>
+void JobSystem::parallelFor(uint32_t count, uint32_t minBatchSize, Fn fn)
+{
+	if (count == 0) {
+		return;
+	}
+
+	minBatchSize = std::max(1u, minBatchSize);
+
+	uint32_t batchCount = std::clamp((count + minBatchSize - 1) / minBatchSize, 1u, getThreadCount());
+	uint32_t batchSize = (count + batchCount - 1) / batchCount;
+
+	JobCounter counter;
+
+	for (uint32_t first = batchSize; first < count; first += batchSize) {
+		uint32_t last = std::min(count, first + batchSize);
+		run([&fn, first, last]() { fn(first, last); }, &counter);
+	}
+
+	// This thread takes the first batch instead of just waiting. The queued jobs point at fn and
+	//  counter on this stack, so they have to be done before an exception can leave.
+	try {
+		fn(0, std::min(count, batchSize));
+	} catch (...) {
+		wait(counter);
+		throw;
+	}
+
+	wait(counter);
+}
+
+#endif // JOB_SYSTEM_H
\ No newline at end of file
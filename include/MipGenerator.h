@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+/**
+ * Where one level of a mip chain lives in a buffer that holds the whole chain, level after
+ *  level. This is the layout MipGenerator writes and VulkanImage::copyBufferToImage reads.
+ */
+struct MipLevel
+{
+	uint32_t width = 0, height = 0;
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+/**
+ * Builds mip chains for 8 bit per channel textures on the CPU. sRGB channels are converted to
+ *  linear light before filtering and back afterwards, alpha is always filtered as is. Levels are
+ *  filtered from the float result of the level above, so rounding doesn't accumulate down the chain.
+ *
+ * Used when the GPU can't blit a texture format, and usable from offline tools since nothing in
+ *  here touches Vulkan. Rows of each level are split across the JobSystem if there is one, the
+ *  renderer always has one. Offline tools without one get threadCount threads of their own.
+ */
+class MipGenerator
+{
+public:
+	enum class Filter
+	{
+		Box,	// 2x2 average, vectorized. The last column and row of an odd size average 3 texels instead
+		Kaiser	// Kaiser windowed sinc, sharper but about 9 times the work
+	};
+
+	// threadCount of 0 uses every hardware thread, it is ignored with a job system
+	explicit MipGenerator(Filter filter = Filter::Box, uint32_t threadCount = 0, JobSystem *pJobSystem = nullptr);
+
+	static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+	static std::vector<MipLevel> getChainLayout(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t channels);
+	// Bytes for the whole chain, padded so chains can be placed back to back, one per array layer
+	static size_t getChainSize(std::vector<MipLevel> const &);
+
+	// pChain holds level 0 at offset 0 and has room for the whole chain; levels 1 and up get filled in.
+	//  channels is 1, 2 or 4; the last channel of 2 and 4 channel data is alpha.
+	void generate(uint8_t *pChain, std::vector<MipLevel> const &, uint32_t channels, bool isSrgb) const;
+
+private:
+	void downsampleBox(float const *, uint32_t, uint32_t, float *, uint32_t, uint32_t, uint32_t) const;
+	void downsampleKaiser(float const *, uint32_t, uint32_t, float *, uint32_t, uint32_t, uint32_t) const;
+
+	// Calls fn(firstRow, lastRow) on the job system, or from up to mThreadCount threads without one
+	template<typename Fn>
+	void forEachRowRange(uint32_t rows, Fn fn) const;
+
+	Filter mFilter;
+	uint32_t mThreadCount;
+	JobSystem *mpJobSystem;
+
+	// Taps of the separable Kaiser kernel, for source texels at distance 0.5, 1.5, 2.5 from the center
+	std::array<float, 3> mKaiserWeights{};
+};
+
+#endif // MIP_GENERATOR_H
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef PER_DRAW_DATA_H
+#define PER_DRAW_DATA_H
+
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+#include <vulkan/vulkan.h>
+
+/**
+ * What changes from one draw to the next. Must match the DrawData block in instance.vert and
+ *  bindless.frag. The model matrix places the whole draw, the instance transforms are relative to it.
+ */
+struct PerDrawData
+{
+	glm::mat4 model{ 1.0f };
+	uint32_t materialIndex = 0;	// Into the bindless texture table
+	uint32_t padding[3] = {};
+};
+
+// maxPushConstantsSize is at least 128 on every device, so there is no fallback for bigger data
+static_assert(sizeof(PerDrawData) <= 128, "PerDrawData has to fit in the push constants every device has!");
+
+/**
+ * Gets PerDrawData to the shaders without writing memory or binding descriptors per draw: it is pushed
+ *  as push constants.
+ *
+ * record() may be called from several recording threads at once.
+ */
+class PerDrawDataBinder
+{
+public:
+	PerDrawDataBinder() = default;
+
+	// The range the shaders declare. Throws if it is bigger than PerDrawData.
+	void setPushConstantRange(VkPushConstantRange const &);
+
+	void record(VkCommandBuffer, VkPipelineLayout, PerDrawData const &) const;
+
+private:
+	VkPushConstantRange mPushConstantRange{};	// Only the stages and bytes the shaders declare are pushed
+};
+
+#endif // PER_DRAW_DATA_H
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef PIPELINE_LAYOUT_CACHE_H
+#define PIPELINE_LAYOUT_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.h"
+
+/**
+ * Descriptor set layouts and pipeline layouts built from ShaderReflection, keyed by a hash of what they
+ *  are made of. Shaders declaring the same bindings get the same VkDescriptorSetLayout, and so the same
+ *  VkPipelineLayout, which also keeps their descriptor sets compatible with each other.
+ *
+ * The cache owns everything it hands out. Set layouts it can't derive from the shaders alone, e.g. the
+ *  update-after-bind one of VulkanBindlessTextures, are passed in as external sets instead.
+ */
+class PipelineLayoutCache
+{
+public:
+	PipelineLayoutCache() = default;
+
+	void lazyInit(VkDevice);
+
+	// The bindings the shaders declare for this set, an empty layout if they declare none
+	VkDescriptorSetLayout getDescriptorSetLayout(ShaderReflection const &, uint32_t set);
+	// For sets written by hand, layouts with the same bindings are the same VkDescriptorSetLayout
+	VkDescriptorSetLayout getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> const &);
+
+	// Every set up to the highest one the shaders use, externalSets replace the derived ones
+	VkPipelineLayout getPipelineLayout(
+		ShaderReflection const &, std::map<uint32_t, VkDescriptorSetLayout> const &externalSets = {} );
+
+	void cleanUp();
+
+private:
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	std::unordered_map<uint64_t, VkDescriptorSetLayout> mSetLayouts;
+	std::unordered_map<uint64_t, VkPipelineLayout> mPipelineLayouts;
+};
+
+#endif // PIPELINE_LAYOUT_CACHE_H
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#ifndef PIPELINE_STATE_CACHE_H
+#define PIPELINE_STATE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+
+/**
+ * Specialization constants by constant_id. All 32 bit: VkBool32 for bool, floats by their bits. The
+ *  driver folds them into the shader when it compiles the pipeline, so branches on them cost nothing.
+ */
+using SpecializationConstants = std::map<uint32_t, uint32_t>;
+
+/**
+ * Everything a graphics pipeline is built from. Render passes only take part through what makes them
+ *  compatible (attachment formats and sample count), so a pipeline keeps being found for a render pass
+ *  that was recreated with the same formats. The same goes for layouts, which are expected to outlive
+ *  the cache.
+ */
+struct GraphicsPipelineDesc
+{
+	std::vector<uint32_t> vertexShader;	// SPIR-V, see ShaderLibrary
+	std::vector<uint32_t> fragmentShader;
+
+	// Variants of the same SPIR-V, a constant left out keeps the shader's default
+	SpecializationConstants vertexConstants;
+	SpecializationConstants fragmentConstants;
+
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	bool depthTest = true;
+	bool depthWrite = true;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	bool blendEnable = false;	// Premultiplied alpha when on
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+
+	// Render pass compatibility
+	std::vector<VkFormat> colorFormats;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	// What the pipeline is created with, not part of the key. VK_NULL_HANDLE for dynamic rendering,
+	//  the pipeline is created against the formats above then.
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+};
+
+/**
+ * Graphics pipelines keyed by a hash of their whole GraphicsPipelineDesc, so asking for the same
+ *  state again gives back the same VkPipeline. Every entry keeps its desc, two states that hash the
+ *  same get the next free key rather than each other's pipeline. Viewport and scissor are dynamic
+ *  state, whoever draws with one of these sets them. A miss is compiled on the JobSystem's workers and
+ *  reads as VK_NULL_HANDLE until it is done; a frame skips what it can't draw yet instead of waiting
+ *  for the driver to compile.
+ *
+ * A compile that fails is reported on std::cerr, and get() hands out the fallback pipeline in its place
+ *  if there is one the render pass is compatible with, see setFallback().
+ *
+ * The render pass of a desc, if it has one, has to stay alive until its compile is done, see waitIdle().
+ */
+class PipelineStateCache
+{
+public:
+	PipelineStateCache() = default;
+
+	void lazyInit(VkDevice, VkPipelineCache, JobSystem &);
+
+	static uint64_t hash(GraphicsPipelineDesc const &);
+
+	// Starts compiling unless the same state is cached or compiling already. Returns the key to look it up with.
+	uint64_t prepare(GraphicsPipelineDesc const &);
+
+	// A pipeline that is known to compile, drawn with in place of one that failed to. Must be prepared.
+	void setFallback(uint64_t key);
+
+	// VK_NULL_HANDLE while still compiling, never blocks. The fallback if the compile failed.
+	VkPipeline get(uint64_t key) const;
+	// Helps compiling until it is done. Throws if it failed.
+	VkPipeline wait(uint64_t key);
+
+	// Waits for every compile still going
+	void waitIdle();
+
+	uint32_t getPipelineCount() const;
+
+	void cleanUp();
+
+private:
+	struct Entry
+	{
+		GraphicsPipelineDesc desc;	// Never changes once the entry is in mEntries
+		JobCounter compiled;
+		VkPipeline pipeline = VK_NULL_HANDLE;	// Only read once ready, VK_NULL_HANDLE then if it failed
+		std::atomic<bool> ready{ false };
+	};
+
+	VkPipeline compile(GraphicsPipelineDesc const &) const;
+	VkShaderModule createShaderModule(std::vector<uint32_t> const &) const;
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+	JobSystem *mpJobSystem = nullptr;
+
+	mutable std::mutex mMutex;	// Guards mEntries, not what is in them
+	std::unordered_map<uint64_t, std::unique_ptr<Entry>> mEntries;
+	Entry const *mpFallback = nullptr;
+};
+
+#endif // PIPELINE_STATE_CACHE_H
\ No newline at end of file
@@ -0,0 +1,245 @@
+#pragma once
+
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "BarrierBatcher.h"
+#include "ResourceUsage.h"
+
+class VulkanDeviceFeatures;
+
+/**
+ * The frame as a list of passes that declare which images and buffers they read and write, in the
+ *  order they run. compile() works out everything that follows from those declarations once:
+ *   - the pipeline barriers and layout transitions before each pass, one barrier command per pass.
+ *     With synchronization2 that is vkCmdPipelineBarrier2, each barrier with its own narrow stage masks.
+ *   - a render pass per graphics pass, with load and store ops picked from whether the contents
+ *     are needed before and after it. With dynamic rendering the same ops are given to
+ *     vkCmdBeginRendering instead, and there are no render passes or framebuffers at all.
+ *   - memory for the graph's own (transient) images, where images that are never alive at the same
+ *     time share one allocation
+ * execute() then only records, and can be called every frame.
+ *
+ * Imported resources are owned elsewhere, e.g. the swap chain images; their handles can change
+ *  between executes. Transient images are synchronized against their own use in the previous
+ *  execute too, since frames in flight overlap.
+ *
+ * Without a device compile() only plans, so dump() can be checked without a GPU.
+ */
+class RenderGraph
+{
+public:
+	enum class PassType
+	{
+		Graphics,
+		Compute,
+		Transfer
+	};
+
+	struct ImageDesc
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	// What a pass callback gets to record with; render pass and framebuffer only for graphics passes
+	//  without dynamic rendering
+	struct PassContext
+	{
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		VkExtent2D extent{};
+
+		// What secondaries recorded inside a graphics pass are begun with, either way. Only valid
+		//  during the callback.
+		VkCommandBufferInheritanceInfo inheritance{};
+	};
+
+	// Graphics passes are already inside their render pass when this is called
+	using ExecuteFn = std::function<void(VkCommandBuffer, PassContext const &)>;
+
+	RenderGraph() = default;
+
+	void lazyInit(VkPhysicalDevice, VkDevice);
+
+	// Graphics passes begin with vkCmdBeginRendering instead of a render pass, if the device has it.
+	//  Before compile(), which then creates no render passes.
+	void useDynamicRendering(VulkanDeviceFeatures const &);
+	bool usesDynamicRendering() const;
+
+	// Record barriers with vkCmdPipelineBarrier2 if the device has synchronization2
+	void useSynchronization2(VulkanDeviceFeatures const &);
+	bool usesSynchronization2() const { return mBarrierBatcher.usesSynchronization2(); }
+
+	// Barriers execute() recorded so far, reset its stats to count over a stretch of frames
+	BarrierBatcher &getBarrierBatcher() { return mBarrierBatcher; }
+
+	// Transient image, created and owned by the graph
+	uint32_t createImage(std::string name, ImageDesc const &);
+	// initialUsage is how the image is left before the graph runs, finalUsage how the graph leaves it.
+	//  Without preserveContents whatever is in the image at the start may be thrown away.
+	uint32_t importImage(
+		std::string name, ImageDesc const &, ResourceUsage initialUsage, ResourceUsage finalUsage, bool preserveContents );
+	uint32_t importBuffer(std::string name, ResourceUsage initialUsage, ResourceUsage finalUsage);
+
+	void setImportedImage(uint32_t resource, VkImage, VkImageView);
+	void setImportedBuffer(uint32_t resource, VkBuffer);
+
+	// contents is VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the graphics pass records into secondaries
+	uint32_t addPass(
+		std::string name, PassType, ExecuteFn, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE );
+
+	// Attachments of a graphics pass, in attachment order. A clear value means loadOp clear.
+	void writeColor(uint32_t pass, uint32_t image, std::optional<VkClearColorValue> clear = std::nullopt);
+	void writeDepth(uint32_t pass, uint32_t image, std::optional<VkClearDepthStencilValue> clear = std::nullopt);
+	void readDepth(uint32_t pass, uint32_t image);
+
+	// Any use that isn't an attachment: sampling, storage, transfers, vertex/index/indirect buffers
+	void use(uint32_t pass, uint32_t resource, ResourceUsage);
+
+	void compile();
+	void execute(VkCommandBuffer);
+
+	// VK_NULL_HANDLE with dynamic rendering, create pipelines against the attachment formats then
+	VkRenderPass getRenderPass(uint32_t pass) const { return mPasses[pass].renderPass; }
+
+	// Gives every image the new extent and recreates the transient images and framebuffers. Passes,
+	//  barriers and render passes stay as compiled, so this is all a window resize needs as long as
+	//  the formats are the same.
+	void resize(VkExtent2D);
+
+	// Barriers, attachment ops and aliasing as compile() derived them, one line each
+	std::string dump() const;
+
+	// Destroys what compile() created and forgets all passes and resources, e.g. to declare the
+	//  graph again for a new swap chain
+	void cleanUp();
+
+private:
+	struct Resource
+	{
+		std::string name;
+		bool isImage = true;
+		bool isImported = false;
+
+		ImageDesc desc;
+		ResourceUsage initialUsage = ResourceUsage::Present;
+		ResourceUsage finalUsage = ResourceUsage::Present;
+		bool preserveContents = false;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		// Derived by compile()
+		uint32_t firstPass = UINT32_MAX, lastPass = 0;
+		ResourceUsage lastUsage = ResourceUsage::Present;
+		VkImageUsageFlags imageUsage = 0;
+		uint32_t aliasGroup = UINT32_MAX;
+	};
+
+	struct Access
+	{
+		uint32_t resource;
+		ResourceUsage usage;
+		bool isAttachment;
+		std::optional<VkClearValue> clear;
+	};
+
+	// Masks follow from the usages, BarrierBatcher picks them for the barrier command it records
+	struct Barrier
+	{
+		uint32_t resource;
+		VkImageLayout oldLayout, newLayout;
+		ResourceUsageSet srcUsages;
+		ResourceUsage dstUsage;
+	};
+
+	struct Attachment
+	{
+		uint32_t resource;
+		VkImageLayout layout;
+		VkAttachmentLoadOp loadOp;
+		VkAttachmentStoreOp storeOp;
+		VkClearValue clear;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		PassType type;
+		ExecuteFn execute;
+		VkSubpassContents contents;
+		std::vector<Access> accesses;
+
+		// Derived by compile()
+		std::vector<Barrier> barriers;
+		std::vector<Attachment> attachments;
+		VkExtent2D extent{};
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+
+		// The views change with the imported images, one framebuffer for each combination seen so far
+		std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+	};
+
+	// Transient images that are never alive at the same time, they share one allocation
+	struct AliasGroup
+	{
+		std::vector<uint32_t> resources;	// In order of use
+	};
+
+	// What the last uses since the last write were, to derive the next barrier from
+	struct ResourceState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		ResourceUsageSet writeUsages = 0;
+		ResourceUsageSet readUsages = 0;
+		bool hasContents = false;
+	};
+
+	void addAccess(uint32_t pass, uint32_t resource, ResourceUsage, bool isAttachment, std::optional<VkClearValue>);
+
+	void planLifetimes();
+	void planAliasing();
+	void planBarriers();
+	bool transition(uint32_t resource, ResourceState &, ResourceUsage, Barrier &) const;
+
+	void createTransientImages();
+	void destroyTransientImages();
+	void destroyFramebuffers();
+	void createRenderPass(Pass &);
+	VkFramebuffer getFramebuffer(Pass &);
+	void executeRenderPass(VkCommandBuffer, Pass &);
+	void executeDynamicRendering(VkCommandBuffer, Pass &);
+	void recordBarriers(VkCommandBuffer, std::vector<Barrier> const &);
+
+	VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	std::vector<Resource> mResources;
+	std::vector<Pass> mPasses;
+	std::vector<AliasGroup> mAliasGroups;
+	std::vector<VkDeviceMemory> mTransientMemory;
+	std::vector<Barrier> mFinalBarriers;	// Into the imported resources' final usage, after the last pass
+
+	bool mIsCompiled = false;
+
+	BarrierBatcher mBarrierBatcher;
+
+#ifdef VK_KHR_dynamic_rendering
+	PFN_vkCmdBeginRenderingKHR mpfnCmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR mpfnCmdEndRendering = nullptr;
+#endif
+};
+
+#endif // RENDER_GRAPH_H
\ No newline at end of file
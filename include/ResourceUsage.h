@@ -0,0 +1,285 @@
+#pragma once
+
+#ifndef RESOURCE_USAGE_H
+#define RESOURCE_USAGE_H
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * The ways a pass can use an image or buffer. Everything Vulkan needs to synchronize a use, i.e.
+ *  which stages touch the resource, how, and in what layout, follows from it, so barriers are
+ *  derived from pairs of these instead of being written out by hand.
+ */
+enum class ResourceUsage
+{
+	ColorAttachmentWrite,
+	DepthStencilAttachmentWrite,
+	DepthStencilAttachmentRead,	// Depth tested but not written
+	FragmentShaderSampled,
+	ComputeShaderSampled,
+	ComputeShaderStorageRead,
+	ComputeShaderStorageWrite,
+	TransferSrc,
+	TransferDst,
+	IndirectCommandRead,
+	VertexBufferRead,
+	IndexBufferRead,
+	UniformBufferRead,	// Vertex and fragment shaders
+	Present
+};
+
+struct ResourceUsageInfo
+{
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	VkImageLayout layout;	// Ignored for buffers
+	VkImageUsageFlags imageUsage;
+	bool isWrite;
+};
+
+inline ResourceUsageInfo getResourceUsageInfo(ResourceUsage usage)
+{
+	switch (usage) {
+	case ResourceUsage::ColorAttachmentWrite:
+		return {
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, // Blending and loadOp load read it
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			true
+		};
+	case ResourceUsage::DepthStencilAttachmentWrite:
+		return {
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			true
+		};
+	case ResourceUsage::DepthStencilAttachmentRead:
+		return {
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			false
+		};
+	case ResourceUsage::FragmentShaderSampled:
+		return {
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT,
+			false
+		};
+	case ResourceUsage::ComputeShaderSampled:
+		return {
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT,
+			false
+		};
+	case ResourceUsage::ComputeShaderStorageRead:
+		return {
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_USAGE_STORAGE_BIT,
+			false
+		};
+	case ResourceUsage::ComputeShaderStorageWrite:
+		return {
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_USAGE_STORAGE_BIT,
+			true
+		};
+	case ResourceUsage::TransferSrc:
+		return {
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			false
+		};
+	case ResourceUsage::TransferDst:
+		return {
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			true
+		};
+	case ResourceUsage::IndirectCommandRead:
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false };
+	case ResourceUsage::VertexBufferRead:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false };
+	case ResourceUsage::IndexBufferRead:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false };
+	case ResourceUsage::UniformBufferRead:
+		return {
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_UNIFORM_READ_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			0,
+			false
+		};
+	case ResourceUsage::Present:
+		// The acquire semaphore is waited on at color attachment output, so that is where the first
+		//  transition out of it has to start for the two to chain. Presenting needs no access.
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false };
+	}
+
+	return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, 0, true };
+}
+
+// Several usages at once, one bit per ResourceUsage, e.g. every read since the last write
+using ResourceUsageSet = uint32_t;
+
+inline ResourceUsageSet toUsageSet(ResourceUsage usage)
+{
+	return 1u << static_cast<uint32_t>(usage);
+}
+
+struct ResourceUsageMasks
+{
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+};
+
+/**
+ * Stages and access of every usage in the set together. The source side of a barrier only has to
+ *  make writes available, reads have nothing to flush, so it passes writesOnly.
+ */
+inline ResourceUsageMasks getResourceUsageMasks(ResourceUsageSet usages, bool writesOnly)
+{
+	const VkAccessFlags kWriteAccess =
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT |
+		VK_ACCESS_HOST_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT;
+
+	ResourceUsageMasks masks{ 0, 0 };
+
+	for (uint32_t i = 0; (usages >> i) != 0; ++i) {
+		if ((usages & (1u << i)) == 0) {
+			continue;
+		}
+
+		ResourceUsageInfo info = getResourceUsageInfo(static_cast<ResourceUsage>(i));
+		masks.stages |= info.stages;
+
+		if (!writesOnly) {
+			masks.access |= info.access;
+		} else if (info.isWrite) {
+			masks.access |= info.access & kWriteAccess;
+		}
+	}
+
+	return masks;
+}
+
+#ifdef VK_KHR_synchronization2
+struct ResourceUsageMasks2
+{
+	VkPipelineStageFlags2KHR stages;
+	VkAccessFlags2KHR access;
+};
+
+/**
+ * The same usages with synchronization2's finer bits: index and vertex fetch are separate stages, and
+ *  sampled reads, storage reads and storage writes separate accesses. Transfers stay ALL_TRANSFER,
+ *  TransferDst also covers vkCmdFillBuffer, which isn't a copy.
+ */
+inline ResourceUsageMasks2 getResourceUsageMasks2(ResourceUsage usage)
+{
+	switch (usage) {
+	case ResourceUsage::ColorAttachmentWrite:
+		return {
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+			VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR
+		};
+	case ResourceUsage::DepthStencilAttachmentWrite:
+		return {
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR
+		};
+	case ResourceUsage::DepthStencilAttachmentRead:
+		return {
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR
+		};
+	case ResourceUsage::FragmentShaderSampled:
+		return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR };
+	case ResourceUsage::ComputeShaderSampled:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR };
+	case ResourceUsage::ComputeShaderStorageRead:
+		return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR };
+	case ResourceUsage::ComputeShaderStorageWrite:
+		return {
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR
+		};
+	case ResourceUsage::TransferSrc:
+		return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR };
+	case ResourceUsage::TransferDst:
+		return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR };
+	case ResourceUsage::IndirectCommandRead:
+		return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR };
+	case ResourceUsage::VertexBufferRead:
+		return { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR };
+	case ResourceUsage::IndexBufferRead:
+		return { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, VK_ACCESS_2_INDEX_READ_BIT_KHR };
+	case ResourceUsage::UniformBufferRead:
+		return {
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+			VK_ACCESS_2_UNIFORM_READ_BIT_KHR
+		};
+	case ResourceUsage::Present:
+		// Chains with the acquire semaphore, see getResourceUsageInfo
+		return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_NONE_KHR };
+	}
+
+	return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR };
+}
+
+// As getResourceUsageMasks, an empty set is VK_PIPELINE_STAGE_2_NONE, which synchronization2 allows
+inline ResourceUsageMasks2 getResourceUsageMasks2(ResourceUsageSet usages, bool writesOnly)
+{
+	const VkAccessFlags2KHR kWriteAccess =
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR |
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR |
+		VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR |
+		VK_ACCESS_2_HOST_WRITE_BIT_KHR |
+		VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+	ResourceUsageMasks2 masks{ VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR };
+
+	for (uint32_t i = 0; (usages >> i) != 0; ++i) {
+		if ((usages & (1u << i)) == 0) {
+			continue;
+		}
+
+		ResourceUsage usage = static_cast<ResourceUsage>(i);
+		ResourceUsageMasks2 usageMasks = getResourceUsageMasks2(usage);
+		masks.stages |= usageMasks.stages;
+
+		if (!writesOnly) {
+			masks.access |= usageMasks.access;
+		} else if (getResourceUsageInfo(usage).isWrite) {
+			masks.access |= usageMasks.access & kWriteAccess;
+		}
+	}
+
+	return masks;
+}
+#endif
+
+#endif // RESOURCE_USAGE_H
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The SPIR-V of every shader in resources/shaders, by the name of its .spv (see compile.bat). The CMake
+ *  build compiles the GLSL with glslangValidator and embeds the words in the executable, so loading
+ *  a shader neither touches the disk nor depends on the working directory.
+ *
+ * Builds without it, e.g. the Visual Studio project or CMake without glslangValidator, read the .spv
+ *  that compile.bat left in the given directory instead.
+ */
+class ShaderLibrary
+{
+public:
+	// Throws if there is no shader of that name
+	static std::vector<uint32_t> load(std::string const &name, std::string const &directory);
+
+	// Whether this build has the shaders compiled in
+	static bool isEmbedded();
+};
+
+#endif // SHADER_LIBRARY_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * What a shader expects to be bound, read straight from its SPIR-V: descriptor bindings, push constant
+ *  ranges and vertex inputs. Reflect each stage of a pipeline and merge them, PipelineLayoutCache turns
+ *  the result into the set layouts and the pipeline layout, so those can't disagree with the shaders.
+ *
+ * Only the parts of SPIR-V needed for that are parsed: decorations, types, constants and variables.
+ */
+class ShaderReflection
+{
+public:
+	struct Binding
+	{
+		uint32_t set = 0;
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		uint32_t count = 1;	// 0 for a runtime sized array
+		VkShaderStageFlags stages = 0;
+	};
+
+	struct VertexInput
+	{
+		uint32_t location = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+	};
+
+	ShaderReflection() = default;
+
+	// Throws if the code isn't SPIR-V or uses a resource this doesn't know how to bind
+	static ShaderReflection reflect(std::vector<uint32_t> const &code);
+
+	// Adds the other stages' bindings and push constants, bindings both declare have to be of the same type
+	void merge(ShaderReflection const &);
+
+	// Throws unless every vertex input is fed by one of the attributes, in the format the shader reads
+	void checkVertexInputs(std::vector<VkVertexInputAttributeDescription> const &) const;
+
+	// Sorted by set, then binding
+	std::vector<Binding> const &getBindings() const { return mBindings; }
+	// At most one, covering what all stages declare
+	std::vector<VkPushConstantRange> const &getPushConstantRanges() const { return mPushConstantRanges; }
+	// Vertex stage only, a matrix takes one location per column
+	std::vector<VertexInput> const &getVertexInputs() const { return mVertexInputs; }
+
+	VkShaderStageFlags getStages() const { return mStages; }
+
+	bool hasBinding(uint32_t set, uint32_t binding) const;
+
+private:
+	void addBinding(Binding const &);
+	void addPushConstantRange(VkPushConstantRange const &);
+
+	VkShaderStageFlags mStages = 0;
+
+	std::vector<Binding> mBindings;
+	std::vector<VkPushConstantRange> mPushConstantRanges;
+	std::vector<VertexInput> mVertexInputs;
+};
+
+#endif // SHADER_REFLECTION_H
\ No newline at end of file
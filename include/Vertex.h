@@ -4,6 +4,7 @@
 #define VERTEX_H
 
 #include <array>
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <vulkan/vulkan.h>
@@ -26,6 +27,19 @@ struct Vertex
 	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
 };
 
+/**
+ * Per-instance vertex data, read from binding 1 once per instance instead of once per vertex.
+ *  The draw's firstInstance is where its instances start in the bound buffer.
+ */
+struct InstanceData
+{
+	glm::mat4 model;
+
+	static VkVertexInputBindingDescription getBindingDescription();
+	// A mat4 takes 4 locations, one per column, starting right after Vertex's
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+};
+
 namespace std
 {
 	template<> struct hash<Vertex>
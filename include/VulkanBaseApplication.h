@@ -6,6 +6,11 @@
 #include <vector>
 #include <vulkan/vulkan.h>
 
+// Highest Vulkan version the application asks for, normally set by CMake through VULKAN_API_VERSION
+#ifndef VULKAN_BASE_VK_API_VERSION
+#define VULKAN_BASE_VK_API_VERSION VK_API_VERSION_1_2
+#endif
+
 extern const bool enableValidationLayers;
 extern const std::vector<const char *> validationLayers;
 
@@ -19,6 +24,8 @@ private:
 	bool checkValidationLayerSupport();
 
 public:
+	static uint32_t queryInstanceApiVersion();
+
 	void createVulkanInstance
 		(const VkApplicationInfo *, std::vector<const char *> const &);
 
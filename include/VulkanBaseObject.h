@@ -14,9 +14,13 @@ public:
 
 	VkDeviceMemory getMemoryHandle() const { return mMemoryHandle; }
 
+	// Also for memory that isn't owned by one object, like aliased render graph images
+	static uint32_t findMemoryType(
+		VkPhysicalDevice const &, uint32_t, VkMemoryPropertyFlags, VkMemoryPropertyFlags preferredProperties = 0);
+
 protected:
-	void allocateMemory(VkMemoryRequirements, VkMemoryPropertyFlags);
-	uint32_t findMemoryType(VkPhysicalDevice const &, uint32_t, VkMemoryPropertyFlags);
+	// preferredProperties are added on top of the required ones when some memory type has them all
+	void allocateMemory(VkMemoryRequirements, VkMemoryPropertyFlags, VkMemoryPropertyFlags preferredProperties = 0);
 
 	VkDevice mLogicalDevice = VK_NULL_HANDLE;
 	VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
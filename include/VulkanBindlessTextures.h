@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef VULKAN_BINDLESS_TEXTURES_H
+#define VULKAN_BINDLESS_TEXTURES_H
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * One global descriptor set that holds every texture of the scene in a single runtime sized
+ *  sampler2D array. It is bound once per command buffer; a material only pushes the index of
+ *  its texture instead of binding a descriptor set of its own.
+ *
+ * The binding is update-after-bind and partially bound, so textures can be added and removed
+ *  while command buffers using the set are pending, as long as those command buffers never
+ *  sample the slots being changed.
+ *
+ * Needs descriptor indexing, check VulkanDeviceFeatures::supportsBindlessTextures() first.
+ */
+class VulkanBindlessTextures
+{
+public:
+	VulkanBindlessTextures() = default;
+
+	void lazyInit(VkDevice, uint32_t capacity);
+
+	// Returns the index the shaders use to look the texture up
+	uint32_t addTexture(VkImageView, VkSampler);
+	// The slot is handed out again by the next addTexture, so nothing in flight may still sample it
+	void removeTexture(uint32_t);
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const { return mDescriptorSetLayout; }
+	VkDescriptorSet getDescriptorSet() const { return mDescriptorSet; }
+
+	void cleanUp()
+	{
+		// The set itself is freed along with the pool
+		vkDestroyDescriptorPool(mLogicalDevice, mDescriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(mLogicalDevice, mDescriptorSetLayout, nullptr);
+	}
+
+private:
+	void createDescriptorSetLayout();
+	void createDescriptorSet();
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet mDescriptorSet = VK_NULL_HANDLE;
+
+	uint32_t mCapacity = 0;
+	uint32_t mNextIndex = 0;
+	std::vector<uint32_t> mFreeIndices;
+};
+
+#endif // VULKAN_BINDLESS_TEXTURES_H
\ No newline at end of file
@@ -21,7 +21,8 @@ public:
 		VkPhysicalDevice,
 		VkDeviceSize,
 		VkBufferUsageFlags,
-		VkMemoryPropertyFlags
+		VkMemoryPropertyFlags,
+		VkMemoryPropertyFlags preferredProperties = 0
 	);
 
 	VulkanBuffer(VulkanBuffer const &vulkanBuffer) = delete;
@@ -33,10 +34,17 @@ public:
 		VkPhysicalDevice,
 		VkDeviceSize,
 		VkBufferUsageFlags,
-		VkMemoryPropertyFlags
+		VkMemoryPropertyFlags,
+		VkMemoryPropertyFlags preferredProperties = 0
 	);
 
 	void uploadData(void *, VkDeviceSize);
+
+	// Maps the whole buffer and keeps it mapped until unmap() or cleanUp(), so it can be written
+	//  (e.g. decoded into) directly instead of going through uploadData. Needs host visible memory.
+	void *map();
+	void unmap();
+
 	void cleanUp();
 
 	VkBuffer getBufferHandle() const { return mBuffer; }
@@ -48,6 +56,9 @@ private:
 	VkDeviceSize mSize = 0;
 	VkBufferUsageFlags mUsage;
 	VkMemoryPropertyFlags mProperties;
+	VkMemoryPropertyFlags mPreferredProperties = 0;
+
+	void *mpMappedMemory = nullptr;
 };
 
 #endif // VULKAN_BUFFER_H
\ No newline at end of file
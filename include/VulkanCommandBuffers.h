@@ -3,10 +3,84 @@
 #ifndef VULKAN_COMMAND_BUFFERS_H
 #define VULKAN_COMMAND_BUFFERS_H
 
+#include <cstdint>
+#include <vector>
+
 #include <vulkan/vulkan.h>
 
-// Remember this commmand buffer is short-lived
-VkCommandBuffer beginSingleTimeCommands(VkDevice, VkCommandPool);
-void endSingleTimeCommands(VkDevice, VkCommandPool, VkQueue, VkCommandBuffer);
+#include "VulkanTimeline.h"
+
+/**
+ * Waitable handle to one submission of a SingleTimeCommandPool. A default constructed one
+ *  stands for nothing submitted and is always complete.
+ */
+struct SingleTimeSubmission
+{
+	uint32_t slot = UINT32_MAX;
+	uint64_t generation = 0;
+	uint64_t timelineValue = 0;	// Where the submission lands on the pool's timeline, 0 without one
+};
+
+/**
+ * For short-lived command buffers: uploads, copies, layout transitions. Command buffers and their
+ *  fences are recycled instead of allocated and freed each time, and submitting doesn't wait, so
+ *  the CPU can get on with e.g. decoding the next texture while the GPU copies the last one.
+ *  Wait on the returned handle before touching anything the commands use, like a staging buffer.
+ *
+ * Submissions go to one queue in order, so later ones can depend on earlier ones through plain
+ *  pipeline barriers without waiting in between. Given a timeline, submissions are tracked by its
+ *  values instead of a fence each, so e.g. a staging buffer can go on the timeline's deletion queue.
+ *
+ * Not thread safe, give each thread that uploads its own pool.
+ */
+class SingleTimeCommandPool
+{
+public:
+	SingleTimeCommandPool() = default;
+
+	// pTimeline has to submit to the same queue, or be nullptr to track submissions with fences
+	void lazyInit(VkDevice, uint32_t queueFamilyIndex, VkQueue, VulkanTimeline *pTimeline = nullptr);
+
+	// Returns a command buffer that is recording, hand it to submit() or end() when done
+	VkCommandBuffer begin();
+
+	SingleTimeSubmission submit(VkCommandBuffer);
+	// Submit and wait right away
+	void end(VkCommandBuffer commandBuffer) { wait(submit(commandBuffer)); }
+
+	void wait(SingleTimeSubmission);
+	bool isComplete(SingleTimeSubmission);
+
+	// The device has to be idle, or at least done with everything submitted from here
+	void cleanUp();
+
+private:
+	enum class SlotState
+	{
+		Free,
+		Recording,
+		Pending
+	};
+
+	struct Slot
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;	// Only without a timeline
+		uint64_t timelineValue = 0;
+		SlotState state = SlotState::Free;
+		uint64_t generation = 0; // Bumped whenever the slot is recycled, so stale handles count as complete
+	};
+
+	uint32_t acquireSlot();
+	bool isSlotDone(Slot const &);
+	void recycle(Slot &);
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	VkQueue mQueue = VK_NULL_HANDLE;
+	VkCommandPool mCommandPool = VK_NULL_HANDLE;
+	VulkanTimeline *mpTimeline = nullptr;
+
+	std::vector<Slot> mSlots;
+};
 
 #endif // VULKAN_COMMAND_BUFFERS_H
\ No newline at end of file
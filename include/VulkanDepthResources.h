@@ -14,8 +14,8 @@ public:
 	VulkanDepthResources() = default;
 
 	// This is not ready. Idk in what situation to use this constructor.
-	VulkanDepthResources(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool commandPool, VkQueue queue)
-		: VulkanImage(physicalDevice, logicalDevice, commandPool, queue) {}
+	VulkanDepthResources(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, SingleTimeCommandPool &singleTimeCommands)
+		: VulkanImage(physicalDevice, logicalDevice, singleTimeCommands) {}
 
 	// Copy assignment
 	VulkanDepthResources &operator=(const VulkanDepthResources &) = delete;
@@ -26,7 +26,7 @@ public:
 	VkAttachmentDescription getDepthAttachmentDescription(VkPhysicalDevice) const;
 	VkAttachmentReference getDepthAttachmentReference() const;
 
-	void lazyInit(VkPhysicalDevice, VkDevice, VkCommandPool, VkQueue, uint32_t, uint32_t);
+	void lazyInit(VkPhysicalDevice, VkDevice, SingleTimeCommandPool &, uint32_t, uint32_t);
 
 	void cleanUp()
 	{
@@ -40,12 +40,7 @@ private:
 	{
 		assert(physicalDevice != VK_NULL_HANDLE && "Physical device handle is null!");
 
-		return vkutils::findSupportedFormat(
-			physicalDevice,
-			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
-		);
+		return vkutils::findDepthFormat(physicalDevice);
 	}
 };
 
@@ -3,6 +3,10 @@
 #ifndef VULKAN_DEVICES_H
 #define VULKAN_DEVICES_H
 
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
 class VulkanLogicalDevice
 {
 
@@ -13,4 +17,80 @@ class VulkanPhysicalDevice
 
 };
 
+/**
+ * Optional device features that the renderer takes advantage of when they are there, with the
+ *  older path used otherwise. Query once right after picking the physical device; the same
+ *  object then hands the feature structs and extension names to vkCreateDevice, so what we
+ *  check for and what we enable can't drift apart.
+ */
+class VulkanDeviceFeatures
+{
+public:
+	VulkanDeviceFeatures() = default;
+
+	void query(VkInstance, VkPhysicalDevice, uint32_t instanceApiVersion);
+
+	// Extensions to enable on top of the required ones
+	const std::vector<const char *> &getExtensions() const { return mExtensions; }
+	// pNext chain for VkDeviceCreateInfo, nullptr if nothing optional is enabled
+	void *getCreateInfoChain();
+	// Turns on the optional 1.0 features found, on top of the required ones already set
+	void enableCoreFeatures(VkPhysicalDeviceFeatures &) const;
+
+	// Lower of the instance and device versions, with the patch number dropped
+	uint32_t getApiVersion() const { return mApiVersion; }
+
+	bool supportsBindlessTextures() const { return mBindlessTextures; }
+	uint32_t getMaxBindlessTextures() const { return mMaxBindlessTextures; }
+
+	// Core in 1.2, VK_KHR_timeline_semaphore before that. The entry points have a KHR suffix then.
+	bool supportsTimelineSemaphores() const { return mTimelineSemaphores; }
+
+	// Core in 1.1. 1.0 devices don't get VK_KHR_descriptor_update_template, they write descriptors one by one
+	bool supportsDescriptorUpdateTemplates() const { return mApiVersion >= VK_API_VERSION_1_1; }
+
+	// Core in 1.3, VK_KHR_dynamic_rendering on 1.2, which has the extensions it depends on. The entry
+	//  points have a KHR suffix then. Always false with headers too old to know the extension.
+	bool supportsDynamicRendering() const { return mDynamicRendering; }
+
+	// Core in 1.3, VK_KHR_synchronization2 before that, with KHR suffixed entry points. Barriers carry
+	//  their own 64 bit stage masks. Always false with headers too old to know the extension.
+	bool supportsSynchronization2() const { return mSynchronization2; }
+
+	// Indirect draws can start at an instance other than 0, which is how they pick their per-instance data
+	bool supportsDrawIndirectFirstInstance() const { return mDrawIndirectFirstInstance; }
+	// More than one draw per vkCmdDrawIndexedIndirect
+	bool supportsMultiDrawIndirect() const { return mMultiDrawIndirect; }
+	// VK_KHR_draw_indirect_count, the draw count is read from a buffer. Load the KHR entry points for it.
+	bool supportsDrawIndirectCount() const { return mDrawIndirectCount; }
+
+private:
+	bool hasExtension(const char *) const;
+
+	uint32_t mApiVersion = VK_API_VERSION_1_0;
+	std::vector<VkExtensionProperties> mAvailableExtensions;
+	std::vector<const char *> mExtensions;
+
+	bool mBindlessTextures = false;
+	uint32_t mMaxBindlessTextures = 0;
+	VkPhysicalDeviceDescriptorIndexingFeatures mDescriptorIndexing{};
+
+	bool mTimelineSemaphores = false;
+	VkPhysicalDeviceTimelineSemaphoreFeatures mTimelineSemaphore{};
+
+	bool mDynamicRendering = false;
+#ifdef VK_KHR_dynamic_rendering
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR mDynamicRenderingFeatures{};
+#endif
+
+	bool mSynchronization2 = false;
+#ifdef VK_KHR_synchronization2
+	VkPhysicalDeviceSynchronization2FeaturesKHR mSynchronization2Features{};
+#endif
+
+	bool mDrawIndirectFirstInstance = false;
+	bool mMultiDrawIndirect = false;
+	bool mDrawIndirectCount = false;
+};
+
 #endif // VULKAN_DEVICES_H
\ No newline at end of file
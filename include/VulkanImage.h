@@ -4,19 +4,29 @@
 #define VULKAN_IMAGE_H
 
 #include <stdexcept>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
+#include "MipGenerator.h"
 #include "VulkanBaseObject.h"
+#include "VulkanCommandBuffers.h"
 
-VkImageView createImageView(VkDevice, VkImage, VkFormat, VkImageAspectFlags, uint32_t);
+VkImageView createImageView(
+	VkDevice,
+	VkImage,
+	VkFormat,
+	VkImageAspectFlags,
+	uint32_t,
+	VkComponentMapping components = {}
+);
 
 class VulkanImage : public VulkanBaseObject
 {
 public:
 	VulkanImage() = default;
-	VulkanImage(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool commandPool, VkQueue queue)
-		: VulkanBaseObject(physicalDevice, logicalDevice), mCommandPool(commandPool), mQueue(queue) {};
+	VulkanImage(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, SingleTimeCommandPool &singleTimeCommands)
+		: VulkanBaseObject(physicalDevice, logicalDevice), mpSingleTimeCommands(&singleTimeCommands) {};
 
 	VkImageView getImageView() const { return mImageView; }
 
@@ -25,17 +35,31 @@ protected:
 
 	void createPersistentImageView(VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 	{
-		mImageView = createImageView(mLogicalDevice, mImage, mFormat, aspectFlags, mipLevels);
+		mImageView = createImageView(mLogicalDevice, mImage, mFormat, aspectFlags, mipLevels, mComponents);
 	}
 
-	void transitionImageLayout(VkImageLayout, VkImageLayout, uint32_t);
+	// These only submit, wait on the result before touching what the commands use. Commands that
+	//  come later in the same pool are ordered after them by their barriers already.
+
+	// One copy region per level, at the offsets in levels. The layout transitions around it go in the same submission: the image's contents are thrown away, and
+	//  if levels covers all mipLevels it is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Otherwise
+	//  every level stays in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL for generateMipmaps.
+	SingleTimeSubmission copyBufferToImage(
+		VkBuffer, std::vector<MipLevel> const &, uint32_t mipLevels );
+
+	// Whether generateMipmaps works for mFormat. Otherwise the levels are built by a MipGenerator
+	//  and uploaded along with level 0.
+	bool canBlitMipmaps() const;
+
+	// Blit every mip level down from the one above it. Leaves the whole image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	SingleTimeSubmission generateMipmaps(uint32_t width, uint32_t height, uint32_t mipLevels);
 
 	VkImage mImage = VK_NULL_HANDLE;
 	VkImageView mImageView = VK_NULL_HANDLE;
 	VkFormat mFormat = VK_FORMAT_UNDEFINED;
+	VkComponentMapping mComponents{}; // All identity
 
-	VkCommandPool mCommandPool = VK_NULL_HANDLE;
-	VkQueue mQueue = VK_NULL_HANDLE;
+	SingleTimeCommandPool *mpSingleTimeCommands = nullptr;
 };
 
 #endif // VULKAN_IMAGE_VIEW_H
\ No newline at end of file
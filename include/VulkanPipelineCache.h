@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef VULKAN_PIPELINE_CACHE_H
+#define VULKAN_PIPELINE_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/**
+ * A VkPipelineCache that outlives the process. The file from the last run is only handed to the
+ *  driver if its header was written by the same driver for the same device (vendor ID, device ID and
+ *  pipeline cache UUID), anything else starts the cache empty. The driver validates the rest itself.
+ *
+ * Every pipeline should be created with getHandle(), so both launching again and recreating the swap
+ *  chain skip compiling shaders that were already compiled.
+ */
+class VulkanPipelineCache
+{
+public:
+	VulkanPipelineCache() = default;
+
+	// A missing or unusable file is not an error, the cache just starts cold
+	void lazyInit(VkPhysicalDevice, VkDevice, std::string const &path);
+
+	VkPipelineCache getHandle() const { return mPipelineCache; }
+
+	// Whether the file from the last run was accepted
+	bool isWarm() const { return mIsWarm; }
+
+	// Writes what the cache holds now to the file, overwriting it
+	void save() const;
+
+	void cleanUp();
+
+private:
+	bool isCompatible(std::vector<char> const &data) const;
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties mProperties{};
+	std::string mPath;
+
+	VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+	bool mIsWarm = false;
+};
+
+#endif // VULKAN_PIPELINE_CACHE_H
\ No newline at end of file
@@ -5,17 +5,75 @@
 
 #include <string>
 
+#include "JobSystem.h"
 #include "VulkanBaseObject.h"
 #include "VulkanImage.h"
 
+typedef unsigned char stbi_uc;
+
+namespace vkTextureUtils
+{
+	/**
+	 * How the texel values are meant to be read. Color textures (albedo, emissive) are sRGB
+	 *  encoded; data textures (normal, roughness, AO, height, masks) are linear and must not be
+	 *  converted when sampled.
+	 */
+	enum class TextureUsage
+	{
+		Color,
+		Data
+	};
+
+	// Size and number of channels stored in the image file, without decoding it
+	void queryTextureInfo(std::string, int *, int *, int *);
+	int queryTextureChannels(std::string);
+
+	// Smallest 8 bit per channel format that holds the source channels and is supported for
+	//  filtered sampling. 3 channel sources always go to 4 channels, RGB8 is rarely supported.
+	VkFormat chooseTextureFormat(VkPhysicalDevice, int, TextureUsage);
+
+	bool isSrgbFormat(VkFormat);
+
+	// Channels (= bytes per texel) of the formats chooseTextureFormat can return
+	uint32_t getFormatChannels(VkFormat);
+
+	// Swizzle that makes a 1 or 2 channel format read like the RGBA texture it replaced
+	VkComponentMapping getFormatComponentMapping(VkFormat);
+
+	// Decode an image file into tightly packed texels with desiredChannels 8 bit channels each.
+	//  Free the result with stbi_image_free.
+	stbi_uc *loadTextureImage(std::string, int *, int *, int *, int desiredChannels = 4);
+
+	// Decode into pDst, which holds width * height * desiredChannels bytes, e.g. mapped staging
+	//  memory. Most images are decoded in place; the rest go through the heap and are copied.
+	//  Throws if the image isn't width x height.
+	void loadTextureImageInto(std::string, void *pDst, uint32_t width, uint32_t height, int desiredChannels);
+}
+
 // Maybe one texture can hold multiple images?
 class VulkanTexture : public VulkanImage
 {
 public:
 	VulkanTexture() = default;
-	VulkanTexture(std::string, VkPhysicalDevice, VkDevice, VkMemoryPropertyFlags, VkCommandPool, VkQueue);
+	VulkanTexture(
+		std::string,
+		VkPhysicalDevice,
+		VkDevice,
+		VkMemoryPropertyFlags,
+		SingleTimeCommandPool &,
+		vkTextureUtils::TextureUsage usage = vkTextureUtils::TextureUsage::Color,
+		JobSystem *pJobSystem = nullptr	// Splits the CPU mip generation, if it has to run
+	);
 
-	void lazyInit(std::string, VkPhysicalDevice, VkDevice, VkMemoryPropertyFlags, VkCommandPool, VkQueue);
+	void lazyInit(
+		std::string,
+		VkPhysicalDevice,
+		VkDevice,
+		VkMemoryPropertyFlags,
+		SingleTimeCommandPool &,
+		vkTextureUtils::TextureUsage usage = vkTextureUtils::TextureUsage::Color,
+		JobSystem *pJobSystem = nullptr	// Splits the CPU mip generation, if it has to run
+	);
 
 	VkImageView getTextureImageView() const { return mImageView; }
 	VkSampler getTextureSampler() const { return mTextureSampler; }
@@ -30,17 +88,17 @@ public:
 	}
 
 private:
-	void copyBufferToImage(VkBuffer);
 	void createTextureImage(VkMemoryPropertyFlags);
 	void createTextureImageView();
 	void createTextureSampler();
-	void generateMipmaps();
 
 	uint32_t mWidth = 0, mHeight = 0, mMipLevels = 0;
 
 	VkSampler mTextureSampler = VK_NULL_HANDLE;
 
 	std::string mFileName;
+	vkTextureUtils::TextureUsage mUsage = vkTextureUtils::TextureUsage::Color;
+	JobSystem *mpJobSystem = nullptr;
 };
 
 #endif // VULKAN_TEXTURE_H
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef VULKAN_TIMELINE_H
+#define VULKAN_TIMELINE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class VulkanDeviceFeatures;
+
+/**
+ * One counter for all GPU work on a queue. Every submission that goes through here signals the next
+ *  value, so frames, uploads and anything waiting to be destroyed only need to remember a number:
+ *  once the GPU has reached it, everything submitted up to that point is done.
+ *
+ * With timeline semaphores (core in 1.2) the counter is the semaphore's payload and waiting for a
+ *  value is a single vkWaitSemaphores. Without them each submission gets a recycled fence, which is
+ *  the old fence per frame path wrapped behind the same interface.
+ *
+ * Values only mean something if they complete in order, so submit to one queue only.
+ *  Not thread safe.
+ */
+class VulkanTimeline
+{
+public:
+	VulkanTimeline() = default;
+
+	void lazyInit(VkDevice, VulkanDeviceFeatures const &);
+
+	// Submits the batch and returns the value it signals on completion. The semaphores the batch
+	//  already signals, like the one presentation waits on, still get signaled.
+	uint64_t submit(VkQueue, VkSubmitInfo const &);
+
+	// 0 is the value before anything was submitted, it is always complete
+	uint64_t getLastSubmittedValue() const { return mLastSubmittedValue; }
+	uint64_t getCompletedValue();
+	bool isComplete(uint64_t value);
+
+	// Blocks until the GPU has reached value
+	void wait(uint64_t value);
+
+	// Runs deleter once the GPU has reached value, from a later collectGarbage()
+	void destroyAfter(uint64_t value, std::function<void()> deleter);
+	void collectGarbage();
+
+	bool usesTimelineSemaphore() const { return mTimelineSemaphore != VK_NULL_HANDLE; }
+
+	// Waits for everything submitted and runs all pending deleters
+	void cleanUp();
+
+private:
+	struct PendingFence
+	{
+		uint64_t value;
+		VkFence fence;
+	};
+
+	struct PendingDeletion
+	{
+		uint64_t value;
+		std::function<void()> deleter;
+	};
+
+	VkFence acquireFence();
+	// Fallback path: recycles the fences that have signaled, oldest first
+	void retireFences();
+
+	VkDevice mLogicalDevice = VK_NULL_HANDLE;
+
+	uint64_t mLastSubmittedValue = 0;
+	uint64_t mCompletedValue = 0;	// Cached, the GPU may already be further along
+
+	VkSemaphore mTimelineSemaphore = VK_NULL_HANDLE;
+	PFN_vkWaitSemaphores mpfnWaitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValue mpfnGetSemaphoreCounterValue = nullptr;
+
+	std::deque<PendingFence> mPendingFences;	// In submission order
+	std::vector<VkFence> mFreeFences;
+
+	std::deque<PendingDeletion> mDeletionQueue;	// Values only go up, so this is sorted too
+};
+
+#endif // VULKAN_TIMELINE_H
\ No newline at end of file
@@ -3,6 +3,8 @@
 #ifndef VULKAN_UTILS_H
 #define VULKAN_UTILS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <vulkan/vulkan.h>
@@ -29,7 +31,37 @@ namespace vkutils
 		VkFormatFeatureFlags
 	);
 
+	// Best depth format the device can render to with optimal tiling
+	VkFormat findDepthFormat(VkPhysicalDevice);
+
 	bool hasStencilComponent(VkFormat);
+
+	// FNV-1a, 64 bit. Start from kHashOffset and feed everything that makes up the key.
+	const uint64_t kHashOffset = 14695981039346656037ull;
+
+	inline void hashBytes(uint64_t &hash, void const *pData, size_t size)
+	{
+		const uint64_t kHashPrime = 1099511628211ull;
+		uint8_t const *pBytes = static_cast<uint8_t const *>(pData);
+
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ pBytes[i]) * kHashPrime;
+		}
+	}
+
+	template<typename T>
+	void hashValue(uint64_t &hash, T const &value)
+	{
+		hashBytes(hash, &value, sizeof(T));
+	}
+
+	// The size goes in first, so moving bytes from one vector to the next changes the hash
+	template<typename T>
+	void hashVector(uint64_t &hash, std::vector<T> const &values)
+	{
+		hashValue(hash, values.size());
+		hashBytes(hash, values.data(), sizeof(T) * values.size());
+	}
 }
 
 #endif // VULKAN_UTILS_H
\ No newline at end of file
@@ -0,0 +1,44 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+// Every texture of the scene, see VulkanBindlessTextures
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// Must match PerDrawData in PerDrawData.h
+layout(push_constant) uniform DrawData
+{
+	mat4 model;
+	uint materialIndex;
+} draw;
+
+// Material features, see SceneShaderConstant in main.cpp. Specialized per pipeline, so the branches on
+//  them are gone by the time the pipeline is compiled.
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	vec4 color = vec4(1.0);
+
+	// nonuniformEXT keeps this correct once the index comes from per-instance data instead of per-draw data
+	if (USE_TEXTURE) {
+		color = texture(textures[nonuniformEXT(draw.materialIndex)], fragTexCoord);
+	}
+
+	if (USE_VERTEX_COLOR) {
+		color.rgb *= fragColor;
+	}
+
+	if (ALPHA_TEST && color.a < 0.5) {
+		discard;
+	}
+
+	outColor = color;
+}
\ No newline at end of file
@@ -1,2 +1,4 @@
-C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe simple.vert -o vert.spv
-C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe simple.frag -o frag.spv
\ No newline at end of file
+C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe simple.frag -o frag.spv || exit /b 1
+C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe bindless.frag -o bindless_frag.spv || exit /b 1
+C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe instance.vert -o instance_vert.spv || exit /b 1
+C:/VulkanSDK/1.2.176.1/Bin32/glslc.exe cull.comp -o cull_comp.spv || exit /b 1
\ No newline at end of file
@@ -1,23 +1,33 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Per frame, see UniformBufferObject in main.cpp
 layout(binding = 0) uniform UniformBufferObject
 {
-	mat4 model;
 	mat4 view;
 	mat4 proj;
 } ubo;
 
+// Must match PerDrawData in PerDrawData.h
+layout(push_constant) uniform DrawData
+{
+	mat4 model;
+	uint materialIndex;
+} draw;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+// Per instance, see InstanceData in Vertex.h. Takes locations 3 to 6.
+layout(location = 3) in mat4 inModel;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main()
 {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	gl_Position = ubo.proj * ubo.view * draw.model * inModel * vec4(inPosition, 1.0);
 	fragColor = inColor;
 	fragTexCoord = inTexCoord;
 }
\ No newline at end of file
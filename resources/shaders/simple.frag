@@ -6,11 +6,29 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
+// Material features, see SceneShaderConstant in main.cpp. Specialized per pipeline, so the branches on
+//  them are gone by the time the pipeline is compiled.
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-	//outColor = vec4(fragColor, 1.0);
-	//outColor = vec4(fragTexCoord, 0.0, 1.0);
-	outColor = texture(texSampler, fragTexCoord);
+	vec4 color = vec4(1.0);
+
+	if (USE_TEXTURE) {
+		color = texture(texSampler, fragTexCoord);
+	}
+
+	if (USE_VERTEX_COLOR) {
+		color.rgb *= fragColor;
+	}
+
+	if (ALPHA_TEST && color.a < 0.5) {
+		discard;
+	}
+
+	outColor = color;
 }
\ No newline at end of file
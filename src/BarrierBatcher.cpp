@@ -0,0 +1,243 @@
+#include "BarrierBatcher.h"
+
+#include "VulkanDevices.h"
+
+void BarrierBatcher::lazyInit(VkDevice logicalDevice, VulkanDeviceFeatures const &deviceFeatures)
+{
+#ifdef VK_KHR_synchronization2
+	mpfnCmdPipelineBarrier2 = nullptr;
+
+	if (!deviceFeatures.supportsSynchronization2()) {
+		return;
+	}
+
+	// Promoted from VK_KHR_synchronization2, which only has the suffixed name
+	bool isCore = deviceFeatures.getApiVersion() >= VK_API_VERSION_1_3;
+
+	// Stay on vkCmdPipelineBarrier rather than fail if the driver doesn't hand out the entry point
+	mpfnCmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR) vkGetDeviceProcAddr(
+		logicalDevice, isCore ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR");
+#else
+	(void) logicalDevice;
+	(void) deviceFeatures;
+#endif
+}
+
+bool BarrierBatcher::usesSynchronization2() const
+{
+#ifdef VK_KHR_synchronization2
+	return mpfnCmdPipelineBarrier2 != nullptr;
+#else
+	return false;
+#endif
+}
+
+void BarrierBatcher::addImage(
+	VkImage image, VkImageSubresourceRange const &range, ResourceUsageSet previous, VkImageLayout oldLayout, ResourceUsage next )
+{
+	mImageBarriers.push_back({ image, range, oldLayout, getResourceUsageInfo(next).layout, previous, next });
+}
+
+void BarrierBatcher::addImage(
+	VkImage image, VkImageSubresourceRange const &range, ResourceUsage previous, ResourceUsage next, bool preserveContents )
+{
+	VkImageLayout oldLayout = preserveContents ? getResourceUsageInfo(previous).layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+	addImage(image, range, toUsageSet(previous), oldLayout, next);
+}
+
+void BarrierBatcher::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, ResourceUsageSet previous, ResourceUsage next)
+{
+	mBufferBarriers.push_back({ buffer, offset, size, previous, next });
+}
+
+void BarrierBatcher::addMemory(ResourceUsageSet previous, ResourceUsage next)
+{
+	mMemoryPrevious |= previous;
+	mMemoryNext |= toUsageSet(next);
+}
+
+bool BarrierBatcher::isEmpty() const
+{
+	return mImageBarriers.empty() && mBufferBarriers.empty() && mMemoryNext == 0;
+}
+
+void BarrierBatcher::flush(VkCommandBuffer commandBuffer)
+{
+	if (isEmpty()) {
+		return;
+	}
+
+	if (usesSynchronization2()) {
+		recordBarrier2(commandBuffer);
+	} else {
+		recordBarrier(commandBuffer);
+	}
+
+	mBarrierCount += mImageBarriers.size() + mBufferBarriers.size() + (mMemoryNext != 0 ? 1 : 0);
+	++mCommandCount;
+
+	mImageBarriers.clear();
+	mBufferBarriers.clear();
+	mMemoryPrevious = 0;
+	mMemoryNext = 0;
+}
+
+void BarrierBatcher::resetStats()
+{
+	mBarrierCount = 0;
+	mCommandCount = 0;
+}
+
+void BarrierBatcher::recordBarrier(VkCommandBuffer commandBuffer)
+{
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	imageBarriers.reserve(mImageBarriers.size());
+
+	for (ImageBarrier const &barrier : mImageBarriers) {
+		ResourceUsageMasks src = getResourceUsageMasks(barrier.previous, true);
+		ResourceUsageMasks dst = getResourceUsageMasks(toUsageSet(barrier.next), false);
+
+		srcStages |= src.stages;
+		dstStages |= dst.stages;
+
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = src.access;
+		imageBarrier.dstAccessMask = dst.access;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = barrier.image;
+		imageBarrier.subresourceRange = barrier.range;
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	bufferBarriers.reserve(mBufferBarriers.size());
+
+	for (BufferBarrier const &barrier : mBufferBarriers) {
+		ResourceUsageMasks src = getResourceUsageMasks(barrier.previous, true);
+		ResourceUsageMasks dst = getResourceUsageMasks(toUsageSet(barrier.next), false);
+
+		srcStages |= src.stages;
+		dstStages |= dst.stages;
+
+		VkBufferMemoryBarrier bufferBarrier{};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarrier.srcAccessMask = src.access;
+		bufferBarrier.dstAccessMask = dst.access;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = barrier.buffer;
+		bufferBarrier.offset = barrier.offset;
+		bufferBarrier.size = barrier.size;
+		bufferBarriers.push_back(bufferBarrier);
+	}
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+	if (mMemoryNext != 0) {
+		ResourceUsageMasks src = getResourceUsageMasks(mMemoryPrevious, true);
+		ResourceUsageMasks dst = getResourceUsageMasks(mMemoryNext, false);
+
+		srcStages |= src.stages;
+		dstStages |= dst.stages;
+
+		memoryBarrier.srcAccessMask = src.access;
+		memoryBarrier.dstAccessMask = dst.access;
+	}
+
+	// Nothing to wait for, only a layout transition of an image with throwaway contents
+	if (srcStages == 0) {
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		srcStages, dstStages,
+		0,
+		mMemoryNext != 0 ? 1 : 0, &memoryBarrier,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+	);
+}
+
+void BarrierBatcher::recordBarrier2(VkCommandBuffer commandBuffer)
+{
+#ifdef VK_KHR_synchronization2
+	std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+	imageBarriers.reserve(mImageBarriers.size());
+
+	for (ImageBarrier const &barrier : mImageBarriers) {
+		ResourceUsageMasks2 src = getResourceUsageMasks2(barrier.previous, true);
+		ResourceUsageMasks2 dst = getResourceUsageMasks2(barrier.next);
+
+		VkImageMemoryBarrier2KHR imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+		imageBarrier.srcStageMask = src.stages;
+		imageBarrier.srcAccessMask = src.access;
+		imageBarrier.dstStageMask = dst.stages;
+		imageBarrier.dstAccessMask = dst.access;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = barrier.image;
+		imageBarrier.subresourceRange = barrier.range;
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+	bufferBarriers.reserve(mBufferBarriers.size());
+
+	for (BufferBarrier const &barrier : mBufferBarriers) {
+		ResourceUsageMasks2 src = getResourceUsageMasks2(barrier.previous, true);
+		ResourceUsageMasks2 dst = getResourceUsageMasks2(barrier.next);
+
+		VkBufferMemoryBarrier2KHR bufferBarrier{};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+		bufferBarrier.srcStageMask = src.stages;
+		bufferBarrier.srcAccessMask = src.access;
+		bufferBarrier.dstStageMask = dst.stages;
+		bufferBarrier.dstAccessMask = dst.access;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = barrier.buffer;
+		bufferBarrier.offset = barrier.offset;
+		bufferBarrier.size = barrier.size;
+		bufferBarriers.push_back(bufferBarrier);
+	}
+
+	VkMemoryBarrier2KHR memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR;
+
+	if (mMemoryNext != 0) {
+		ResourceUsageMasks2 src = getResourceUsageMasks2(mMemoryPrevious, true);
+		ResourceUsageMasks2 dst = getResourceUsageMasks2(mMemoryNext, false);
+
+		memoryBarrier.srcStageMask = src.stages;
+		memoryBarrier.srcAccessMask = src.access;
+		memoryBarrier.dstStageMask = dst.stages;
+		memoryBarrier.dstAccessMask = dst.access;
+	}
+
+	VkDependencyInfoKHR dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+	dependencyInfo.memoryBarrierCount = mMemoryNext != 0 ? 1 : 0;
+	dependencyInfo.pMemoryBarriers = &memoryBarrier;
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+	dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+	mpfnCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+#else
+	(void) commandBuffer;
+#endif
+}
\ No newline at end of file
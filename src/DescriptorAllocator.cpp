@@ -0,0 +1,119 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	// Pools stop growing here, a bigger pool would mostly sit empty
+	const uint32_t kMaxSetsPerPool = 4096;
+
+	const std::vector<DescriptorAllocator::PoolSizeRatio> kDefaultRatios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+	};
+}
+
+void DescriptorAllocator::lazyInit(VkDevice logicalDevice, uint32_t initialSetsPerPool, std::vector<PoolSizeRatio> const &ratios)
+{
+	mLogicalDevice = logicalDevice;
+	mRatios = ratios.empty() ? kDefaultRatios : ratios;
+	mSetsPerPool = std::max(1u, initialSetsPerPool);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = getPool();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, &descriptorSet);
+
+	// The pool is out of sets or of descriptors of some type, retire it and try once more with a fresh one
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		mFullPools.push_back(mCurrentPool);
+		mCurrentPool = VK_NULL_HANDLE;
+
+		allocInfo.descriptorPool = getPool();
+		result = vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, &descriptorSet);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor set!");
+	}
+
+	return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+	if (mCurrentPool != VK_NULL_HANDLE) {
+		mFullPools.push_back(mCurrentPool);
+		mCurrentPool = VK_NULL_HANDLE;
+	}
+
+	for (VkDescriptorPool pool : mFullPools) {
+		vkResetDescriptorPool(mLogicalDevice, pool, 0);
+		mFreePools.push_back(pool);
+	}
+	mFullPools.clear();
+}
+
+void DescriptorAllocator::cleanUp()
+{
+	reset();
+
+	for (VkDescriptorPool pool : mFreePools) {
+		vkDestroyDescriptorPool(mLogicalDevice, pool, nullptr);
+	}
+	mFreePools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::getPool()
+{
+	if (mCurrentPool != VK_NULL_HANDLE) {
+		return mCurrentPool;
+	}
+
+	if (!mFreePools.empty()) {
+		mCurrentPool = mFreePools.back();
+		mFreePools.pop_back();
+	} else {
+		mCurrentPool = createPool(mSetsPerPool);
+		mSetsPerPool = std::min(mSetsPerPool * 2, kMaxSetsPerPool);
+	}
+
+	return mCurrentPool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+
+	for (PoolSizeRatio const &ratio : mRatios) {
+		poolSizes.push_back({ ratio.type, static_cast<uint32_t>(std::ceil(ratio.descriptorsPerSet * maxSets)) });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = maxSets;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(mLogicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+
+	return pool;
+}
\ No newline at end of file
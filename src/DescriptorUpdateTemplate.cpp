@@ -0,0 +1,113 @@
+#include "DescriptorUpdateTemplate.h"
+
+#include <stdexcept>
+
+#include "VulkanDevices.h"
+
+void DescriptorUpdateTemplate::lazyInit(
+	VkDevice logicalDevice,
+	VulkanDeviceFeatures const &deviceFeatures,
+	VkDescriptorSetLayout setLayout,
+	std::vector<Entry> const &entries,
+	bool useTemplate )
+{
+	mLogicalDevice = logicalDevice;
+	mEntries = entries;
+	mTemplate = VK_NULL_HANDLE;
+
+	if (!useTemplate || !deviceFeatures.supportsDescriptorUpdateTemplates()) {
+		return;
+	}
+
+	PFN_vkCreateDescriptorUpdateTemplate pfnCreateDescriptorUpdateTemplate =
+		(PFN_vkCreateDescriptorUpdateTemplate) vkGetDeviceProcAddr(mLogicalDevice, "vkCreateDescriptorUpdateTemplate");
+	mpfnUpdateDescriptorSetWithTemplate =
+		(PFN_vkUpdateDescriptorSetWithTemplate) vkGetDeviceProcAddr(mLogicalDevice, "vkUpdateDescriptorSetWithTemplate");
+	mpfnDestroyDescriptorUpdateTemplate =
+		(PFN_vkDestroyDescriptorUpdateTemplate) vkGetDeviceProcAddr(mLogicalDevice, "vkDestroyDescriptorUpdateTemplate");
+
+	// Keep writing descriptors one by one rather than fail if the driver doesn't hand out the entry points
+	if (!pfnCreateDescriptorUpdateTemplate || !mpfnUpdateDescriptorSetWithTemplate || !mpfnDestroyDescriptorUpdateTemplate) {
+		return;
+	}
+
+	std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+
+	for (Entry const &entry : mEntries) {
+		VkDescriptorUpdateTemplateEntry templateEntry{};
+		templateEntry.dstBinding = entry.binding;
+		templateEntry.dstArrayElement = 0;
+		templateEntry.descriptorCount = entry.count;
+		templateEntry.descriptorType = entry.type;
+		templateEntry.offset = entry.offset;
+		templateEntry.stride = entry.stride;
+
+		templateEntries.push_back(templateEntry);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+	templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = setLayout;
+
+	if (pfnCreateDescriptorUpdateTemplate(mLogicalDevice, &templateInfo, nullptr, &mTemplate) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor update template!");
+	}
+}
+
+void DescriptorUpdateTemplate::update(VkDescriptorSet descriptorSet, void const *pData) const
+{
+	if (usesTemplate()) {
+		mpfnUpdateDescriptorSetWithTemplate(mLogicalDevice, descriptorSet, mTemplate, pData);
+		return;
+	}
+
+	char const *pBytes = static_cast<char const *>(pData);
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+
+	// One write per array element, the infos of an array aren't necessarily contiguous in the struct
+	for (Entry const &entry : mEntries) {
+		for (uint32_t element = 0; element < entry.count; ++element) {
+			void const *pInfo = pBytes + entry.offset + element * entry.stride;
+
+			VkWriteDescriptorSet descriptorWrite{};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = descriptorSet;
+			descriptorWrite.dstBinding = entry.binding;
+			descriptorWrite.dstArrayElement = element;
+			descriptorWrite.descriptorType = entry.type;
+			descriptorWrite.descriptorCount = 1;
+
+			switch (entry.type) {
+			case VK_DESCRIPTOR_TYPE_SAMPLER:
+			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+				descriptorWrite.pImageInfo = static_cast<VkDescriptorImageInfo const *>(pInfo);
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+				descriptorWrite.pTexelBufferView = static_cast<VkBufferView const *>(pInfo);
+				break;
+			default:
+				descriptorWrite.pBufferInfo = static_cast<VkDescriptorBufferInfo const *>(pInfo);
+				break;
+			}
+
+			descriptorWrites.push_back(descriptorWrite);
+		}
+	}
+
+	vkUpdateDescriptorSets(mLogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void DescriptorUpdateTemplate::cleanUp()
+{
+	if (usesTemplate()) {
+		mpfnDestroyDescriptorUpdateTemplate(mLogicalDevice, mTemplate, nullptr);
+		mTemplate = VK_NULL_HANDLE;
+	}
+}
\ No newline at end of file
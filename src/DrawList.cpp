@@ -0,0 +1,258 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Fewer keys than this per chunk and the jobs cost more than the sort
+	const uint32_t kMinKeysPerChunk = 4096;
+
+	const uint32_t kPassBits = 8;
+	const uint32_t kPipelineBits = 16;
+	const uint32_t kMaterialBits = 24;
+	const uint32_t kDepthBits = 16;
+
+	uint64_t fitBits(uint32_t value, uint32_t bits)
+	{
+		return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+	}
+}
+
+uint64_t DrawList::makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint16_t depthBucket)
+{
+	return (fitBits(pass, kPassBits) << (kPipelineBits + kMaterialBits + kDepthBits))
+		| (fitBits(pipeline, kPipelineBits) << (kMaterialBits + kDepthBits))
+		| (fitBits(material, kMaterialBits) << kDepthBits)
+		| fitBits(depthBucket, kDepthBits);
+}
+
+uint16_t DrawList::getDepthBucket(float viewDepth, float nearPlane, float farPlane, bool backToFront)
+{
+	float normalized = std::clamp((viewDepth - nearPlane) / (farPlane - nearPlane), 0.0f, 1.0f);
+	uint16_t bucket = static_cast<uint16_t>(normalized * 65535.0f);
+
+	return backToFront ? static_cast<uint16_t>(65535 - bucket) : bucket;
+}
+
+void DrawList::clear()
+{
+	mDraws.clear();
+	mOrder.clear();
+
+	mRecordedDraws = 0;
+	mRecordedInstances = 0;
+	mBindsIssued = 0;
+	mBindsSkipped = 0;
+}
+
+void DrawList::add(DrawItem const &draw)
+{
+	mOrder.push_back({ draw.sortKey, static_cast<uint32_t>(mDraws.size()) });
+	mDraws.push_back(draw);
+}
+
+template<typename Fn>
+void DrawList::forEachChunk(JobSystem *pJobSystem, uint32_t chunkCount, Fn fn)
+{
+	if (!pJobSystem || chunkCount == 1) {
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+			fn(chunk);
+		}
+
+		return;
+	}
+
+	pJobSystem->parallelFor(chunkCount, 1, [&fn](uint32_t firstChunk, uint32_t lastChunk) {
+		for (uint32_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+			fn(chunk);
+		}
+	});
+}
+
+/**
+ * Least significant digit first, so each pass has to be stable. Every chunk counts its digits, then
+ *  gets the range of each bucket after the same bucket of all earlier chunks and scatters into it in
+ *  its own order, which keeps equal digits in the order they had.
+ */
+void DrawList::sort(JobSystem *pJobSystem)
+{
+	uint32_t count = size();
+
+	uint32_t chunkCount = 1;
+	if (pJobSystem) {
+		chunkCount = std::clamp((count + kMinKeysPerChunk - 1) / kMinKeysPerChunk, 1u, pJobSystem->getThreadCount());
+	}
+
+	uint32_t chunkSize = (count + chunkCount - 1) / std::max(1u, chunkCount);
+
+	mScratch.resize(count);
+	mChunkHistograms.resize(chunkCount);
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		forEachChunk(pJobSystem, chunkCount, [&](uint32_t chunk) {
+			Histogram &histogram = mChunkHistograms[chunk];
+			histogram.fill(0);
+
+			uint32_t first = std::min(count, chunk * chunkSize);
+			uint32_t last = std::min(count, first + chunkSize);
+
+			for (uint32_t i = first; i < last; ++i) {
+				++histogram[(mOrder[i].key >> shift) & 0xFF];
+			}
+		});
+
+		// Turn the counts into where each chunk starts writing each digit
+		uint32_t offset = 0;
+		bool isSingleBucket = false;
+
+		for (uint32_t digit = 0; digit < 256; ++digit) {
+			uint32_t bucketStart = offset;
+
+			for (Histogram &histogram : mChunkHistograms) {
+				uint32_t digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+
+			isSingleBucket = isSingleBucket || (offset - bucketStart == count);
+		}
+
+		// Every key has the same digit here, the scatter would only copy
+		if (isSingleBucket) {
+			continue;
+		}
+
+		forEachChunk(pJobSystem, chunkCount, [&](uint32_t chunk) {
+			Histogram &offsets = mChunkHistograms[chunk];
+
+			uint32_t first = std::min(count, chunk * chunkSize);
+			uint32_t last = std::min(count, first + chunkSize);
+
+			for (uint32_t i = first; i < last; ++i) {
+				mScratch[offsets[(mOrder[i].key >> shift) & 0xFF]++] = mOrder[i];
+			}
+		});
+
+		mOrder.swap(mScratch);
+	}
+
+	// Moved into sorted order once, so record() walks mDraws front to back instead of gathering through mOrder
+	mSortedDraws.resize(count);
+
+	forEachChunk(pJobSystem, chunkCount, [&](uint32_t chunk) {
+		uint32_t first = std::min(count, chunk * chunkSize);
+		uint32_t last = std::min(count, first + chunkSize);
+
+		for (uint32_t i = first; i < last; ++i) {
+			mSortedDraws[i] = mDraws[mOrder[i].index];
+			mOrder[i].index = i;
+		}
+	});
+
+	mDraws.swap(mSortedDraws);
+}
+
+void DrawList::record(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last, PerDrawDataBinder const &drawDataBinder)
+{
+	// What is bound right now; a range starts in a fresh secondary, so with nothing
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	bool hasDrawData = false;
+	PerDrawData drawData;
+
+	uint32_t instances = 0, bindsIssued = 0, bindsSkipped = 0;
+
+	for (uint32_t sorted = first; sorted < last; ++sorted) {
+		DrawItem const &draw = mDraws[sorted];
+
+		if (draw.pipeline != pipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+			pipeline = draw.pipeline;
+			++bindsIssued;
+		} else {
+			++bindsSkipped;
+		}
+
+		// A different layout may disturb what was bound and pushed with the old one, so start over
+		if (draw.pipelineLayout != pipelineLayout) {
+			pipelineLayout = draw.pipelineLayout;
+			descriptorSet = VK_NULL_HANDLE;
+			hasDrawData = false;
+		}
+
+		bool setChanged = draw.descriptorSet != descriptorSet;
+		bool drawDataChanged = !hasDrawData || memcmp(&draw.drawData, &drawData, sizeof(PerDrawData)) != 0;
+
+		if (setChanged) {
+			vkCmdBindDescriptorSets(
+				commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipelineLayout, 0, 1, &draw.descriptorSet, 0, nullptr);
+			++bindsIssued;
+		} else {
+			++bindsSkipped;
+		}
+
+		if (drawDataChanged) {
+			drawDataBinder.record(commandBuffer, draw.pipelineLayout, draw.drawData);
+			++bindsIssued;
+		} else {
+			++bindsSkipped;
+		}
+
+		descriptorSet = draw.descriptorSet;
+		drawData = draw.drawData;
+		hasDrawData = true;
+
+		if (draw.vertexBuffer != vertexBuffer) {
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &draw.vertexBuffer, &offset);
+			vertexBuffer = draw.vertexBuffer;
+			++bindsIssued;
+		} else {
+			++bindsSkipped;
+		}
+
+		if (draw.indexBuffer != indexBuffer) {
+			vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			indexBuffer = draw.indexBuffer;
+			++bindsIssued;
+		} else {
+			++bindsSkipped;
+		}
+
+		if (draw.instanceBuffer != VK_NULL_HANDLE) {
+			if (draw.instanceBuffer != instanceBuffer) {
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 1, 1, &draw.instanceBuffer, &offset);
+				instanceBuffer = draw.instanceBuffer;
+				++bindsIssued;
+			} else {
+				++bindsSkipped;
+			}
+		}
+
+		vkCmdDrawIndexed(
+			commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+		instances += draw.instanceCount;
+	}
+
+	mRecordedDraws += last - first;
+	mRecordedInstances += instances;
+	mBindsIssued += bindsIssued;
+	mBindsSkipped += bindsSkipped;
+}
+
+DrawList::Stats DrawList::getStats() const
+{
+	Stats stats;
+	stats.draws = mRecordedDraws;
+	stats.instances = mRecordedInstances;
+	stats.bindsIssued = mBindsIssued;
+	stats.bindsSkipped = mBindsSkipped;
+
+	return stats;
+}
\ No newline at end of file
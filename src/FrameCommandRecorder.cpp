@@ -0,0 +1,194 @@
+#include "FrameCommandRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace
+{
+	// Fewer draws than this per worker and handing them to another thread costs more than recording them
+	const uint32_t kMinDrawsPerWorker = 64;
+}
+
+void FrameCommandRecorder::lazyInit(
+	VkDevice logicalDevice,
+	uint32_t queueFamilyIndex,
+	uint32_t framesInFlight,
+	uint32_t workerCount,
+	JobSystem &jobSystem )
+{
+	mLogicalDevice = logicalDevice;
+	mpJobSystem = &jobSystem;
+	mQueueFamilyIndex = queueFamilyIndex;
+	mWorkerCount = std::max(1u, workerCount);
+
+	mFrames.resize(framesInFlight);
+
+	for (FrameCommands &frame : mFrames) {
+		frame.primaryPool = createCommandPool();
+		frame.primary = allocateCommandBuffer(frame.primaryPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		frame.workerPools.resize(mWorkerCount);
+		frame.secondaries.resize(mWorkerCount);
+
+		for (uint32_t worker = 0; worker < mWorkerCount; ++worker) {
+			frame.workerPools[worker] = createCommandPool();
+			frame.secondaries[worker] = allocateCommandBuffer(frame.workerPools[worker], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		}
+	}
+}
+
+/**
+ * Resetting the pool resets all of its command buffers in one go, which is cheaper than resetting
+ *  them one by one and lets the driver recycle the pool's memory for the next recording.
+ */
+void FrameCommandRecorder::resetFrame(uint32_t frame)
+{
+	FrameCommands &commands = mFrames[frame];
+
+	vkResetCommandPool(mLogicalDevice, commands.primaryPool, 0);
+
+	for (VkCommandPool pool : commands.workerPools) {
+		vkResetCommandPool(mLogicalDevice, pool, 0);
+	}
+}
+
+VkCommandBuffer FrameCommandRecorder::begin(uint32_t frame)
+{
+	mRecordStartTime = std::chrono::high_resolution_clock::now();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // Recorded again next time this frame comes around
+
+	if (vkBeginCommandBuffer(mFrames[frame].primary, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording frame command buffer!");
+	}
+
+	return mFrames[frame].primary;
+}
+
+void FrameCommandRecorder::recordPassDraws(
+	uint32_t frame,
+	VkCommandBufferInheritanceInfo const &inheritanceInfo,
+	uint32_t drawCount,
+	RecordDrawsFn const &recordDraws )
+{
+	FrameCommands &commands = mFrames[frame];
+
+	uint32_t workerCount = std::clamp((drawCount + kMinDrawsPerWorker - 1) / kMinDrawsPerWorker, 1u, mWorkerCount);
+	uint32_t drawsPerWorker = (drawCount + workerCount - 1) / workerCount;
+
+	// Jobs must not throw, so each worker parks its exception to rethrow once all are done
+	std::vector<std::exception_ptr> errors(workerCount);
+
+	auto recordWorker = [&](uint32_t worker) {
+		uint32_t first = std::min(drawCount, worker * drawsPerWorker);
+		uint32_t last = std::min(drawCount, first + drawsPerWorker);
+
+		try {
+			recordSecondary(commands.secondaries[worker], inheritanceInfo, first, last, recordDraws);
+		} catch (...) {
+			errors[worker] = std::current_exception();
+		}
+	};
+
+	// One secondary per job, whichever thread picks it up; this one records some of them too
+	mpJobSystem->parallelFor(workerCount, 1, [&](uint32_t firstWorker, uint32_t lastWorker) {
+		for (uint32_t worker = firstWorker; worker < lastWorker; ++worker) {
+			recordWorker(worker);
+		}
+	});
+
+	for (std::exception_ptr const &error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	vkCmdExecuteCommands(commands.primary, workerCount, commands.secondaries.data());
+}
+
+VkCommandBuffer FrameCommandRecorder::end(uint32_t frame)
+{
+	if (vkEndCommandBuffer(mFrames[frame].primary) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to end recording frame command buffer!");
+	}
+
+	mLastRecordMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - mRecordStartTime).count();
+
+	return mFrames[frame].primary;
+}
+
+void FrameCommandRecorder::cleanUp()
+{
+	// Command buffers are freed along with their pools
+	for (FrameCommands &frame : mFrames) {
+		vkDestroyCommandPool(mLogicalDevice, frame.primaryPool, nullptr);
+
+		for (VkCommandPool pool : frame.workerPools) {
+			vkDestroyCommandPool(mLogicalDevice, pool, nullptr);
+		}
+	}
+
+	mFrames.clear();
+}
+
+VkCommandPool FrameCommandRecorder::createCommandPool()
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = mQueueFamilyIndex;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Everything in it is re-recorded every frame
+
+	VkCommandPool pool;
+	if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create frame command pool!");
+	}
+
+	return pool;
+}
+
+VkCommandBuffer FrameCommandRecorder::allocateCommandBuffer(VkCommandPool pool, VkCommandBufferLevel level)
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = level;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate frame command buffer!");
+	}
+
+	return commandBuffer;
+}
+
+void FrameCommandRecorder::recordSecondary(
+	VkCommandBuffer commandBuffer,
+	VkCommandBufferInheritanceInfo const &inheritanceInfo,
+	uint32_t first,
+	uint32_t last,
+	RecordDrawsFn const &recordDraws )
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+	}
+
+	// An empty range still executes fine, it just has no commands in it
+	if (first < last) {
+		recordDraws(commandBuffer, first, last);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to end recording secondary command buffer!");
+	}
+}
\ No newline at end of file
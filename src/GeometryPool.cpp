@@ -0,0 +1,205 @@
+#include "GeometryPool.h"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "BarrierBatcher.h"
+
+void FreeListAllocator::lazyInit(uint32_t capacity)
+{
+	mFreeRanges.clear();
+	mFreeSize = capacity;
+
+	if (capacity > 0) {
+		mFreeRanges[0] = capacity;
+	}
+}
+
+uint32_t FreeListAllocator::allocate(uint32_t size)
+{
+	if (size == 0) {
+		return 0;
+	}
+
+	for (auto range = mFreeRanges.begin(); range != mFreeRanges.end(); ++range) {
+		if (range->second < size) {
+			continue;
+		}
+
+		uint32_t offset = range->first;
+		uint32_t remaining = range->second - size;
+
+		mFreeRanges.erase(range);
+		if (remaining > 0) {
+			mFreeRanges[offset + size] = remaining;
+		}
+
+		mFreeSize -= size;
+		return offset;
+	}
+
+	return kInvalidOffset;
+}
+
+void FreeListAllocator::free(uint32_t offset, uint32_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	mFreeSize += size;
+
+	auto next = mFreeRanges.lower_bound(offset);
+
+	// Merge with the free range right after, then with the one right before
+	if (next != mFreeRanges.end() && offset + size == next->first) {
+		size += next->second;
+		next = mFreeRanges.erase(next);
+	}
+
+	if (next != mFreeRanges.begin()) {
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset) {
+			previous->second += size;
+			return;
+		}
+	}
+
+	mFreeRanges[offset] = size;
+}
+
+void GeometryPool::lazyInit(
+	VkPhysicalDevice physicalDevice,
+	VkDevice logicalDevice,
+	SingleTimeCommandPool &singleTimeCommands,
+	VulkanTimeline &timeline,
+	uint32_t maxVertices,
+	uint32_t maxIndices )
+{
+	mPhysicalDevice = physicalDevice;
+	mLogicalDevice = logicalDevice;
+	mpSingleTimeCommands = &singleTimeCommands;
+	mpTimeline = &timeline;
+
+	mVertexBuffer.lazyInit(
+		logicalDevice,
+		physicalDevice,
+		sizeof(Vertex) * maxVertices,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	mIndexBuffer.lazyInit(
+		logicalDevice,
+		physicalDevice,
+		sizeof(uint32_t) * maxIndices,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	mVertexRanges.lazyInit(maxVertices);
+	mIndexRanges.lazyInit(maxIndices);
+}
+
+MeshAllocation GeometryPool::addMesh(std::vector<Vertex> const &vertices, std::vector<uint32_t> const &indices)
+{
+	MeshAllocation mesh;
+	mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+	mesh.indexCount = static_cast<uint32_t>(indices.size());
+
+	mesh.firstVertex = mVertexRanges.allocate(mesh.vertexCount);
+	if (mesh.firstVertex == FreeListAllocator::kInvalidOffset) {
+		throw std::runtime_error("Geometry pool is out of vertex space!");
+	}
+
+	mesh.firstIndex = mIndexRanges.allocate(mesh.indexCount);
+	if (mesh.firstIndex == FreeListAllocator::kInvalidOffset) {
+		mVertexRanges.free(mesh.firstVertex, mesh.vertexCount);
+		throw std::runtime_error("Geometry pool is out of index space!");
+	}
+
+	if (mesh.vertexCount == 0 && mesh.indexCount == 0) {
+		return mesh;
+	}
+
+	VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+	VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+
+	// Vertices and indices share one staging buffer and one submission
+	auto pStagingBuffer = std::make_shared<VulkanBuffer>(
+		mLogicalDevice,
+		mPhysicalDevice,
+		vertexBytes + indexBytes,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	);
+
+	uint8_t *pStaging = static_cast<uint8_t *>(pStagingBuffer->map());
+	memcpy(pStaging, vertices.data(), vertexBytes);
+	memcpy(pStaging + vertexBytes, indices.data(), indexBytes);
+	pStagingBuffer->unmap();
+
+	VkCommandBuffer commandBuffer = mpSingleTimeCommands->begin();
+
+	BarrierBatcher barriers;
+
+	if (vertexBytes > 0) {
+		VkBufferCopy region{};
+		region.srcOffset = 0;
+		region.dstOffset = sizeof(Vertex) * mesh.firstVertex;
+		region.size = vertexBytes;
+		vkCmdCopyBuffer(commandBuffer, pStagingBuffer->getBufferHandle(), mVertexBuffer.getBufferHandle(), 1, &region);
+
+		barriers.addBuffer(
+			mVertexBuffer.getBufferHandle(), region.dstOffset, region.size,
+			toUsageSet(ResourceUsage::TransferDst), ResourceUsage::VertexBufferRead );
+	}
+
+	if (indexBytes > 0) {
+		VkBufferCopy region{};
+		region.srcOffset = vertexBytes;
+		region.dstOffset = sizeof(uint32_t) * mesh.firstIndex;
+		region.size = indexBytes;
+		vkCmdCopyBuffer(commandBuffer, pStagingBuffer->getBufferHandle(), mIndexBuffer.getBufferHandle(), 1, &region);
+
+		barriers.addBuffer(
+			mIndexBuffer.getBufferHandle(), region.dstOffset, region.size,
+			toUsageSet(ResourceUsage::TransferDst), ResourceUsage::IndexBufferRead );
+	}
+
+	// Covers the draws of frames submitted after this too, they come later on the same queue
+	barriers.flush(commandBuffer);
+
+	SingleTimeSubmission upload = mpSingleTimeCommands->submit(commandBuffer);
+
+	// The single time command pool shares this timeline, so the value is never 0 here
+	mpTimeline->destroyAfter(upload.timelineValue, [pStagingBuffer]() { pStagingBuffer->cleanUp(); });
+
+	return mesh;
+}
+
+void GeometryPool::removeMesh(MeshAllocation const &mesh)
+{
+	// Frames in flight may still draw it
+	mpTimeline->destroyAfter(mpTimeline->getLastSubmittedValue(), [this, mesh]() {
+		mVertexRanges.free(mesh.firstVertex, mesh.vertexCount);
+		mIndexRanges.free(mesh.firstIndex, mesh.indexCount);
+	});
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer) const
+{
+	VkBuffer vertexBuffer = mVertexBuffer.getBufferHandle();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+
+	vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer.getBufferHandle(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::cleanUp()
+{
+	mVertexBuffer.cleanUp();
+	mIndexBuffer.cleanUp();
+}
\ No newline at end of file
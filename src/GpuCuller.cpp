@@ -0,0 +1,240 @@
+#include "GpuCuller.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+	// Must match local_size_x in cull.comp
+	const uint32_t kCullGroupSize = 64;
+
+	// Must match the push_constant block in cull.comp
+	struct CullPushConstants
+	{
+		glm::vec4 frustumPlanes[6];
+		uint32_t instanceCount;
+		uint32_t compact;
+	};
+
+	/**
+	 * The planes a point has to be in front of to be inside the clip volume, with the normals
+	 *  pointing inwards and normalized, so a sphere is outside when its center is more than its
+	 *  radius behind any of them. The near plane is the one for a -1 to 1 depth range, which is
+	 *  what glm::perspective makes; for 0 to 1 it only culls a little less.
+	 */
+	void getFrustumPlanes(glm::mat4 const &viewProjection, glm::vec4 *pPlanes)
+	{
+		auto row = [&viewProjection](int i) {
+			return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		};
+
+		pPlanes[0] = row(3) + row(0);	// Left
+		pPlanes[1] = row(3) - row(0);	// Right
+		pPlanes[2] = row(3) + row(1);	// Bottom, top when Y is flipped, either way both are there
+		pPlanes[3] = row(3) - row(1);
+		pPlanes[4] = row(3) + row(2);	// Near
+		pPlanes[5] = row(3) - row(2);	// Far
+
+		for (int i = 0; i < 6; ++i) {
+			pPlanes[i] /= glm::length(glm::vec3(pPlanes[i]));
+		}
+	}
+}
+
+void GpuCuller::lazyInit(
+	VkPhysicalDevice physicalDevice,
+	VkDevice logicalDevice,
+	VulkanDeviceFeatures const &features,
+	uint32_t maxInstances,
+	std::vector<uint32_t> const &cullShaderCode,
+	DescriptorAllocator &descriptorAllocator,
+	PipelineLayoutCache &layoutCache,
+	VkPipelineCache pipelineCache )
+{
+	mLogicalDevice = logicalDevice;
+	mMaxInstances = maxInstances;
+	mInstanceCount = 0;
+	mMultiDrawIndirect = features.supportsMultiDrawIndirect();
+
+	mpDrawIndexedIndirectCount = nullptr;
+	if (features.supportsDrawIndirectCount()) {
+		mpDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)
+			vkGetDeviceProcAddr(logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+
+	mInstanceBuffer.lazyInit(
+		logicalDevice,
+		physicalDevice,
+		getInstanceBufferSize(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	);
+	mpInstances = static_cast<GpuInstance *>(mInstanceBuffer.map());
+
+	mDrawBuffer.lazyInit(
+		logicalDevice,
+		physicalDevice,
+		sizeof(VkDrawIndexedIndirectCommand) * maxInstances,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	mCountBuffer.lazyInit(
+		logicalDevice,
+		physicalDevice,
+		sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	createDescriptorSet(descriptorAllocator, layoutCache);
+	createPipeline(cullShaderCode, pipelineCache);
+}
+
+void GpuCuller::setInstances(std::vector<GpuInstance> const &instances)
+{
+	if (instances.size() > mMaxInstances) {
+		throw std::runtime_error("Too many instances for the GPU culler!");
+	}
+
+	memcpy(mpInstances, instances.data(), sizeof(GpuInstance) * instances.size());
+	mInstanceCount = static_cast<uint32_t>(instances.size());
+}
+
+void GpuCuller::recordReset(VkCommandBuffer commandBuffer)
+{
+	vkCmdFillBuffer(commandBuffer, mCountBuffer.getBufferHandle(), 0, sizeof(uint32_t), 0);
+}
+
+void GpuCuller::recordCull(VkCommandBuffer commandBuffer, glm::mat4 const &viewProjection)
+{
+	CullPushConstants cull{};
+	getFrustumPlanes(viewProjection, cull.frustumPlanes);
+	cull.instanceCount = mInstanceCount;
+	cull.compact = usesDrawCount() ? 1 : 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+	vkCmdBindDescriptorSets(
+		commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(
+		commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &cull);
+
+	// Also with no instances, the pass still has to leave a valid (empty) draw list behind
+	vkCmdDispatch(commandBuffer, std::max(1u, (mInstanceCount + kCullGroupSize - 1) / kCullGroupSize), 1, 1);
+}
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer)
+{
+	uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (usesDrawCount()) {
+		mpDrawIndexedIndirectCount(
+			commandBuffer, mDrawBuffer.getBufferHandle(), 0, mCountBuffer.getBufferHandle(), 0, mInstanceCount, stride);
+	} else if (mMultiDrawIndirect) {
+		vkCmdDrawIndexedIndirect(commandBuffer, mDrawBuffer.getBufferHandle(), 0, mInstanceCount, stride);
+	} else {
+		for (uint32_t instance = 0; instance < mInstanceCount; ++instance) {
+			vkCmdDrawIndexedIndirect(commandBuffer, mDrawBuffer.getBufferHandle(), instance * stride, 1, stride);
+		}
+	}
+}
+
+void GpuCuller::cleanUp()
+{
+	vkDestroyPipeline(mLogicalDevice, mPipeline, nullptr);
+	vkDestroyPipelineLayout(mLogicalDevice, mPipelineLayout, nullptr);
+
+	mInstanceBuffer.cleanUp();
+	mDrawBuffer.cleanUp();
+	mCountBuffer.cleanUp();
+	mpInstances = nullptr;
+}
+
+void GpuCuller::createDescriptorSet(DescriptorAllocator &descriptorAllocator, PipelineLayoutCache &layoutCache)
+{
+	// 0: instances, 1: draw commands, 2: draw count
+	std::vector<VkDescriptorSetLayoutBinding> bindings(3);
+
+	for (uint32_t i = 0; i < bindings.size(); ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	mDescriptorSetLayout = layoutCache.getDescriptorSetLayout(bindings);
+	mDescriptorSet = descriptorAllocator.allocate(mDescriptorSetLayout);
+
+	std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+	bufferInfos[0].buffer = mInstanceBuffer.getBufferHandle();
+	bufferInfos[1].buffer = mDrawBuffer.getBufferHandle();
+	bufferInfos[2].buffer = mCountBuffer.getBufferHandle();
+
+	std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+	for (uint32_t i = 0; i < descriptorWrites.size(); ++i) {
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = mDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(
+		mLogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void GpuCuller::createPipeline(std::vector<uint32_t> const &code, VkPipelineCache pipelineCache)
+{
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+	moduleInfo.pCode = code.data();
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(mLogicalDevice, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling shader module!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &mDescriptorSetLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(mLogicalDevice, &layoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+		vkDestroyShaderModule(mLogicalDevice, shaderModule, nullptr);
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = mPipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(mLogicalDevice, pipelineCache, 1, &pipelineInfo, nullptr, &mPipeline);
+
+	// The pipeline keeps what it needs from the module
+	vkDestroyShaderModule(mLogicalDevice, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline!");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "InstanceBuffer.h"
+
+#include <stdexcept>
+
+void InstanceBuffer::lazyInit(
+	VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t frameCount, uint32_t maxInstancesPerFrame)
+{
+	mMaxInstances = maxInstancesPerFrame;
+
+	mFrames.resize(frameCount);
+	mMappedFrames.resize(frameCount);
+
+	for (uint32_t frame = 0; frame < frameCount; ++frame) {
+		mFrames[frame] = std::make_unique<VulkanBuffer>(
+			logicalDevice,
+			physicalDevice,
+			sizeof(InstanceData) * maxInstancesPerFrame,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT	// The GPU reads it every frame, so prefer memory close to it
+		);
+
+		mMappedFrames[frame] = static_cast<InstanceData *>(mFrames[frame]->map());
+	}
+}
+
+void InstanceBuffer::beginFrame(uint32_t frame)
+{
+	mFrame = frame;
+	mInstanceCount = 0;
+}
+
+uint32_t InstanceBuffer::add(glm::mat4 const *pTransforms, uint32_t count)
+{
+	if (count > mMaxInstances - mInstanceCount) {
+		throw std::runtime_error("Too many instances for this frame!");
+	}
+
+	uint32_t firstInstance = mInstanceCount;
+	InstanceData *pInstances = mMappedFrames[mFrame] + firstInstance;
+
+	for (uint32_t instance = 0; instance < count; ++instance) {
+		pInstances[instance].model = pTransforms[instance];
+	}
+
+	mInstanceCount += count;
+
+	return firstInstance;
+}
+
+void InstanceBuffer::cleanUp()
+{
+	for (std::unique_ptr<VulkanBuffer> &pFrame : mFrames) {
+		pFrame->cleanUp();
+	}
+
+	mFrames.clear();
+	mMappedFrames.clear();
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// Which deque the current thread owns, for the system it is a worker of
+	thread_local JobSystem const *tpWorkerOf = nullptr;
+	thread_local uint32_t tQueueIndex = 0;
+}
+
+void JobSystem::lazyInit(uint32_t workerCount)
+{
+	if (workerCount == 0) {
+		// hardware_concurrency may not know and say 0
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	mStopping = false;
+
+	mQueues.clear();
+	for (uint32_t i = 0; i <= workerCount; ++i) {
+		mQueues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	mWorkers.reserve(workerCount);
+	for (uint32_t i = 1; i <= workerCount; ++i) {
+		mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+void JobSystem::run(Job job, JobCounter *pCounter)
+{
+	if (pCounter) {
+		pCounter->mCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	push({ std::move(job), pCounter });
+}
+
+void JobSystem::runAfter(JobCounter &dependency, Job job, JobCounter *pCounter)
+{
+	if (pCounter) {
+		pCounter->mCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.mMutex);
+
+		if (!dependency.isDone()) {
+			dependency.mContinuations.emplace_back(std::move(job), pCounter);
+			return;
+		}
+	}
+
+	push({ std::move(job), pCounter });
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	uint32_t queueIndex = getQueueIndex();
+
+	while (!counter.isDone()) {
+		if (!tryRunOne(queueIndex)) {
+			// What's left is running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	// The last job to finish may still hold the lock, it has to let go before counter can go away
+	std::lock_guard<std::mutex> lock(counter.mMutex);
+}
+
+void JobSystem::cleanUp()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStopping = true;
+	}
+
+	mWakeUp.notify_all();
+
+	for (std::thread &worker : mWorkers) {
+		worker.join();
+	}
+
+	mWorkers.clear();
+	mQueues.clear();
+}
+
+void JobSystem::push(QueuedJob queuedJob)
+{
+	WorkQueue &queue = *mQueues[getQueueIndex()];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(queuedJob));
+	}
+
+	mQueuedJobs.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders this against a worker checking for work right before it sleeps
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+
+	mWakeUp.notify_one();
+}
+
+bool JobSystem::pop(uint32_t queueIndex, QueuedJob &queuedJob)
+{
+	WorkQueue &queue = *mQueues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.jobs.empty()) {
+		return false;
+	}
+
+	queuedJob = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+bool JobSystem::steal(uint32_t thiefIndex, QueuedJob &queuedJob)
+{
+	uint32_t queueCount = static_cast<uint32_t>(mQueues.size());
+
+	// Start with the neighbour so thieves spread out over the victims
+	for (uint32_t i = 1; i < queueCount; ++i) {
+		WorkQueue &queue = *mQueues[(thiefIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.jobs.empty()) {
+			queuedJob = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::tryRunOne(uint32_t queueIndex)
+{
+	QueuedJob queuedJob;
+
+	if (!pop(queueIndex, queuedJob) && !steal(queueIndex, queuedJob)) {
+		return false;
+	}
+
+	queuedJob.job();
+	finish(queuedJob.pCounter);
+
+	return true;
+}
+
+void JobSystem::finish(JobCounter *pCounter)
+{
+	if (!pCounter) {
+		return;
+	}
+
+	std::vector<std::pair<Job, JobCounter *>> continuations;
+
+	{
+		std::lock_guard<std::mutex> lock(pCounter->mMutex);
+
+		if (pCounter->mCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			continuations.swap(pCounter->mContinuations);
+		}
+	}
+
+	// pCounter may be gone by now, the continuations were moved out before letting go of the lock
+	for (auto &continuation : continuations) {
+		push({ std::move(continuation.first), continuation.second });
+	}
+}
+
+void JobSystem::workerLoop(uint32_t queueIndex)
+{
+	tpWorkerOf = this;
+	tQueueIndex = queueIndex;
+
+	while (true) {
+		if (tryRunOne(queueIndex)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mWakeUp.wait(lock, [this]() { return mStopping || mQueuedJobs.load(std::memory_order_acquire) > 0; });
+
+		if (mStopping && mQueuedJobs.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+	}
+}
+
+uint32_t JobSystem::getQueueIndex() const
+{
+	return tpWorkerOf == this ? tQueueIndex : 0;
+}
\ No newline at end of file
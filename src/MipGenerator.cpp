@@ -0,0 +1,450 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "JobSystem.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define MIP_GENERATOR_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Below this many rows per thread, starting the threads costs more than the rows do
+	const uint32_t kMinRowsPerThread = 16;
+
+	// Keeps every level at an offset vkCmdCopyBufferToImage accepts for any color format
+	const size_t kLevelAlignment = 4;
+
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	/**
+	 * Decoding is a plain lookup. Encoding searches the linear values halfway between two sRGB
+	 *  codes, which rounds to the nearest code in sRGB space without calling pow per texel.
+	 */
+	struct SrgbTables
+	{
+		SrgbTables()
+		{
+			for (uint32_t i = 0; i < 256; ++i) {
+				toLinear[i] = srgbToLinear(i / 255.0f);
+			}
+
+			for (uint32_t i = 0; i < 255; ++i) {
+				thresholds[i] = srgbToLinear((i + 0.5f) / 255.0f);
+			}
+		}
+
+		std::array<float, 256> toLinear{};
+		std::array<float, 255> thresholds{};
+	};
+
+	SrgbTables const &getSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	uint8_t encodeSrgb(SrgbTables const &tables, float value)
+	{
+		return static_cast<uint8_t>(std::upper_bound(tables.thresholds.begin(), tables.thresholds.end(), value) - tables.thresholds.begin());
+	}
+
+	uint8_t encodeUnorm(float value)
+	{
+		return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+	double besselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	/**
+	 * Adds neighboring texels pairwise, C floats per texel: 8 source floats in, 4 floats out.
+	 *  Source texel 2i and 2i + 1 end up in output texel i.
+	 */
+#if defined(MIP_GENERATOR_SSE2)
+	template<uint32_t C>
+	__m128 addTexelPairs(float const *pSrc)
+	{
+		__m128 a = _mm_loadu_ps(pSrc);
+		__m128 b = _mm_loadu_ps(pSrc + 4);
+
+		if constexpr (C == 1) {
+			return _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		} else if constexpr (C == 2) {
+			return _mm_add_ps(_mm_movelh_ps(a, b), _mm_movehl_ps(b, a));
+		} else {
+			return _mm_add_ps(a, b);
+		}
+	}
+#elif defined(MIP_GENERATOR_NEON)
+	template<uint32_t C>
+	float32x4_t addTexelPairs(float const *pSrc)
+	{
+		float32x4_t a = vld1q_f32(pSrc);
+		float32x4_t b = vld1q_f32(pSrc + 4);
+
+		if constexpr (C == 1) {
+			float32x4x2_t split = vuzpq_f32(a, b);
+			return vaddq_f32(split.val[0], split.val[1]);
+		} else if constexpr (C == 2) {
+			return vaddq_f32(vcombine_f32(vget_low_f32(a), vget_low_f32(b)), vcombine_f32(vget_high_f32(a), vget_high_f32(b)));
+		} else {
+			return vaddq_f32(a, b);
+		}
+	}
+#endif
+
+	/**
+	 * One output row of the 2x2 box filter from source rows pRow0 and pRow1. Needs at least
+	 *  2 * dstWidth source texels per row, the 1 texel wide case is handled by the caller.
+	 */
+	template<uint32_t C>
+	void boxRow(float const *pRow0, float const *pRow1, float *pDst, uint32_t dstWidth)
+	{
+		uint32_t count = dstWidth * C;
+		uint32_t i = 0;
+
+#if defined(__AVX__)
+		if constexpr (C == 4) {
+			__m256 quarter = _mm256_set1_ps(0.25f);
+
+			// Two output texels from four source texels per row
+			for (; i + 8 <= count; i += 8) {
+				__m256 a0 = _mm256_loadu_ps(pRow0 + 2 * i);
+				__m256 b0 = _mm256_loadu_ps(pRow0 + 2 * i + 8);
+				__m256 a1 = _mm256_loadu_ps(pRow1 + 2 * i);
+				__m256 b1 = _mm256_loadu_ps(pRow1 + 2 * i + 8);
+
+				__m256 row0 = _mm256_add_ps(_mm256_permute2f128_ps(a0, b0, 0x20), _mm256_permute2f128_ps(a0, b0, 0x31));
+				__m256 row1 = _mm256_add_ps(_mm256_permute2f128_ps(a1, b1, 0x20), _mm256_permute2f128_ps(a1, b1, 0x31));
+
+				_mm256_storeu_ps(pDst + i, _mm256_mul_ps(_mm256_add_ps(row0, row1), quarter));
+			}
+		}
+#endif
+
+#if defined(MIP_GENERATOR_SSE2)
+		__m128 quarter = _mm_set1_ps(0.25f);
+
+		for (; i + 4 <= count; i += 4) {
+			__m128 sum = _mm_add_ps(addTexelPairs<C>(pRow0 + 2 * i), addTexelPairs<C>(pRow1 + 2 * i));
+			_mm_storeu_ps(pDst + i, _mm_mul_ps(sum, quarter));
+		}
+#elif defined(MIP_GENERATOR_NEON)
+		for (; i + 4 <= count; i += 4) {
+			float32x4_t sum = vaddq_f32(addTexelPairs<C>(pRow0 + 2 * i), addTexelPairs<C>(pRow1 + 2 * i));
+			vst1q_f32(pDst + i, vmulq_n_f32(sum, 0.25f));
+		}
+#endif
+
+		// Whatever is left over, or everything without SIMD
+		for (; i < count; ++i) {
+			uint32_t src = (i / C) * 2 * C + i % C;
+			pDst[i] = 0.25f * (pRow0[src] + pRow0[src + C] + pRow1[src] + pRow1[src + C]);
+		}
+	}
+}
+
+template<typename Fn>
+void MipGenerator::forEachRowRange(uint32_t rows, Fn fn) const
+{
+	if (mpJobSystem) {
+		mpJobSystem->parallelFor(rows, kMinRowsPerThread, fn);
+		return;
+	}
+
+	uint32_t threadCount = std::min(mThreadCount, std::max(1u, rows / kMinRowsPerThread));
+	uint32_t rowsPerThread = (rows + threadCount - 1) / threadCount;
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+
+	// The threads point at fn, they have to be joined before an exception can leave
+	auto joinAll = [&threads]() {
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+	};
+
+	try {
+		for (uint32_t firstRow = rowsPerThread; firstRow < rows; firstRow += rowsPerThread) {
+			threads.emplace_back(fn, firstRow, std::min(rows, firstRow + rowsPerThread));
+		}
+
+		// This thread takes the first range instead of just waiting
+		fn(0, std::min(rows, rowsPerThread));
+	} catch (...) {
+		joinAll();
+		throw;
+	}
+
+	joinAll();
+}
+
+MipGenerator::MipGenerator(Filter filter, uint32_t threadCount, JobSystem *pJobSystem)
+	: mFilter(filter)
+	, mThreadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency()))
+	, mpJobSystem(pJobSystem)
+{
+	// Windowed sinc with its first zero at 2 source texels, which is the new Nyquist limit,
+	//  cut off after 3 source texels. Beta = 4 trades a little sharpness for less ringing.
+	const double radius = 3.0;
+	const double beta = 4.0;
+	const double pi = 3.14159265358979323846;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < mKaiserWeights.size(); ++i) {
+		double distance = i + 0.5;
+		double x = distance / 2.0;
+		double sinc = std::sin(pi * x) / (pi * x);
+		double t = distance / radius;
+		double window = besselI0(beta * std::sqrt(1.0 - t * t)) / besselI0(beta);
+
+		mKaiserWeights[i] = static_cast<float>(sinc * window);
+		sum += 2.0 * mKaiserWeights[i];
+	}
+
+	for (float &weight : mKaiserWeights) {
+		weight = static_cast<float>(weight / sum);
+	}
+}
+
+uint32_t MipGenerator::getMipLevelCount(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+/**
+ * Same extents as the blit path: each level is half the one above, rounded down, and never
+ *  smaller than 1.
+ */
+std::vector<MipLevel> MipGenerator::getChainLayout(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t channels)
+{
+	std::vector<MipLevel> levels(mipLevels);
+	size_t offset = 0;
+
+	for (MipLevel &level : levels) {
+		level.width = width;
+		level.height = height;
+		level.offset = offset;
+		level.size = static_cast<size_t>(width) * height * channels;
+
+		offset = alignUp(offset + level.size, kLevelAlignment);
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+
+	return levels;
+}
+
+size_t MipGenerator::getChainSize(std::vector<MipLevel> const &levels)
+{
+	return levels.empty() ? 0 : alignUp(levels.back().offset + levels.back().size, kLevelAlignment);
+}
+
+void MipGenerator::generate(uint8_t *pChain, std::vector<MipLevel> const &levels, uint32_t channels, bool isSrgb) const
+{
+	if (levels.size() < 2) {
+		return;
+	}
+
+	SrgbTables const &tables = getSrgbTables();
+
+	// Alpha is coverage, not light, so it is never gamma converted
+	uint32_t alphaChannel = channels > 1 ? channels - 1 : channels;
+
+	std::vector<float> src(levels[0].size);
+	std::vector<float> dst;
+
+	forEachRowRange(levels[0].height, [&](uint32_t firstRow, uint32_t lastRow) {
+		size_t rowSize = static_cast<size_t>(levels[0].width) * channels;
+
+		for (size_t i = firstRow * rowSize; i < lastRow * rowSize; ++i) {
+			bool isColor = isSrgb && i % channels != alphaChannel;
+			src[i] = isColor ? tables.toLinear[pChain[i]] : pChain[i] / 255.0f;
+		}
+	});
+
+	for (size_t level = 1; level < levels.size(); ++level) {
+		MipLevel const &above = levels[level - 1];
+		MipLevel const &current = levels[level];
+
+		dst.resize(current.size);
+
+		if (mFilter == Filter::Box) {
+			downsampleBox(src.data(), above.width, above.height, dst.data(), current.width, current.height, channels);
+		} else {
+			downsampleKaiser(src.data(), above.width, above.height, dst.data(), current.width, current.height, channels);
+		}
+
+		uint8_t *pLevel = pChain + current.offset;
+
+		forEachRowRange(current.height, [&](uint32_t firstRow, uint32_t lastRow) {
+			size_t rowSize = static_cast<size_t>(current.width) * channels;
+
+			for (size_t i = firstRow * rowSize; i < lastRow * rowSize; ++i) {
+				bool isColor = isSrgb && i % channels != alphaChannel;
+				pLevel[i] = isColor ? encodeSrgb(tables, dst[i]) : encodeUnorm(dst[i]);
+			}
+		});
+
+		// The next level filters these floats, not the rounded 8 bit values
+		std::swap(src, dst);
+	}
+}
+
+void MipGenerator::downsampleBox(
+	float const *pSrc,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	float *pDst,
+	uint32_t dstWidth,
+	uint32_t dstHeight,
+	uint32_t channels ) const
+{
+	// An odd source has a texel left over after the last pair, the last output column or row takes it in as a third tap
+	bool hasOddColumn = srcWidth > 1 && srcWidth % 2 == 1;
+	bool hasOddRow = srcHeight > 1 && srcHeight % 2 == 1;
+
+	forEachRowRange(dstHeight, [&](uint32_t firstRow, uint32_t lastRow) {
+		size_t srcRowSize = static_cast<size_t>(srcWidth) * channels;
+		size_t dstRowSize = static_cast<size_t>(dstWidth) * channels;
+
+		for (uint32_t y = firstRow; y < lastRow; ++y) {
+			// A 1 texel tall source is averaged with itself
+			float const *pRow0 = pSrc + std::min(2 * y, srcHeight - 1) * srcRowSize;
+			float const *pRow1 = pSrc + std::min(2 * y + 1, srcHeight - 1) * srcRowSize;
+			float *pDstRow = pDst + y * dstRowSize;
+
+			bool isOddRow = hasOddRow && y == dstHeight - 1;
+			float const *pRow2 = isOddRow ? pSrc + (2 * y + 2) * srcRowSize : nullptr;
+
+			if (srcWidth == 1) {
+				for (uint32_t c = 0; c < channels; ++c) {
+					pDstRow[c] = isOddRow ? (pRow0[c] + pRow1[c] + pRow2[c]) / 3.0f : 0.5f * (pRow0[c] + pRow1[c]);
+				}
+				continue;
+			}
+
+			if (channels == 1) {
+				boxRow<1>(pRow0, pRow1, pDstRow, dstWidth);
+			} else if (channels == 2) {
+				boxRow<2>(pRow0, pRow1, pDstRow, dstWidth);
+			} else {
+				boxRow<4>(pRow0, pRow1, pDstRow, dstWidth);
+			}
+
+			// Once per level, not worth vectorizing: 4 texels averaged above, 2 more from the third row
+			if (isOddRow) {
+				for (size_t i = 0; i < dstRowSize; ++i) {
+					size_t src = (i / channels) * 2 * channels + i % channels;
+					pDstRow[i] = (4.0f * pDstRow[i] + pRow2[src] + pRow2[src + channels]) / 6.0f;
+				}
+			}
+
+			if (hasOddColumn) {
+				size_t src = static_cast<size_t>(2 * (dstWidth - 1)) * channels;
+				float *pLast = pDstRow + dstRowSize - channels;
+
+				for (uint32_t c = 0; c < channels; ++c) {
+					float sum = 0.0f;
+					for (size_t x = src + c; x <= src + 2 * channels + c; x += channels) {
+						sum += pRow0[x] + pRow1[x] + (isOddRow ? pRow2[x] : 0.0f);
+					}
+
+					pLast[c] = sum / (isOddRow ? 9.0f : 6.0f);
+				}
+			}
+		}
+	});
+}
+
+/**
+ * Separable: rows are filtered horizontally into a half width image first, then that is
+ *  filtered vertically. Taps past the edges repeat the edge texel.
+ */
+void MipGenerator::downsampleKaiser(
+	float const *pSrc,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	float *pDst,
+	uint32_t dstWidth,
+	uint32_t dstHeight,
+	uint32_t channels ) const
+{
+	// Source texels 2i - 2 to 2i + 3 around output texel i, which sits between 2i and 2i + 1
+	const float taps[6] = {
+		mKaiserWeights[2], mKaiserWeights[1], mKaiserWeights[0],
+		mKaiserWeights[0], mKaiserWeights[1], mKaiserWeights[2]
+	};
+
+	size_t dstRowSize = static_cast<size_t>(dstWidth) * channels;
+	std::vector<float> horizontal(dstRowSize * srcHeight);
+
+	forEachRowRange(srcHeight, [&](uint32_t firstRow, uint32_t lastRow) {
+		size_t srcRowSize = static_cast<size_t>(srcWidth) * channels;
+
+		for (uint32_t y = firstRow; y < lastRow; ++y) {
+			float const *pSrcRow = pSrc + y * srcRowSize;
+			float *pOutRow = horizontal.data() + y * dstRowSize;
+
+			for (uint32_t x = 0; x < dstWidth; ++x) {
+				for (uint32_t c = 0; c < channels; ++c) {
+					float sum = 0.0f;
+
+					for (int32_t k = 0; k < 6; ++k) {
+						int32_t srcX = std::clamp(static_cast<int32_t>(2 * x) + k - 2, 0, static_cast<int32_t>(srcWidth) - 1);
+						sum += taps[k] * pSrcRow[srcX * channels + c];
+					}
+
+					pOutRow[x * channels + c] = sum;
+				}
+			}
+		}
+	});
+
+	forEachRowRange(dstHeight, [&](uint32_t firstRow, uint32_t lastRow) {
+		for (uint32_t y = firstRow; y < lastRow; ++y) {
+			float *pDstRow = pDst + y * dstRowSize;
+			std::fill(pDstRow, pDstRow + dstRowSize, 0.0f);
+
+			for (int32_t k = 0; k < 6; ++k) {
+				int32_t srcY = std::clamp(static_cast<int32_t>(2 * y) + k - 2, 0, static_cast<int32_t>(srcHeight) - 1);
+				float const *pInRow = horizontal.data() + srcY * dstRowSize;
+
+				for (size_t i = 0; i < dstRowSize; ++i) {
+					pDstRow[i] += taps[k] * pInRow[i];
+				}
+			}
+		}
+	});
+}
\ No newline at end of file
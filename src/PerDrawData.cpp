@@ -0,0 +1,22 @@
+#include "PerDrawData.h"
+
+#include <stdexcept>
+
+void PerDrawDataBinder::setPushConstantRange(VkPushConstantRange const &range)
+{
+	// The block may leave out PerDrawData's padding, not anything else
+	if (range.offset != 0 || range.size > sizeof(PerDrawData)) {
+		throw std::runtime_error("Push constants of the shaders don't match PerDrawData!");
+	}
+
+	mPushConstantRange = range;
+}
+
+void PerDrawDataBinder::record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, PerDrawData const &data) const
+{
+	if (mPushConstantRange.size == 0) {
+		return;	// No shader reads it
+	}
+
+	vkCmdPushConstants(commandBuffer, pipelineLayout, mPushConstantRange.stageFlags, 0, mPushConstantRange.size, &data);
+}
\ No newline at end of file
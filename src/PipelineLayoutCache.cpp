@@ -0,0 +1,137 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "VulkanUtils.h"
+
+void PipelineLayoutCache::lazyInit(VkDevice logicalDevice)
+{
+	mLogicalDevice = logicalDevice;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout(ShaderReflection const &reflection, uint32_t set)
+{
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+
+	for (ShaderReflection::Binding const &binding : reflection.getBindings()) {
+		if (binding.set != set) {
+			continue;
+		}
+
+		// Runtime sized arrays need binding flags and a variable count, which only their owner knows
+		if (binding.count == 0) {
+			throw std::runtime_error("Set " + std::to_string(set) + " has a runtime sized array, pass its layout as an external set!");
+		}
+
+		VkDescriptorSetLayoutBinding layoutBinding{};
+		layoutBinding.binding = binding.binding;
+		layoutBinding.descriptorType = binding.type;
+		layoutBinding.descriptorCount = binding.count;
+		layoutBinding.stageFlags = binding.stages;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		layoutBindings.push_back(layoutBinding);
+	}
+
+	return getDescriptorSetLayout(layoutBindings);
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> const &layoutBindings)
+{
+	uint64_t key = vkutils::kHashOffset;
+
+	for (VkDescriptorSetLayoutBinding const &layoutBinding : layoutBindings) {
+		vkutils::hashValue(key, layoutBinding.binding);
+		vkutils::hashValue(key, layoutBinding.descriptorType);
+		vkutils::hashValue(key, layoutBinding.descriptorCount);
+		vkutils::hashValue(key, layoutBinding.stageFlags);
+	}
+	vkutils::hashValue(key, layoutBindings.size());
+
+	auto found = mSetLayouts.find(key);
+	if (found != mSetLayouts.end()) {
+		return found->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	layoutInfo.pBindings = layoutBindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	if (vkCreateDescriptorSetLayout(mLogicalDevice, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+
+	mSetLayouts.emplace(key, setLayout);
+
+	return setLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout(
+	ShaderReflection const &reflection, std::map<uint32_t, VkDescriptorSetLayout> const &externalSets )
+{
+	uint32_t setCount = 0;
+
+	for (ShaderReflection::Binding const &binding : reflection.getBindings()) {
+		setCount = std::max(setCount, binding.set + 1);
+	}
+
+	// Sets in between that no shader uses still need a layout, an empty one does
+	std::vector<VkDescriptorSetLayout> setLayouts(setCount);
+
+	for (uint32_t set = 0; set < setCount; ++set) {
+		auto external = externalSets.find(set);
+		setLayouts[set] = external != externalSets.end() ? external->second : getDescriptorSetLayout(reflection, set);
+	}
+
+	std::vector<VkPushConstantRange> const &pushConstantRanges = reflection.getPushConstantRanges();
+
+	// The set layouts are already deduplicated, their handles are as good as their contents
+	uint64_t key = vkutils::kHashOffset;
+	vkutils::hashVector(key, setLayouts);
+
+	for (VkPushConstantRange const &range : pushConstantRanges) {
+		vkutils::hashValue(key, range.stageFlags);
+		vkutils::hashValue(key, range.offset);
+		vkutils::hashValue(key, range.size);
+	}
+	vkutils::hashValue(key, pushConstantRanges.size());
+
+	auto found = mPipelineLayouts.find(key);
+	if (found != mPipelineLayouts.end()) {
+		return found->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = setCount;
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	if (vkCreatePipelineLayout(mLogicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline layout!");
+	}
+
+	mPipelineLayouts.emplace(key, pipelineLayout);
+
+	return pipelineLayout;
+}
+
+void PipelineLayoutCache::cleanUp()
+{
+	for (auto &pipelineLayout : mPipelineLayouts) {
+		vkDestroyPipelineLayout(mLogicalDevice, pipelineLayout.second, nullptr);
+	}
+
+	for (auto &setLayout : mSetLayouts) {
+		vkDestroyDescriptorSetLayout(mLogicalDevice, setLayout.second, nullptr);
+	}
+
+	mPipelineLayouts.clear();
+	mSetLayouts.clear();
+}
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "PipelineStateCache.h"
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+
+#include "VulkanUtils.h"
+
+namespace
+{
+	// What VkSpecializationInfo points into, has to stay put until the pipeline is created
+	struct Specialization
+	{
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint32_t> data;
+		VkSpecializationInfo info{};
+	};
+
+	VkSpecializationInfo const *specialize(SpecializationConstants const &constants, Specialization &specialization)
+	{
+		if (constants.empty()) {
+			return nullptr;
+		}
+
+		for (auto const &constant : constants) {
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constant.first;
+			entry.offset = static_cast<uint32_t>(specialization.data.size() * sizeof(uint32_t));
+			entry.size = sizeof(uint32_t);
+
+			specialization.entries.push_back(entry);
+			specialization.data.push_back(constant.second);
+		}
+
+		specialization.info.mapEntryCount = static_cast<uint32_t>(specialization.entries.size());
+		specialization.info.pMapEntries = specialization.entries.data();
+		specialization.info.dataSize = specialization.data.size() * sizeof(uint32_t);
+		specialization.info.pData = specialization.data.data();
+
+		return &specialization.info;
+	}
+
+	void hashConstants(uint64_t &hash, SpecializationConstants const &constants)
+	{
+		for (auto const &constant : constants) {
+			vkutils::hashValue(hash, constant.first);
+			vkutils::hashValue(hash, constant.second);
+		}
+		vkutils::hashValue(hash, constants.size());
+	}
+
+	// Whatever hash() takes in, compared the same way
+	bool sameState(GraphicsPipelineDesc const &a, GraphicsPipelineDesc const &b)
+	{
+		if (a.vertexShader != b.vertexShader || a.fragmentShader != b.fragmentShader ||
+			a.vertexConstants != b.vertexConstants || a.fragmentConstants != b.fragmentConstants ||
+			a.vertexBindings.size() != b.vertexBindings.size() ||
+			a.vertexAttributes.size() != b.vertexAttributes.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < a.vertexBindings.size(); ++i) {
+			VkVertexInputBindingDescription const &x = a.vertexBindings[i], &y = b.vertexBindings[i];
+			if (x.binding != y.binding || x.stride != y.stride || x.inputRate != y.inputRate) {
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < a.vertexAttributes.size(); ++i) {
+			VkVertexInputAttributeDescription const &x = a.vertexAttributes[i], &y = b.vertexAttributes[i];
+			if (x.location != y.location || x.binding != y.binding || x.format != y.format || x.offset != y.offset) {
+				return false;
+			}
+		}
+
+		return a.topology == b.topology && a.polygonMode == b.polygonMode && a.cullMode == b.cullMode &&
+			a.frontFace == b.frontFace && a.depthTest == b.depthTest && a.depthWrite == b.depthWrite &&
+			a.depthCompareOp == b.depthCompareOp && a.blendEnable == b.blendEnable && a.layout == b.layout &&
+			a.colorFormats == b.colorFormats && a.depthFormat == b.depthFormat && a.samples == b.samples &&
+			(a.renderPass == VK_NULL_HANDLE) == (b.renderPass == VK_NULL_HANDLE);
+	}
+
+	// Whether a pipeline created for one can be used where the other would have been
+	bool compatible(GraphicsPipelineDesc const &a, GraphicsPipelineDesc const &b)
+	{
+		return a.layout == b.layout && a.colorFormats == b.colorFormats && a.depthFormat == b.depthFormat &&
+			a.samples == b.samples && (a.renderPass == VK_NULL_HANDLE) == (b.renderPass == VK_NULL_HANDLE);
+	}
+}
+
+void PipelineStateCache::lazyInit(VkDevice logicalDevice, VkPipelineCache pipelineCache, JobSystem &jobSystem)
+{
+	mLogicalDevice = logicalDevice;
+	mPipelineCache = pipelineCache;
+	mpJobSystem = &jobSystem;
+}
+
+uint64_t PipelineStateCache::hash(GraphicsPipelineDesc const &desc)
+{
+	uint64_t hash = vkutils::kHashOffset;
+
+	vkutils::hashVector(hash, desc.vertexShader);
+	vkutils::hashVector(hash, desc.fragmentShader);
+	hashConstants(hash, desc.vertexConstants);
+	hashConstants(hash, desc.fragmentConstants);
+
+	// Field by field rather than whole structs, so padding never ends up in the hash
+	for (VkVertexInputBindingDescription const &binding : desc.vertexBindings) {
+		vkutils::hashValue(hash, binding.binding);
+		vkutils::hashValue(hash, binding.stride);
+		vkutils::hashValue(hash, binding.inputRate);
+	}
+	vkutils::hashValue(hash, desc.vertexBindings.size());
+
+	for (VkVertexInputAttributeDescription const &attribute : desc.vertexAttributes) {
+		vkutils::hashValue(hash, attribute.location);
+		vkutils::hashValue(hash, attribute.binding);
+		vkutils::hashValue(hash, attribute.format);
+		vkutils::hashValue(hash, attribute.offset);
+	}
+	vkutils::hashValue(hash, desc.vertexAttributes.size());
+
+	vkutils::hashValue(hash, desc.topology);
+	vkutils::hashValue(hash, desc.polygonMode);
+	vkutils::hashValue(hash, desc.cullMode);
+	vkutils::hashValue(hash, desc.frontFace);
+	vkutils::hashValue(hash, desc.depthTest);
+	vkutils::hashValue(hash, desc.depthWrite);
+	vkutils::hashValue(hash, desc.depthCompareOp);
+	vkutils::hashValue(hash, desc.blendEnable);
+	vkutils::hashValue(hash, desc.layout);
+
+	vkutils::hashVector(hash, desc.colorFormats);
+	vkutils::hashValue(hash, desc.depthFormat);
+	vkutils::hashValue(hash, desc.samples);
+	// A pipeline for dynamic rendering can't be used in a render pass and the other way around
+	vkutils::hashValue(hash, desc.renderPass == VK_NULL_HANDLE);
+
+	return hash;
+}
+
+uint64_t PipelineStateCache::prepare(GraphicsPipelineDesc const &desc)
+{
+	uint64_t key = hash(desc);
+
+	Entry *pEntry = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// A different state under the same hash moves on to the next key, until the same state or a free one
+		for (;; ++key) {
+			std::unique_ptr<Entry> &pSlot = mEntries[key];
+			if (!pSlot) {
+				pSlot = std::make_unique<Entry>();
+				pSlot->desc = desc;
+				pEntry = pSlot.get();
+				break;
+			}
+
+			if (sameState(pSlot->desc, desc)) {
+				return key;
+			}
+		}
+	}
+
+	// The entry never moves, the job can fill it in without the lock
+	mpJobSystem->run([this, pEntry, key]() {
+		pEntry->pipeline = compile(pEntry->desc);
+		if (pEntry->pipeline == VK_NULL_HANDLE) {
+			std::cerr << "[ERROR] Failed to create graphics pipeline " << std::hex << key << std::dec << "!" << std::endl;
+		}
+		pEntry->ready.store(true, std::memory_order_release);
+	}, &pEntry->compiled);
+
+	return key;
+}
+
+void PipelineStateCache::setFallback(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto entry = mEntries.find(key);
+	if (entry == mEntries.end()) {
+		throw std::runtime_error("Pipeline was never prepared!");
+	}
+
+	mpFallback = entry->second.get();
+}
+
+VkPipeline PipelineStateCache::get(uint64_t key) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto entry = mEntries.find(key);
+	if (entry == mEntries.end() || !entry->second->ready.load(std::memory_order_acquire)) {
+		return VK_NULL_HANDLE;
+	}
+
+	Entry const &found = *entry->second;
+	if (found.pipeline != VK_NULL_HANDLE || !mpFallback || !mpFallback->ready.load(std::memory_order_acquire) ||
+		!compatible(found.desc, mpFallback->desc)) {
+		return found.pipeline;
+	}
+
+	return mpFallback->pipeline;
+}
+
+VkPipeline PipelineStateCache::wait(uint64_t key)
+{
+	Entry *pEntry = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto entry = mEntries.find(key);
+		if (entry == mEntries.end()) {
+			throw std::runtime_error("Pipeline was never prepared!");
+		}
+
+		pEntry = entry->second.get();
+	}
+
+	mpJobSystem->wait(pEntry->compiled);
+
+	if (pEntry->pipeline == VK_NULL_HANDLE) {
+		throw std::runtime_error("Failed to create graphics pipeline!");
+	}
+
+	return pEntry->pipeline;
+}
+
+void PipelineStateCache::waitIdle()
+{
+	std::vector<Entry *> entries;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		for (auto &entry : mEntries) {
+			entries.push_back(entry.second.get());
+		}
+	}
+
+	for (Entry *pEntry : entries) {
+		mpJobSystem->wait(pEntry->compiled);
+	}
+}
+
+uint32_t PipelineStateCache::getPipelineCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	return static_cast<uint32_t>(mEntries.size());
+}
+
+void PipelineStateCache::cleanUp()
+{
+	waitIdle();
+
+	for (auto &entry : mEntries) {
+		vkDestroyPipeline(mLogicalDevice, entry.second->pipeline, nullptr);
+	}
+
+	mEntries.clear();
+	mpFallback = nullptr;
+}
+
+/**
+ * Runs on a worker, so nothing in here may throw; prepare() reports a VK_NULL_HANDLE back.
+ *  The pipeline cache is internally synchronized, several of these can use it at once.
+ */
+VkPipeline PipelineStateCache::compile(GraphicsPipelineDesc const &desc) const
+{
+	VkShaderModule vertShaderModule = createShaderModule(desc.vertexShader);
+	VkShaderModule fragShaderModule = createShaderModule(desc.fragmentShader);
+
+	if (vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE) {
+		vkDestroyShaderModule(mLogicalDevice, vertShaderModule, nullptr);
+		vkDestroyShaderModule(mLogicalDevice, fragShaderModule, nullptr);
+		return VK_NULL_HANDLE;
+	}
+
+	Specialization vertexSpecialization, fragmentSpecialization;
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main"; // Function to invoke in the shader, a.k.a the entrypoint
+	shaderStages[0].pSpecializationInfo = specialize(desc.vertexConstants, vertexSpecialization);
+
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+	shaderStages[1].pSpecializationInfo = specialize(desc.fragmentConstants, fragmentSpecialization);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = desc.vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = desc.vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = desc.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// Viewport and scissor are set while recording, so a new window size needs no new pipeline
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = desc.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = desc.cullMode;
+	rasterizer.frontFace = desc.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = desc.samples;
+	multisampling.minSampleShading = 1.0f;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = desc.depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	// Same for every color attachment
+	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(desc.colorFormats.size(), colorBlendAttachment);
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+	colorBlending.pAttachments = colorBlendAttachments.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = desc.layout;
+	pipelineInfo.renderPass = desc.renderPass;
+	pipelineInfo.subpass = desc.subpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+#ifdef VK_KHR_dynamic_rendering
+	// Without a render pass the attachment formats are all the pipeline needs to know
+	VkPipelineRenderingCreateInfoKHR renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(desc.colorFormats.size());
+	renderingInfo.pColorAttachmentFormats = desc.colorFormats.data();
+	renderingInfo.depthAttachmentFormat = desc.depthFormat;
+	renderingInfo.stencilAttachmentFormat =
+		vkutils::hasStencilComponent(desc.depthFormat) ? desc.depthFormat : VK_FORMAT_UNDEFINED;
+
+	if (desc.renderPass == VK_NULL_HANDLE) {
+		pipelineInfo.pNext = &renderingInfo;
+	}
+#endif
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateGraphicsPipelines(mLogicalDevice, mPipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule(mLogicalDevice, fragShaderModule, nullptr);
+	vkDestroyShaderModule(mLogicalDevice, vertShaderModule, nullptr);
+
+	return pipeline;
+}
+
+VkShaderModule PipelineStateCache::createShaderModule(std::vector<uint32_t> const &code) const
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size() * sizeof(uint32_t);	// In bytes
+	createInfo.pCode = code.data();
+
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	if (vkCreateShaderModule(mLogicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		return VK_NULL_HANDLE;
+	}
+
+	return shaderModule;
+}
\ No newline at end of file
@@ -0,0 +1,899 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "VulkanBaseObject.h"
+#include "VulkanDevices.h"
+
+namespace
+{
+	char const *getLayoutName(VkImageLayout layout)
+	{
+		switch (layout) {
+		case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+		case VK_IMAGE_LAYOUT_GENERAL: return "GENERAL";
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT_OPTIMAL";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT_OPTIMAL";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "DEPTH_STENCIL_READ_ONLY_OPTIMAL";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY_OPTIMAL";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC_OPTIMAL";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST_OPTIMAL";
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC_KHR";
+		default: return "OTHER";
+		}
+	}
+
+	char const *getLoadOpName(VkAttachmentLoadOp loadOp)
+	{
+		switch (loadOp) {
+		case VK_ATTACHMENT_LOAD_OP_LOAD: return "LOAD";
+		case VK_ATTACHMENT_LOAD_OP_CLEAR: return "CLEAR";
+		default: return "DONT_CARE";
+		}
+	}
+}
+
+void RenderGraph::lazyInit(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
+{
+	mPhysicalDevice = physicalDevice;
+	mLogicalDevice = logicalDevice;
+}
+
+void RenderGraph::useDynamicRendering(VulkanDeviceFeatures const &deviceFeatures)
+{
+#ifdef VK_KHR_dynamic_rendering
+	mpfnCmdBeginRendering = nullptr;
+	mpfnCmdEndRendering = nullptr;
+
+	if (mLogicalDevice == VK_NULL_HANDLE || !deviceFeatures.supportsDynamicRendering()) {
+		return;
+	}
+
+	// Promoted from VK_KHR_dynamic_rendering, which only has the suffixed names
+	bool isCore = deviceFeatures.getApiVersion() >= VK_API_VERSION_1_3;
+
+	PFN_vkCmdBeginRenderingKHR pfnCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(
+		mLogicalDevice, isCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR");
+	PFN_vkCmdEndRenderingKHR pfnCmdEndRendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(
+		mLogicalDevice, isCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR");
+
+	// Stay on render passes rather than fail if the driver doesn't hand out the entry points
+	if (pfnCmdBeginRendering && pfnCmdEndRendering) {
+		mpfnCmdBeginRendering = pfnCmdBeginRendering;
+		mpfnCmdEndRendering = pfnCmdEndRendering;
+	}
+#else
+	(void) deviceFeatures;
+#endif
+
+	mIsCompiled = false;
+}
+
+void RenderGraph::useSynchronization2(VulkanDeviceFeatures const &deviceFeatures)
+{
+	if (mLogicalDevice != VK_NULL_HANDLE) {
+		mBarrierBatcher.lazyInit(mLogicalDevice, deviceFeatures);
+	}
+}
+
+bool RenderGraph::usesDynamicRendering() const
+{
+#ifdef VK_KHR_dynamic_rendering
+	return mpfnCmdBeginRendering != nullptr;
+#else
+	return false;
+#endif
+}
+
+uint32_t RenderGraph::createImage(std::string name, ImageDesc const &desc)
+{
+	Resource resource;
+	resource.name = std::move(name);
+	resource.desc = desc;
+
+	mResources.push_back(std::move(resource));
+
+	return static_cast<uint32_t>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::importImage(
+	std::string name, ImageDesc const &desc, ResourceUsage initialUsage, ResourceUsage finalUsage, bool preserveContents )
+{
+	uint32_t index = createImage(std::move(name), desc);
+
+	Resource &resource = mResources[index];
+	resource.isImported = true;
+	resource.initialUsage = initialUsage;
+	resource.finalUsage = finalUsage;
+	resource.preserveContents = preserveContents;
+
+	return index;
+}
+
+uint32_t RenderGraph::importBuffer(std::string name, ResourceUsage initialUsage, ResourceUsage finalUsage)
+{
+	Resource resource;
+	resource.name = std::move(name);
+	resource.isImage = false;
+	resource.isImported = true;
+	resource.initialUsage = initialUsage;
+	resource.finalUsage = finalUsage;
+	resource.preserveContents = true;	// No layout to transition away from, the contents always stay
+
+	mResources.push_back(std::move(resource));
+
+	return static_cast<uint32_t>(mResources.size() - 1);
+}
+
+void RenderGraph::setImportedImage(uint32_t resource, VkImage image, VkImageView view)
+{
+	mResources[resource].image = image;
+	mResources[resource].view = view;
+}
+
+void RenderGraph::setImportedBuffer(uint32_t resource, VkBuffer buffer)
+{
+	mResources[resource].buffer = buffer;
+}
+
+uint32_t RenderGraph::addPass(std::string name, PassType type, ExecuteFn execute, VkSubpassContents contents)
+{
+	Pass pass;
+	pass.name = std::move(name);
+	pass.type = type;
+	pass.execute = std::move(execute);
+	pass.contents = contents;
+
+	mPasses.push_back(std::move(pass));
+
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::writeColor(uint32_t pass, uint32_t image, std::optional<VkClearColorValue> clear)
+{
+	std::optional<VkClearValue> clearValue;
+
+	if (clear) {
+		clearValue = VkClearValue{};
+		clearValue->color = *clear;
+	}
+
+	addAccess(pass, image, ResourceUsage::ColorAttachmentWrite, true, clearValue);
+}
+
+void RenderGraph::writeDepth(uint32_t pass, uint32_t image, std::optional<VkClearDepthStencilValue> clear)
+{
+	std::optional<VkClearValue> clearValue;
+
+	if (clear) {
+		clearValue = VkClearValue{};
+		clearValue->depthStencil = *clear;
+	}
+
+	addAccess(pass, image, ResourceUsage::DepthStencilAttachmentWrite, true, clearValue);
+}
+
+void RenderGraph::readDepth(uint32_t pass, uint32_t image)
+{
+	addAccess(pass, image, ResourceUsage::DepthStencilAttachmentRead, true, std::nullopt);
+}
+
+void RenderGraph::use(uint32_t pass, uint32_t resource, ResourceUsage usage)
+{
+	addAccess(pass, resource, usage, false, std::nullopt);
+}
+
+void RenderGraph::addAccess(
+	uint32_t pass, uint32_t resource, ResourceUsage usage, bool isAttachment, std::optional<VkClearValue> clear )
+{
+	if (isAttachment && mPasses[pass].type != PassType::Graphics) {
+		throw std::runtime_error("Render graph pass " + mPasses[pass].name + " isn't a graphics pass, it can't have attachments!");
+	}
+
+	mPasses[pass].accesses.push_back({ resource, usage, isAttachment, clear });
+	mIsCompiled = false;
+}
+
+void RenderGraph::compile()
+{
+	planLifetimes();
+	planAliasing();
+	planBarriers();
+
+	if (mLogicalDevice != VK_NULL_HANDLE) {
+		createTransientImages();
+
+		for (Pass &pass : mPasses) {
+			if (pass.type == PassType::Graphics && !usesDynamicRendering()) {
+				createRenderPass(pass);
+			}
+		}
+	}
+
+	mIsCompiled = true;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+	if (!mIsCompiled) {
+		throw std::runtime_error("Render graph has to be compiled before it is executed!");
+	}
+
+	for (Pass &pass : mPasses) {
+		recordBarriers(commandBuffer, pass.barriers);
+
+		if (pass.type != PassType::Graphics) {
+			PassContext context;
+			context.extent = pass.extent;
+
+			pass.execute(commandBuffer, context);
+		} else if (usesDynamicRendering()) {
+			executeDynamicRendering(commandBuffer, pass);
+		} else {
+			executeRenderPass(commandBuffer, pass);
+		}
+	}
+
+	recordBarriers(commandBuffer, mFinalBarriers);
+}
+
+std::string RenderGraph::dump() const
+{
+	std::ostringstream out;
+
+	auto dumpBarrier = [&](Barrier const &barrier) {
+		Resource const &resource = mResources[barrier.resource];
+
+		out << "  barrier " << resource.name << ": ";
+		if (resource.isImage) {
+			out << getLayoutName(barrier.oldLayout) << " -> " << getLayoutName(barrier.newLayout) << ", ";
+		}
+		// As vkCmdPipelineBarrier gets them
+		ResourceUsageMasks src = getResourceUsageMasks(barrier.srcUsages, true);
+		ResourceUsageMasks dst = getResourceUsageMasks(toUsageSet(barrier.dstUsage), false);
+
+		out << std::hex
+			<< "stages 0x" << src.stages << " -> 0x" << dst.stages
+			<< ", access 0x" << src.access << " -> 0x" << dst.access
+			<< std::dec << "\n";
+	};
+
+	for (size_t i = 0; i < mPasses.size(); ++i) {
+		Pass const &pass = mPasses[i];
+
+		out << "pass " << i << " " << pass.name << "\n";
+
+		for (Barrier const &barrier : pass.barriers) {
+			dumpBarrier(barrier);
+		}
+
+		for (Attachment const &attachment : pass.attachments) {
+			out << "  attachment " << mResources[attachment.resource].name << ": "
+				<< getLayoutName(attachment.layout)
+				<< ", load " << getLoadOpName(attachment.loadOp)
+				<< ", store " << (attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "STORE" : "DONT_CARE") << "\n";
+		}
+	}
+
+	out << "final\n";
+	for (Barrier const &barrier : mFinalBarriers) {
+		dumpBarrier(barrier);
+	}
+
+	for (size_t i = 0; i < mAliasGroups.size(); ++i) {
+		out << "memory " << i << ":";
+		for (uint32_t resource : mAliasGroups[i].resources) {
+			out << " " << mResources[resource].name;
+		}
+		out << "\n";
+	}
+
+	return out.str();
+}
+
+void RenderGraph::resize(VkExtent2D extent)
+{
+	if (!mIsCompiled) {
+		throw std::runtime_error("Render graph has to be compiled before it is resized!");
+	}
+
+	for (Resource &resource : mResources) {
+		if (resource.isImage) {
+			resource.desc.extent = extent;
+		}
+	}
+
+	// Only passes with attachments have an extent
+	for (Pass &pass : mPasses) {
+		if (pass.extent.width != 0) {
+			pass.extent = extent;
+		}
+	}
+
+	if (mLogicalDevice != VK_NULL_HANDLE) {
+		destroyFramebuffers();
+		destroyTransientImages();
+		createTransientImages();	// UNDEFINED again, which is what the first barrier of each expects anyway
+	}
+}
+
+void RenderGraph::cleanUp()
+{
+	if (mLogicalDevice != VK_NULL_HANDLE) {
+		destroyFramebuffers();
+
+		for (Pass &pass : mPasses) {
+			vkDestroyRenderPass(mLogicalDevice, pass.renderPass, nullptr);
+		}
+
+		destroyTransientImages();
+	}
+
+	mResources.clear();
+	mPasses.clear();
+	mAliasGroups.clear();
+	mFinalBarriers.clear();
+	mIsCompiled = false;
+}
+
+void RenderGraph::planLifetimes()
+{
+	for (Resource &resource : mResources) {
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = 0;
+		resource.imageUsage = 0;
+	}
+
+	for (uint32_t i = 0; i < mPasses.size(); ++i) {
+		Pass &pass = mPasses[i];
+		pass.extent = {};
+
+		for (Access const &access : pass.accesses) {
+			Resource &resource = mResources[access.resource];
+
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = i;
+			resource.lastUsage = access.usage;
+			resource.imageUsage |= getResourceUsageInfo(access.usage).imageUsage;
+
+			if (!access.isAttachment) {
+				continue;
+			}
+
+			if (pass.extent.width == 0) {
+				pass.extent = resource.desc.extent;
+			} else if (pass.extent.width != resource.desc.extent.width || pass.extent.height != resource.desc.extent.height) {
+				throw std::runtime_error("Attachments of render graph pass " + pass.name + " differ in size!");
+			}
+		}
+
+		if (pass.type == PassType::Graphics && pass.extent.width == 0) {
+			throw std::runtime_error("Render graph pass " + pass.name + " has no attachments!");
+		}
+	}
+}
+
+/**
+ * Greedy: transient images in order of first use, each joins the first group whose images are all
+ *  done by the time it starts. Only images of the same format share, those are the ones that end up
+ *  with compatible memory requirements in practice.
+ */
+void RenderGraph::planAliasing()
+{
+	mAliasGroups.clear();
+
+	std::vector<uint32_t> transients;
+
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		mResources[i].aliasGroup = UINT32_MAX;
+
+		// Never used means never created
+		if (!mResources[i].isImported && mResources[i].firstPass != UINT32_MAX) {
+			transients.push_back(i);
+		}
+	}
+
+	std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+		return mResources[a].firstPass < mResources[b].firstPass;
+	});
+
+	for (uint32_t index : transients) {
+		Resource &resource = mResources[index];
+
+		for (uint32_t group = 0; group < mAliasGroups.size(); ++group) {
+			Resource const &previous = mResources[mAliasGroups[group].resources.back()];
+
+			if (previous.lastPass < resource.firstPass && previous.desc.format == resource.desc.format) {
+				resource.aliasGroup = group;
+				break;
+			}
+		}
+
+		if (resource.aliasGroup == UINT32_MAX) {
+			resource.aliasGroup = static_cast<uint32_t>(mAliasGroups.size());
+			mAliasGroups.emplace_back();
+		}
+
+		mAliasGroups[resource.aliasGroup].resources.push_back(index);
+	}
+}
+
+void RenderGraph::planBarriers()
+{
+	std::vector<ResourceState> states(mResources.size());
+
+	auto startAfter = [](ResourceState &state, ResourceUsage usage) {
+		if (getResourceUsageInfo(usage).isWrite) {
+			state.writeUsages = toUsageSet(usage);
+		} else {
+			state.readUsages = toUsageSet(usage);
+		}
+	};
+
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		Resource const &resource = mResources[i];
+		ResourceState &state = states[i];
+
+		if (resource.isImported) {
+			startAfter(state, resource.initialUsage);
+			state.layout = resource.preserveContents ? getResourceUsageInfo(resource.initialUsage).layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			state.hasContents = resource.preserveContents;
+		} else if (resource.aliasGroup != UINT32_MAX) {
+			// The memory was last used by the image before this one in the group. The first one
+			//  follows the last, from the previous execute, which may still be in flight.
+			std::vector<uint32_t> const &group = mAliasGroups[resource.aliasGroup].resources;
+			auto position = std::find(group.begin(), group.end(), i);
+			uint32_t previous = position == group.begin() ? group.back() : *(position - 1);
+
+			startAfter(state, mResources[previous].lastUsage);
+		}
+	}
+
+	mFinalBarriers.clear();
+
+	for (uint32_t i = 0; i < mPasses.size(); ++i) {
+		Pass &pass = mPasses[i];
+		pass.barriers.clear();
+		pass.attachments.clear();
+
+		for (Access const &access : pass.accesses) {
+			Resource const &resource = mResources[access.resource];
+			ResourceState &state = states[access.resource];
+			ResourceUsageInfo info = getResourceUsageInfo(access.usage);
+
+			if (access.isAttachment) {
+				Attachment attachment{};
+				attachment.resource = access.resource;
+				attachment.layout = info.layout;
+				attachment.clear = access.clear.value_or(VkClearValue{});
+
+				if (access.clear) {
+					attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				} else {
+					attachment.loadOp = state.hasContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				}
+
+				// Nobody looks at a transient after its last pass
+				bool isNeededLater = resource.isImported || resource.lastPass > i;
+				attachment.storeOp = isNeededLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				pass.attachments.push_back(attachment);
+			}
+
+			Barrier barrier;
+			if (transition(access.resource, state, access.usage, barrier)) {
+				pass.barriers.push_back(barrier);
+			}
+
+			state.hasContents = state.hasContents || info.isWrite;
+		}
+	}
+
+	for (uint32_t i = 0; i < mResources.size(); ++i) {
+		Barrier barrier;
+
+		if (mResources[i].isImported && transition(i, states[i], mResources[i].finalUsage, barrier)) {
+			mFinalBarriers.push_back(barrier);
+		}
+	}
+}
+
+/**
+ * Moves state on to the next use and fills in the barrier that has to come before it, if any.
+ *  Writes and layout transitions wait for everything since the last write, reads only for the
+ *  last write, and a read of a usage that already waited for the same write needs nothing.
+ */
+bool RenderGraph::transition(uint32_t resource, ResourceState &state, ResourceUsage usage, Barrier &barrier) const
+{
+	ResourceUsageInfo info = getResourceUsageInfo(usage);
+	bool isImage = mResources[resource].isImage;
+	bool changesLayout = isImage && state.layout != info.layout;
+
+	barrier.resource = resource;
+	barrier.oldLayout = state.layout;
+	barrier.newLayout = isImage ? info.layout : state.layout;
+	barrier.dstUsage = usage;
+
+	if (changesLayout || info.isWrite) {
+		barrier.srcUsages = state.writeUsages | state.readUsages;
+
+		bool isNeeded = changesLayout || barrier.srcUsages != 0;
+
+		// A layout transition writes the image too, later reads have to come after it
+		state.layout = barrier.newLayout;
+		state.writeUsages = toUsageSet(usage);
+		state.readUsages = info.isWrite ? 0 : toUsageSet(usage);
+
+		return isNeeded;
+	}
+
+	// Per usage rather than per stage: synchronization2 tells sampled and storage reads apart, so a
+	//  barrier for one doesn't make the write visible to the other
+	bool isCovered = (state.readUsages & toUsageSet(usage)) != 0;
+
+	state.readUsages |= toUsageSet(usage);
+
+	if (isCovered || state.writeUsages == 0) {
+		return false;
+	}
+
+	barrier.srcUsages = state.writeUsages;
+
+	return true;
+}
+
+void RenderGraph::createTransientImages()
+{
+	for (AliasGroup const &group : mAliasGroups) {
+		std::vector<uint32_t> sharing;
+		VkMemoryRequirements shared{};
+		shared.memoryTypeBits = ~0u;
+
+		for (uint32_t index : group.resources) {
+			Resource &resource = mResources[index];
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resource.desc.format;
+			imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = resource.imageUsage;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(mLogicalDevice, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create render graph image " + resource.name + "!");
+			}
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(mLogicalDevice, resource.image, &requirements);
+
+			// One the others can't share memory with gets its own, which only costs some memory
+			if ((shared.memoryTypeBits & requirements.memoryTypeBits) == 0) {
+				VkMemoryAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				allocInfo.allocationSize = requirements.size;
+				allocInfo.memoryTypeIndex = VulkanBaseObject::findMemoryType(
+					mPhysicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+				VkDeviceMemory memory;
+				if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to allocate render graph image memory!");
+				}
+
+				mTransientMemory.push_back(memory);
+				vkBindImageMemory(mLogicalDevice, resource.image, memory, 0);
+				continue;
+			}
+
+			shared.size = std::max(shared.size, requirements.size);
+			shared.alignment = std::max(shared.alignment, requirements.alignment);
+			shared.memoryTypeBits &= requirements.memoryTypeBits;
+			sharing.push_back(index);
+		}
+
+		if (!sharing.empty()) {
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = shared.size;
+			allocInfo.memoryTypeIndex = VulkanBaseObject::findMemoryType(
+				mPhysicalDevice, shared.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			VkDeviceMemory memory;
+			if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate render graph image memory!");
+			}
+
+			mTransientMemory.push_back(memory);
+
+			// All at offset 0, the barriers keep their uses apart
+			for (uint32_t index : sharing) {
+				vkBindImageMemory(mLogicalDevice, mResources[index].image, memory, 0);
+			}
+		}
+
+		for (uint32_t index : group.resources) {
+			Resource &resource = mResources[index];
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.desc.format;
+			viewInfo.subresourceRange.aspectMask = resource.desc.aspect;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(mLogicalDevice, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create render graph image view " + resource.name + "!");
+			}
+		}
+	}
+}
+
+void RenderGraph::destroyTransientImages()
+{
+	for (Resource &resource : mResources) {
+		if (!resource.isImported) {
+			vkDestroyImageView(mLogicalDevice, resource.view, nullptr);
+			vkDestroyImage(mLogicalDevice, resource.image, nullptr);
+			resource.view = VK_NULL_HANDLE;
+			resource.image = VK_NULL_HANDLE;
+		}
+	}
+
+	for (VkDeviceMemory memory : mTransientMemory) {
+		vkFreeMemory(mLogicalDevice, memory, nullptr);
+	}
+
+	mTransientMemory.clear();
+}
+
+void RenderGraph::destroyFramebuffers()
+{
+	for (Pass &pass : mPasses) {
+		for (auto &framebuffer : pass.framebuffers) {
+			vkDestroyFramebuffer(mLogicalDevice, framebuffer.second, nullptr);
+		}
+
+		pass.framebuffers.clear();
+	}
+}
+
+/**
+ * Attachments start and end in the layout the pass uses them in, the barriers before and after do
+ *  all transitions, so the render pass needs no subpass dependencies of its own either.
+ */
+void RenderGraph::createRenderPass(Pass &pass)
+{
+	std::vector<VkAttachmentDescription> descriptions;
+	std::vector<VkAttachmentReference> colorReferences;
+	std::optional<VkAttachmentReference> depthReference;
+
+	for (uint32_t i = 0; i < pass.attachments.size(); ++i) {
+		Attachment const &attachment = pass.attachments[i];
+		Resource const &resource = mResources[attachment.resource];
+
+		bool hasStencil = (resource.desc.aspect & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+		VkAttachmentDescription description{};
+		description.format = resource.desc.format;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		description.loadOp = attachment.loadOp;
+		description.storeOp = attachment.storeOp;
+		description.stencilLoadOp = hasStencil ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = hasStencil ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.initialLayout = attachment.layout;
+		description.finalLayout = attachment.layout;
+		descriptions.push_back(description);
+
+		VkAttachmentReference reference{ i, attachment.layout };
+
+		if (attachment.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+			colorReferences.push_back(reference);
+		} else {
+			depthReference = reference;
+		}
+	}
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+	subpass.pColorAttachments = colorReferences.data();
+	subpass.pDepthStencilAttachment = depthReference ? &*depthReference : nullptr;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+	renderPassInfo.pAttachments = descriptions.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	if (vkCreateRenderPass(mLogicalDevice, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create render pass for render graph pass " + pass.name + "!");
+	}
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(Pass &pass)
+{
+	std::vector<VkImageView> views;
+
+	for (Attachment const &attachment : pass.attachments) {
+		Resource const &resource = mResources[attachment.resource];
+
+		if (resource.view == VK_NULL_HANDLE) {
+			throw std::runtime_error("Render graph image " + resource.name + " has no view, import one with setImportedImage!");
+		}
+
+		views.push_back(resource.view);
+	}
+
+	auto found = pass.framebuffers.find(views);
+	if (found != pass.framebuffers.end()) {
+		return found->second;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = pass.renderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = pass.extent.width;
+	framebufferInfo.height = pass.extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer framebuffer;
+	if (vkCreateFramebuffer(mLogicalDevice, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create framebuffer for render graph pass " + pass.name + "!");
+	}
+
+	pass.framebuffers.emplace(std::move(views), framebuffer);
+
+	return framebuffer;
+}
+
+void RenderGraph::executeRenderPass(VkCommandBuffer commandBuffer, Pass &pass)
+{
+	PassContext context;
+	context.renderPass = pass.renderPass;
+	context.framebuffer = getFramebuffer(pass);
+	context.extent = pass.extent;
+
+	// Which render pass, subpass and framebuffer secondaries run in
+	context.inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	context.inheritance.renderPass = context.renderPass;
+	context.inheritance.subpass = 0;
+	context.inheritance.framebuffer = context.framebuffer;
+
+	std::vector<VkClearValue> clearValues;
+	for (Attachment const &attachment : pass.attachments) {
+		clearValues.push_back(attachment.clear);
+	}
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = context.renderPass;
+	renderPassInfo.framebuffer = context.framebuffer;
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = pass.extent;
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, pass.contents);
+	pass.execute(commandBuffer, context);
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+/**
+ * The attachments go straight into vkCmdBeginRendering with the load and store ops compile() picked,
+ *  so the views can change every frame without a framebuffer to create for them. Secondaries inherit
+ *  the attachment formats instead of a render pass.
+ */
+void RenderGraph::executeDynamicRendering(VkCommandBuffer commandBuffer, Pass &pass)
+{
+#ifdef VK_KHR_dynamic_rendering
+	std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+	std::vector<VkFormat> colorFormats;
+	std::optional<VkRenderingAttachmentInfoKHR> depthAttachment;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	bool hasStencil = false;
+
+	for (Attachment const &attachment : pass.attachments) {
+		Resource const &resource = mResources[attachment.resource];
+
+		if (resource.view == VK_NULL_HANDLE) {
+			throw std::runtime_error("Render graph image " + resource.name + " has no view, import one with setImportedImage!");
+		}
+
+		VkRenderingAttachmentInfoKHR attachmentInfo{};
+		attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		attachmentInfo.imageView = resource.view;
+		attachmentInfo.imageLayout = attachment.layout;
+		attachmentInfo.loadOp = attachment.loadOp;
+		attachmentInfo.storeOp = attachment.storeOp;
+		attachmentInfo.clearValue = attachment.clear;
+
+		if (attachment.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+			colorAttachments.push_back(attachmentInfo);
+			colorFormats.push_back(resource.desc.format);
+		} else {
+			depthAttachment = attachmentInfo;
+			depthFormat = resource.desc.format;
+			hasStencil = (resource.desc.aspect & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+		}
+	}
+
+	VkRenderingInfoKHR renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+	renderingInfo.flags = pass.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ?
+		VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = pass.extent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+	renderingInfo.pColorAttachments = colorAttachments.data();
+	renderingInfo.pDepthAttachment = depthAttachment ? &*depthAttachment : nullptr;
+	// A combined depth stencil image is both, with the same ops like the render pass path uses
+	renderingInfo.pStencilAttachment = hasStencil ? &*depthAttachment : nullptr;
+
+	VkCommandBufferInheritanceRenderingInfoKHR inheritanceRendering{};
+	inheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+	inheritanceRendering.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+	inheritanceRendering.pColorAttachmentFormats = colorFormats.data();
+	inheritanceRendering.depthAttachmentFormat = depthFormat;
+	inheritanceRendering.stencilAttachmentFormat = hasStencil ? depthFormat : VK_FORMAT_UNDEFINED;
+	inheritanceRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	PassContext context;
+	context.extent = pass.extent;
+	context.inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	context.inheritance.pNext = &inheritanceRendering;
+
+	mpfnCmdBeginRendering(commandBuffer, &renderingInfo);
+	pass.execute(commandBuffer, context);
+	mpfnCmdEndRendering(commandBuffer);
+#else
+	(void) commandBuffer;
+	(void) pass;
+#endif
+}
+
+/**
+ * One barrier command for everything before a pass. Buffers don't need a barrier each, a global
+ *  memory barrier covers them all at once.
+ */
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, std::vector<Barrier> const &barriers)
+{
+	for (Barrier const &barrier : barriers) {
+		Resource const &resource = mResources[barrier.resource];
+
+		if (!resource.isImage) {
+			mBarrierBatcher.addMemory(barrier.srcUsages, barrier.dstUsage);
+			continue;
+		}
+
+		if (resource.image == VK_NULL_HANDLE) {
+			throw std::runtime_error("Render graph image " + resource.name + " has no image, import one with setImportedImage!");
+		}
+
+		VkImageSubresourceRange range{};
+		range.aspectMask = resource.desc.aspect;
+		range.baseMipLevel = 0;
+		range.levelCount = VK_REMAINING_MIP_LEVELS;
+		range.baseArrayLayer = 0;
+		range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+		mBarrierBatcher.addImage(resource.image, range, barrier.srcUsages, barrier.oldLayout, barrier.dstUsage);
+	}
+
+	mBarrierBatcher.flush(commandBuffer);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "ShaderLibrary.h"
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	struct EmbeddedShader
+	{
+		char const *name;
+		uint32_t const *pCode;
+		size_t wordCount;
+	};
+}
+
+// Generated by embedShaders in utils.cmake: includes the shader headers and defines kEmbeddedShaders
+#ifdef VULKAN_RENDERER_EMBEDDED_SHADERS
+#include "EmbeddedShaderTable.inc"
+#endif
+
+std::vector<uint32_t> ShaderLibrary::load(std::string const &name, std::string const &directory)
+{
+#ifdef VULKAN_RENDERER_EMBEDDED_SHADERS
+	(void) directory;	// Only read from without embedded shaders
+
+	for (EmbeddedShader const &shader : kEmbeddedShaders) {
+		if (name == shader.name) {
+			return std::vector<uint32_t>(shader.pCode, shader.pCode + shader.wordCount);
+		}
+	}
+
+	throw std::runtime_error("No embedded shader " + name + "!");
+#else
+	std::ifstream file(directory + name, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open shader " + directory + name + "!");
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+
+	if (fileSize % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Shader " + name + " isn't SPIR-V!");
+	}
+
+	// Read straight into words, so the code is aligned for vkCreateShaderModule
+	std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(code.data()), fileSize);
+
+	if (!file) {
+		throw std::runtime_error("Failed to read shader " + name + "!");
+	}
+
+	return code;
+#endif
+}
+
+bool ShaderLibrary::isEmbedded()
+{
+#ifdef VULKAN_RENDERER_EMBEDDED_SHADERS
+	return true;
+#else
+	return false;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const uint32_t kSpirvMagic = 0x07230203;
+	const uint32_t kHeaderWords = 5;
+	const uint32_t kNone = UINT32_MAX;
+
+	// The opcodes, decorations and enumerants that matter for layouts, numbers as in the SPIR-V spec
+	enum Op : uint32_t
+	{
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum Decoration : uint32_t
+	{
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum StorageClass : uint32_t
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	enum ExecutionModel : uint32_t
+	{
+		ExecutionModelVertex = 0,
+		ExecutionModelTessellationControl = 1,
+		ExecutionModelTessellationEvaluation = 2,
+		ExecutionModelGeometry = 3,
+		ExecutionModelFragment = 4,
+		ExecutionModelGLCompute = 5
+	};
+
+	const uint32_t kDimBuffer = 5;
+	const uint32_t kDimSubpassData = 6;
+	const uint32_t kImageIsStorage = 2;	// Sampled operand of OpTypeImage
+
+	// Everything the instructions say about one result id
+	struct SpirvId
+	{
+		uint32_t opcode = 0;
+		uint32_t typeId = kNone;	// Element, component, column or pointee type, or the type of a variable/constant
+		uint32_t storageClass = kNone;
+		uint32_t count = 0;			// Components, columns, array length id or the value of a constant
+		uint32_t width = 0;			// Scalars
+		bool isSigned = false;
+		uint32_t dim = 0;			// Images
+		uint32_t sampled = 0;
+		std::vector<uint32_t> members;
+
+		uint32_t set = 0;
+		uint32_t binding = kNone;
+		uint32_t location = kNone;
+		bool isBuiltIn = false;
+		bool isBlock = false;
+		bool isBufferBlock = false;
+		uint32_t arrayStride = 0;
+		std::vector<uint32_t> memberOffsets;
+		std::vector<uint32_t> memberMatrixStrides;
+	};
+
+	VkShaderStageFlagBits getStage(uint32_t executionModel)
+	{
+		switch (executionModel) {
+		case ExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+		case ExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case ExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case ExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case ExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case ExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: throw std::runtime_error("Unsupported shader stage in SPIR-V!");
+		}
+	}
+
+	class SpirvModule
+	{
+	public:
+		explicit SpirvModule(std::vector<uint32_t> const &words)
+		{
+			if (words.size() < kHeaderWords || words[0] != kSpirvMagic) {
+				throw std::runtime_error("Failed to reflect shader, not SPIR-V!");
+			}
+
+			mIds.resize(words[3]);	// Bound, every id is below it
+
+			for (size_t offset = kHeaderWords; offset < words.size();) {
+				uint32_t wordCount = words[offset] >> 16;
+				uint32_t opcode = words[offset] & 0xffff;
+
+				if (wordCount == 0 || offset + wordCount > words.size()) {
+					throw std::runtime_error("Failed to reflect shader, truncated instruction!");
+				}
+
+				parse(opcode, &words[offset + 1], wordCount - 1);
+				offset += wordCount;
+			}
+		}
+
+		SpirvId const &operator[](uint32_t id) const { return mIds.at(id); }
+		size_t size() const { return mIds.size(); }
+
+		VkShaderStageFlagBits getStage() const { return mStage; }
+
+		// Follows arrays down to what they hold, multiplying their lengths into count
+		uint32_t getElementType(uint32_t typeId, uint32_t &count) const
+		{
+			count = 1;
+
+			while (mIds.at(typeId).opcode == OpTypeArray || mIds.at(typeId).opcode == OpTypeRuntimeArray) {
+				SpirvId const &array = mIds.at(typeId);
+				count = array.opcode == OpTypeRuntimeArray ? 0 : count * getArrayLength(array);
+				typeId = array.typeId;
+			}
+
+			return typeId;
+		}
+
+		// Bytes taken by a type laid out with its Offset, ArrayStride and MatrixStride decorations
+		uint32_t getSize(uint32_t typeId, uint32_t matrixStride = 0) const
+		{
+			SpirvId const &type = mIds.at(typeId);
+
+			switch (type.opcode) {
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.width / 8;
+			case OpTypeVector:
+				return type.count * getSize(type.typeId);
+			case OpTypeMatrix:
+				return type.count * (matrixStride != 0 ? matrixStride : getSize(type.typeId));
+			case OpTypeArray:
+				return getArrayLength(type) * (type.arrayStride != 0 ? type.arrayStride : getSize(type.typeId));
+			case OpTypeStruct: {
+				uint32_t size = 0;
+				for (size_t i = 0; i < type.members.size(); ++i) {
+					uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+					uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+					size = std::max(size, offset + getSize(type.members[i], stride));
+				}
+				return size;
+			}
+			default:
+				throw std::runtime_error("Failed to reflect shader, can't size a type in a push constant block!");
+			}
+		}
+
+	private:
+		/**
+		 * A length from a specialization constant is taken at its default; reflection runs before any
+		 *  pipeline picks other values. Anything computed with OpSpecConstantOp is refused.
+		 */
+		uint32_t getArrayLength(SpirvId const &array) const
+		{
+			SpirvId const &length = mIds.at(array.count);
+			if (length.opcode != OpConstant && length.opcode != OpSpecConstant) {
+				throw std::runtime_error("Failed to reflect shader, array length isn't a constant!");
+			}
+			return length.count;
+		}
+
+		void parse(uint32_t opcode, uint32_t const *pOperands, uint32_t operandCount)
+		{
+			auto operand = [&](uint32_t i) {
+				if (i >= operandCount) {
+					throw std::runtime_error("Failed to reflect shader, missing operand!");
+				}
+				return pOperands[i];
+			};
+
+			switch (opcode) {
+			case OpEntryPoint:
+				mStage = ::getStage(operand(0));
+				break;
+			case OpTypeInt:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).width = operand(1);
+				id(operand(0)).isSigned = operand(2) != 0;
+				break;
+			case OpTypeFloat:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).width = operand(1);
+				break;
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).typeId = operand(1);
+				id(operand(0)).count = operand(2);
+				break;
+			case OpTypeRuntimeArray:
+			case OpTypeSampledImage:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).typeId = operand(1);
+				break;
+			case OpTypeImage:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).dim = operand(2);
+				id(operand(0)).sampled = operand(6);
+				break;
+			case OpTypeSampler:
+				id(operand(0)).opcode = opcode;
+				break;
+			case OpTypeStruct:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).members.assign(pOperands + 1, pOperands + operandCount);
+				break;
+			case OpTypePointer:
+				id(operand(0)).opcode = opcode;
+				id(operand(0)).storageClass = operand(1);
+				id(operand(0)).typeId = operand(2);
+				break;
+			case OpConstant:
+			case OpSpecConstant:	// The default value, same layout as OpConstant
+				id(operand(1)).opcode = opcode;
+				id(operand(1)).typeId = operand(0);
+				id(operand(1)).count = operand(2);	// Low word is enough for an array length
+				break;
+			case OpVariable:
+				id(operand(1)).opcode = opcode;
+				id(operand(1)).typeId = operand(0);
+				id(operand(1)).storageClass = operand(2);
+				break;
+			case OpDecorate:
+				decorate(id(operand(0)), operand(1), operandCount > 2 ? operand(2) : 0);
+				break;
+			case OpMemberDecorate:
+				decorateMember(id(operand(0)), operand(1), operand(2), operandCount > 3 ? operand(3) : 0);
+				break;
+			default:
+				break;
+			}
+		}
+
+		void decorate(SpirvId &target, uint32_t decoration, uint32_t value)
+		{
+			switch (decoration) {
+			case DecorationBlock: target.isBlock = true; break;
+			case DecorationBufferBlock: target.isBufferBlock = true; break;
+			case DecorationArrayStride: target.arrayStride = value; break;
+			case DecorationBuiltIn: target.isBuiltIn = true; break;
+			case DecorationLocation: target.location = value; break;
+			case DecorationBinding: target.binding = value; break;
+			case DecorationDescriptorSet: target.set = value; break;
+			default: break;
+			}
+		}
+
+		void decorateMember(SpirvId &target, uint32_t member, uint32_t decoration, uint32_t value)
+		{
+			if (decoration == DecorationOffset) {
+				target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1), 0);
+				target.memberOffsets[member] = value;
+			} else if (decoration == DecorationMatrixStride) {
+				target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1), 0);
+				target.memberMatrixStrides[member] = value;
+			} else if (decoration == DecorationBuiltIn) {
+				target.isBuiltIn = true;	// gl_PerVertex, never a vertex input
+			}
+		}
+
+		SpirvId &id(uint32_t id)
+		{
+			if (id >= mIds.size()) {
+				throw std::runtime_error("Failed to reflect shader, id out of bounds!");
+			}
+			return mIds[id];
+		}
+
+		std::vector<SpirvId> mIds;
+		VkShaderStageFlagBits mStage = VK_SHADER_STAGE_VERTEX_BIT;
+	};
+
+	VkDescriptorType getDescriptorType(SpirvModule const &module, SpirvId const &variable, uint32_t typeId)
+	{
+		SpirvId const &type = module[typeId];
+
+		switch (variable.storageClass) {
+		case StorageClassUniform:
+			return type.isBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		case StorageClassStorageBuffer:
+			return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		default:
+			break;
+		}
+
+		if (type.opcode == OpTypeSampler) {
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		}
+
+		if (type.opcode == OpTypeSampledImage) {
+			return module[type.typeId].dim == kDimBuffer
+				? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+				: VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		}
+
+		if (type.opcode == OpTypeImage) {
+			if (type.dim == kDimSubpassData) {
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+
+			if (type.dim == kDimBuffer) {
+				return type.sampled == kImageIsStorage
+					? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+					: VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+
+			return type.sampled == kImageIsStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+
+		throw std::runtime_error("Failed to reflect shader, unsupported descriptor type!");
+	}
+
+	VkFormat getVertexFormat(SpirvId const &scalar, uint32_t components)
+	{
+		static const VkFormat kFloatFormats[] = {
+			VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat kIntFormats[] = {
+			VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat kUintFormats[] = {
+			VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (scalar.width != 32 || components == 0 || components > 4) {
+			throw std::runtime_error("Failed to reflect shader, unsupported vertex input type!");
+		}
+
+		if (scalar.opcode == OpTypeFloat) {
+			return kFloatFormats[components - 1];
+		}
+
+		return scalar.isSigned ? kIntFormats[components - 1] : kUintFormats[components - 1];
+	}
+}
+
+ShaderReflection ShaderReflection::reflect(std::vector<uint32_t> const &code)
+{
+	SpirvModule module(code);
+
+	ShaderReflection reflection;
+	reflection.mStages = module.getStage();
+
+	for (uint32_t id = 0; id < module.size(); ++id) {
+		SpirvId const &variable = module[id];
+
+		if (variable.opcode != OpVariable || module[variable.typeId].opcode != OpTypePointer) {
+			continue;
+		}
+
+		uint32_t pointeeId = module[variable.typeId].typeId;
+
+		switch (variable.storageClass) {
+		case StorageClassUniformConstant:
+		case StorageClassUniform:
+		case StorageClassStorageBuffer: {
+			if (variable.binding == kNone) {
+				throw std::runtime_error("Failed to reflect shader, a descriptor has no binding!");
+			}
+
+			Binding binding;
+			binding.set = variable.set;
+			binding.binding = variable.binding;
+
+			uint32_t elementId = module.getElementType(pointeeId, binding.count);
+			binding.type = getDescriptorType(module, variable, elementId);
+			binding.stages = reflection.mStages;
+
+			reflection.addBinding(binding);
+			break;
+		}
+		case StorageClassPushConstant: {
+			VkPushConstantRange range{};
+			range.stageFlags = reflection.mStages;
+			range.offset = 0;
+			range.size = module.getSize(pointeeId);
+
+			reflection.addPushConstantRange(range);
+			break;
+		}
+		case StorageClassInput: {
+			if (reflection.mStages != VK_SHADER_STAGE_VERTEX_BIT || variable.isBuiltIn || variable.location == kNone) {
+				break;
+			}
+
+			uint32_t count;
+			uint32_t typeId = module.getElementType(pointeeId, count);
+			SpirvId const &type = module[typeId];
+
+			// A matrix is one location per column, and so is every element of an array
+			uint32_t columns = type.opcode == OpTypeMatrix ? type.count : 1;
+			SpirvId const &column = type.opcode == OpTypeMatrix ? module[type.typeId] : type;
+			SpirvId const &scalar = column.opcode == OpTypeVector ? module[column.typeId] : column;
+			uint32_t components = column.opcode == OpTypeVector ? column.count : 1;
+
+			for (uint32_t i = 0; i < count * columns; ++i) {
+				reflection.mVertexInputs.push_back({ variable.location + i, getVertexFormat(scalar, components) });
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	std::sort(reflection.mVertexInputs.begin(), reflection.mVertexInputs.end(),
+		[](VertexInput const &a, VertexInput const &b) { return a.location < b.location; });
+
+	return reflection;
+}
+
+void ShaderReflection::merge(ShaderReflection const &other)
+{
+	mStages |= other.mStages;
+
+	for (Binding const &binding : other.mBindings) {
+		addBinding(binding);
+	}
+
+	for (VkPushConstantRange const &range : other.mPushConstantRanges) {
+		addPushConstantRange(range);
+	}
+
+	if (other.mStages & VK_SHADER_STAGE_VERTEX_BIT) {
+		mVertexInputs = other.mVertexInputs;
+	}
+}
+
+void ShaderReflection::checkVertexInputs(std::vector<VkVertexInputAttributeDescription> const &attributes) const
+{
+	for (VertexInput const &input : mVertexInputs) {
+		auto attribute = std::find_if(attributes.begin(), attributes.end(),
+			[&](VkVertexInputAttributeDescription const &attribute) { return attribute.location == input.location; });
+
+		if (attribute == attributes.end()) {
+			throw std::runtime_error("Vertex input at location " + std::to_string(input.location) + " isn't fed by any attribute!");
+		}
+
+		if (attribute->format != input.format) {
+			throw std::runtime_error("Vertex input at location " + std::to_string(input.location) + " has a different format than its attribute!");
+		}
+	}
+}
+
+bool ShaderReflection::hasBinding(uint32_t set, uint32_t binding) const
+{
+	return std::any_of(mBindings.begin(), mBindings.end(),
+		[&](Binding const &existing) { return existing.set == set && existing.binding == binding; });
+}
+
+void ShaderReflection::addBinding(Binding const &binding)
+{
+	for (Binding &existing : mBindings) {
+		if (existing.set != binding.set || existing.binding != binding.binding) {
+			continue;
+		}
+
+		if (existing.type != binding.type || existing.count != binding.count) {
+			throw std::runtime_error("Shader stages disagree on set " + std::to_string(binding.set) +
+				" binding " + std::to_string(binding.binding) + "!");
+		}
+
+		existing.stages |= binding.stages;
+		return;
+	}
+
+	mBindings.push_back(binding);
+
+	std::sort(mBindings.begin(), mBindings.end(), [](Binding const &a, Binding const &b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+}
+
+/**
+ * One range for everything: stages declaring different blocks still get a single range over all of
+ *  them, so whoever pushes only needs the one stage mask.
+ */
+void ShaderReflection::addPushConstantRange(VkPushConstantRange const &range)
+{
+	if (mPushConstantRanges.empty()) {
+		mPushConstantRanges.push_back(range);
+		return;
+	}
+
+	VkPushConstantRange &merged = mPushConstantRanges.front();
+	uint32_t end = std::max(merged.offset + merged.size, range.offset + range.size);
+
+	merged.offset = std::min(merged.offset, range.offset);
+	merged.size = end - merged.offset;
+	merged.stageFlags |= range.stageFlags;
+}
\ No newline at end of file
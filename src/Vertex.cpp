@@ -4,7 +4,7 @@
  * A vertex binding specifies the number of bytes between data entries and whether to :
  *  (1) move to the next data entry after each vertex OR
  *  (2) after each instance
- * Since we are not doing instanced rendering, we are going to use (1)
+ * Vertex uses (1), InstanceData below uses (2)
  *
  * This piece of information is used to describe to the GPU how to read
  *  the data per vertex, as opposed to VkVertexInputAttributeDescription
@@ -15,8 +15,7 @@ VkVertexInputBindingDescription Vertex::getBindingDescription()
 	VkVertexInputBindingDescription bindingDescription{};
 	bindingDescription.binding = 0;
 	bindingDescription.stride = sizeof(Vertex);
-	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;	// We are not using instanced rendering so this is
-																//  going to per-vertex data
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;	// Per-vertex data
 
 	return bindingDescription;
 }
@@ -48,5 +47,29 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescription
 	attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
 	attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
 
+	return attributeDescriptions;
+}
+
+VkVertexInputBindingDescription InstanceData::getBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 1;
+	bindingDescription.stride = sizeof(InstanceData);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;	// Advances once per instance
+
+	return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 4> InstanceData::getAttributeDescriptions()
+{
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+	for (uint32_t column = 0; column < attributeDescriptions.size(); ++column) {
+		attributeDescriptions[column].binding = 1;
+		attributeDescriptions[column].location = 3 + column;
+		attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[column].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * column;
+	}
+
 	return attributeDescriptions;
 }
\ No newline at end of file
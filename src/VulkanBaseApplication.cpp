@@ -1,5 +1,6 @@
 #include "VulkanBaseApplication.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
@@ -58,6 +59,23 @@ bool VulkanBaseApplication::checkValidationLayerSupport()
 	return true;
 }
 
+/**
+ * The version to put in VkApplicationInfo::apiVersion. A 1.0 loader rejects any apiVersion above
+ *  1.0, so cap VULKAN_BASE_VK_API_VERSION by what the loader supports. vkEnumerateInstanceVersion
+ *  itself only exists from 1.1 on, which is why it has to be looked up.
+ */
+uint32_t VulkanBaseApplication::queryInstanceApiVersion()
+{
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+
+	PFN_vkEnumerateInstanceVersion pFunc = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+	if (pFunc) {
+		pFunc(&loaderVersion);
+	}
+
+	return std::min<uint32_t>(loaderVersion, VULKAN_BASE_VK_API_VERSION);
+}
+
 void VulkanBaseApplication::createVulkanInstance(
 	const VkApplicationInfo *pAppInfo, std::vector<const char *> const &extensions)
 {
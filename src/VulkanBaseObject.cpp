@@ -2,13 +2,14 @@
 
 #include <stdexcept>
 
-void VulkanBaseObject::allocateMemory(VkMemoryRequirements memRequirements, VkMemoryPropertyFlags properties)
+void VulkanBaseObject::allocateMemory(
+	VkMemoryRequirements memRequirements, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties )
 {
 	VkMemoryAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	allocInfo.allocationSize = memRequirements.size;
 	allocInfo.memoryTypeIndex = findMemoryType(
-		mPhysicalDevice, memRequirements.memoryTypeBits, properties);
+		mPhysicalDevice, memRequirements.memoryTypeBits, properties, preferredProperties);
 
 	if (vkAllocateMemory(mLogicalDevice, &allocInfo, nullptr, &mMemoryHandle) != VK_SUCCESS) {
 		throw std::runtime_error("[ERROR] Failed to allocate memory for VulkanBaseObject!");
@@ -0,0 +1,122 @@
+#include "VulkanBindlessTextures.h"
+
+#include <stdexcept>
+
+void VulkanBindlessTextures::lazyInit(VkDevice logicalDevice, uint32_t capacity)
+{
+	mLogicalDevice = logicalDevice;
+	mCapacity = capacity;
+	mNextIndex = 0;
+	mFreeIndices.clear();
+
+	createDescriptorSetLayout();
+	createDescriptorSet();
+}
+
+uint32_t VulkanBindlessTextures::addTexture(VkImageView imageView, VkSampler sampler)
+{
+	uint32_t index = 0;
+
+	if (!mFreeIndices.empty())
+	{
+		index = mFreeIndices.back();
+		mFreeIndices.pop_back();
+	}
+	else if (mNextIndex < mCapacity)
+	{
+		index = mNextIndex++;
+	}
+	else
+	{
+		throw std::runtime_error("Bindless texture table is full!");
+	}
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = mDescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(mLogicalDevice, 1, &descriptorWrite, 0, nullptr);
+
+	return index;
+}
+
+void VulkanBindlessTextures::removeTexture(uint32_t index)
+{
+	// Partially bound, so the stale descriptor can just stay there until the slot is reused
+	mFreeIndices.push_back(index);
+}
+
+void VulkanBindlessTextures::createDescriptorSetLayout()
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = mCapacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	binding.pImmutableSamplers = nullptr;
+
+	// Partially bound: slots that were never written are fine as long as no shader reads them.
+	// Update after bind + unused while pending: slots can be written while the set is bound in
+	//  command buffers that are recorded or in flight, instead of only between frames.
+	VkDescriptorBindingFlags bindingFlags =	VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+											VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+											VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(mLogicalDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create bindless texture descriptor set layout!");
+	}
+}
+
+void VulkanBindlessTextures::createDescriptorSet()
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = mCapacity;
+
+	// Sets from an update-after-bind layout can only come from a pool created with the same flag
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(mLogicalDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create bindless texture descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = mDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &mDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(mLogicalDevice, &allocInfo, &mDescriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate bindless texture descriptor set!");
+	}
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "VulkanBuffer.h"
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
@@ -8,14 +9,28 @@
  *  type of memory to use to allocate our buffer.
  *
  * @param: typeFilter - specify the bit field of memory types that are suitable
+ * @param: preferredProperties - nice to have on top of properties, e.g. host cached for memory the
+ *  CPU reads back. Ignored when no suitable memory type has them.
  */
 uint32_t VulkanBaseObject::findMemoryType(
-	VkPhysicalDevice const &physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties )
+	VkPhysicalDevice const &physicalDevice,
+	uint32_t typeFilter,
+	VkMemoryPropertyFlags properties,
+	VkMemoryPropertyFlags preferredProperties )
 {
 	// Query info about the available types of memory
 	VkPhysicalDeviceMemoryProperties memProperties;	// We get memory types and memory heaps from this
 	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
 
+	VkMemoryPropertyFlags allProperties = properties | preferredProperties;
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+		if (typeFilter & (1 << i) &&
+			(memProperties.memoryTypes[i].propertyFlags & allProperties) == allProperties) {
+			return i;
+		}
+	}
+
 	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
 		/* The parameter typeFilter that passed in is from memoryTypeBits of struct VkMemoryRequirements.
 			It is a bit field that sets a bit for every memoryType that is supported for the resource.
@@ -41,9 +56,10 @@ VulkanBuffer::VulkanBuffer(
 	VkPhysicalDevice physicalDevice,
 	VkDeviceSize size,
 	VkBufferUsageFlags usage,
-	VkMemoryPropertyFlags properties )
+	VkMemoryPropertyFlags properties,
+	VkMemoryPropertyFlags preferredProperties )
 	: VulkanBaseObject(physicalDevice, logicalDevice)
-	, mSize(size), mUsage(usage), mProperties(properties)
+	, mSize(size), mUsage(usage), mProperties(properties), mPreferredProperties(preferredProperties)
 {
 	createBuffer();
 }
@@ -53,19 +69,27 @@ void VulkanBuffer::lazyInit(
 	VkPhysicalDevice physicalDevice,
 	VkDeviceSize size,
 	VkBufferUsageFlags usage,
-	VkMemoryPropertyFlags properties )
+	VkMemoryPropertyFlags properties,
+	VkMemoryPropertyFlags preferredProperties )
 {
 	mLogicalDevice = logicalDevice;
 	mPhysicalDevice = physicalDevice;
 	mSize = size;
 	mUsage = usage;
 	mProperties = properties;
+	mPreferredProperties = preferredProperties;
 
 	createBuffer();
 }
 
 void VulkanBuffer::uploadData(void *data, VkDeviceSize size)
 {
+	// Already mapped, just write through the persistent mapping
+	if (mpMappedMemory) {
+		memcpy(mpMappedMemory, data, static_cast<size_t>(size));
+		return;
+	}
+
 	void *pMappedMemory = nullptr;
 
 	vkMapMemory(mLogicalDevice, mMemoryHandle, 0, size, 0, &pMappedMemory);
@@ -73,8 +97,27 @@ void VulkanBuffer::uploadData(void *data, VkDeviceSize size)
 	vkUnmapMemory(mLogicalDevice, mMemoryHandle);
 }
 
+void *VulkanBuffer::map()
+{
+	if (!mpMappedMemory && vkMapMemory(mLogicalDevice, mMemoryHandle, 0, mSize, 0, &mpMappedMemory) != VK_SUCCESS) {
+		throw std::runtime_error("[ERROR] Failed to map buffer memory!");
+	}
+
+	return mpMappedMemory;
+}
+
+void VulkanBuffer::unmap()
+{
+	if (mpMappedMemory) {
+		vkUnmapMemory(mLogicalDevice, mMemoryHandle);
+		mpMappedMemory = nullptr;
+	}
+}
+
 void VulkanBuffer::cleanUp()
 {
+	unmap();
+
 	vkDestroyBuffer(mLogicalDevice, mBuffer, nullptr);
 	vkFreeMemory(mLogicalDevice, mMemoryHandle, nullptr);
 }
@@ -96,7 +139,7 @@ void VulkanBuffer::createBuffer()
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(mLogicalDevice, mBuffer, &memRequirements);
 
-	allocateMemory(memRequirements, mProperties);
+	allocateMemory(memRequirements, mProperties, mPreferredProperties);
 
 	// Associate the memory with the buffer
 	vkBindBufferMemory(mLogicalDevice, mBuffer, mMemoryHandle, 0);
@@ -1,40 +1,211 @@
 #include "VulkanCommandBuffers.h"
 
-VkCommandBuffer beginSingleTimeCommands(VkDevice logicalDevice, VkCommandPool commandPool)
+#include <stdexcept>
+
+void SingleTimeCommandPool::lazyInit(VkDevice logicalDevice, uint32_t queueFamilyIndex, VkQueue queue, VulkanTimeline *pTimeline)
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = 1;
+	mLogicalDevice = logicalDevice;
+	mQueue = queue;
+	mpTimeline = pTimeline;
+
+	// Transient: the command buffers are short-lived. Reset: each one is reset on its own when reused.
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(mLogicalDevice, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create single time command pool!");
+	}
+}
+
+VkCommandBuffer SingleTimeCommandPool::begin()
+{
+	Slot &slot = mSlots[acquireSlot()];
+	slot.state = SlotState::Recording;
 
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+	vkResetCommandBuffer(slot.commandBuffer, 0);
 
 	// Start recording the command buffer
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // We are going to use this command buffer once
 
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to begin recording single time command buffer!");
+	}
+
+	return slot.commandBuffer;
+}
+
+SingleTimeSubmission SingleTimeCommandPool::submit(VkCommandBuffer commandBuffer)
+{
+	for (uint32_t i = 0; i < mSlots.size(); ++i)
+	{
+		Slot &slot = mSlots[i];
+
+		if (slot.commandBuffer != commandBuffer || slot.state != SlotState::Recording)
+		{
+			continue;
+		}
+
+		// Stop recording
+		vkEndCommandBuffer(commandBuffer);
+
+		// Submit and execute the command buffer, the fence or timeline value tells when the slot can be reused
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		if (mpTimeline)
+		{
+			slot.timelineValue = mpTimeline->submit(mQueue, submitInfo);
+		}
+		else
+		{
+			vkResetFences(mLogicalDevice, 1, &slot.fence);
+
+			if (vkQueueSubmit(mQueue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit single time command buffer!");
+			}
+		}
+
+		slot.state = SlotState::Pending;
+
+		return { i, slot.generation, slot.timelineValue };
+	}
+
+	throw std::runtime_error("Command buffer wasn't begun from this single time command pool!");
+}
+
+void SingleTimeCommandPool::wait(SingleTimeSubmission submission)
+{
+	if (submission.slot >= mSlots.size())
+	{
+		return;
+	}
+
+	Slot &slot = mSlots[submission.slot];
+
+	// A newer generation means it was already waited on and the slot has been recycled
+	if (slot.generation != submission.generation || slot.state != SlotState::Pending)
+	{
+		return;
+	}
+
+	if (mpTimeline)
+	{
+		mpTimeline->wait(slot.timelineValue);
+	}
+	else
+	{
+		vkWaitForFences(mLogicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+	}
 
-	return commandBuffer;
+	recycle(slot);
 }
 
-void endSingleTimeCommands(VkDevice logicalDevice, VkCommandPool commandPool, VkQueue queue, VkCommandBuffer commandBuffer)
+bool SingleTimeCommandPool::isComplete(SingleTimeSubmission submission)
 {
-	// Stop recording
-	vkEndCommandBuffer(commandBuffer);
+	if (submission.slot >= mSlots.size())
+	{
+		return true;
+	}
 
-	// Submit and execute the command buffer
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	Slot &slot = mSlots[submission.slot];
 
-	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE); // We are not using fence
-	vkQueueWaitIdle(queue); // Wait for this transfer to complete
+	if (slot.generation != submission.generation || slot.state != SlotState::Pending)
+	{
+		return true;
+	}
 
-	// Clean up our temporary command buffer
-	vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+	if (isSlotDone(slot))
+	{
+		recycle(slot);
+		return true;
+	}
+
+	return false;
+}
+
+void SingleTimeCommandPool::cleanUp()
+{
+	for (Slot &slot : mSlots)
+	{
+		vkDestroyFence(mLogicalDevice, slot.fence, nullptr); // VK_NULL_HANDLE with a timeline, which is fine
+	}
+
+	// Command buffers are freed along with the pool
+	vkDestroyCommandPool(mLogicalDevice, mCommandPool, nullptr);
+	mSlots.clear();
+}
+
+/**
+ * Reuses a free slot, or one whose submission has finished without anybody waiting on it.
+ *  Only when all are busy is another command buffer (and fence, without a timeline) created.
+ */
+uint32_t SingleTimeCommandPool::acquireSlot()
+{
+	for (uint32_t i = 0; i < mSlots.size(); ++i)
+	{
+		Slot &slot = mSlots[i];
+
+		if (slot.state == SlotState::Pending && isSlotDone(slot))
+		{
+			recycle(slot);
+		}
+
+		if (slot.state == SlotState::Free)
+		{
+			return i;
+		}
+	}
+
+	Slot slot;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = mCommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(mLogicalDevice, &allocInfo, &slot.commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate single time command buffer!");
+	}
+
+	if (!mpTimeline)
+	{
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create single time command fence!");
+		}
+	}
+
+	mSlots.push_back(slot);
+
+	return static_cast<uint32_t>(mSlots.size() - 1);
+}
+
+bool SingleTimeCommandPool::isSlotDone(Slot const &slot)
+{
+	if (mpTimeline)
+	{
+		return mpTimeline->isComplete(slot.timelineValue);
+	}
+
+	return vkGetFenceStatus(mLogicalDevice, slot.fence) == VK_SUCCESS;
+}
+
+void SingleTimeCommandPool::recycle(Slot &slot)
+{
+	slot.state = SlotState::Free;
+	++slot.generation;
 }
\ No newline at end of file
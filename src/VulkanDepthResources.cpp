@@ -27,15 +27,13 @@ VkAttachmentReference VulkanDepthResources::getDepthAttachmentReference() const
 void VulkanDepthResources::lazyInit(
 	VkPhysicalDevice physicalDevice,
 	VkDevice logicalDevice,
-	VkCommandPool commandPool,
-	VkQueue queue,
+	SingleTimeCommandPool &singleTimeCommands,
 	uint32_t swapChainWidth,
 	uint32_t swapChainHeight )
 {
 	mPhysicalDevice = physicalDevice;
 	mLogicalDevice = logicalDevice;
-	mCommandPool = commandPool;
-	mQueue = queue;
+	mpSingleTimeCommands = &singleTimeCommands;
 
 	VkFormat depthFormat = findDepthFormat(mPhysicalDevice);
 
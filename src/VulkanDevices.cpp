@@ -1 +1,249 @@
 #include "VulkanDevices.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	uint32_t dropPatchVersion(uint32_t version)
+	{
+		return VK_MAKE_VERSION(VK_VERSION_MAJOR(version), VK_VERSION_MINOR(version), 0);
+	}
+}
+
+void VulkanDeviceFeatures::query(VkInstance instance, VkPhysicalDevice physicalDevice, uint32_t instanceApiVersion)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	// A device may report a newer version than the instance was created with, only the lower one is usable
+	mApiVersion = std::min(dropPatchVersion(instanceApiVersion), dropPatchVersion(properties.apiVersion));
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	mAvailableExtensions.resize(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, mAvailableExtensions.data());
+
+	mExtensions.clear();
+	mBindlessTextures = false;
+	mMaxBindlessTextures = 0;
+	mTimelineSemaphores = false;
+	mDynamicRendering = false;
+	mSynchronization2 = false;
+
+	VkPhysicalDeviceFeatures coreFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &coreFeatures);
+
+	mDrawIndirectFirstInstance = coreFeatures.drawIndirectFirstInstance;
+	mMultiDrawIndirect = coreFeatures.multiDrawIndirect;
+
+	// Core in 1.2 as well, but only behind the drawIndirectCount feature of VkPhysicalDeviceVulkan12Features,
+	//  which can't be chained together with the separate feature structs above. The extension has no feature bit.
+	mDrawIndirectCount = hasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+	if (mDrawIndirectCount) {
+		mExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+
+	// vkGetPhysicalDeviceFeatures2 is core from 1.1 on. A 1.0 instance would need
+	//  VK_KHR_get_physical_device_properties2 for it, those devices just get the 1.0 path.
+	if (mApiVersion < VK_API_VERSION_1_1) {
+		return;
+	}
+
+	PFN_vkGetPhysicalDeviceFeatures2 pGetFeatures2 =
+		(PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2");
+	PFN_vkGetPhysicalDeviceProperties2 pGetProperties2 =
+		(PFN_vkGetPhysicalDeviceProperties2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2");
+
+	if (!pGetFeatures2 || !pGetProperties2) {
+		return;
+	}
+
+	bool descriptorIndexingAvailable =
+		mApiVersion >= VK_API_VERSION_1_2 || hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+	bool timelineSemaphoreAvailable =
+		mApiVersion >= VK_API_VERSION_1_2 || hasExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexing{};
+	descriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore{};
+	timelineSemaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+#ifdef VK_KHR_dynamic_rendering
+	bool dynamicRenderingAvailable = mApiVersion >= VK_API_VERSION_1_3 ||
+		(mApiVersion >= VK_API_VERSION_1_2 && hasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME));
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{};
+	dynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+#endif
+
+#ifdef VK_KHR_synchronization2
+	bool synchronization2Available =
+		mApiVersion >= VK_API_VERSION_1_3 || hasExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2{};
+	synchronization2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+#endif
+
+	// Only chain the structs the device knows about
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+	if (descriptorIndexingAvailable) {
+		descriptorIndexing.pNext = features.pNext;
+		features.pNext = &descriptorIndexing;
+	}
+
+	if (timelineSemaphoreAvailable) {
+		timelineSemaphore.pNext = features.pNext;
+		features.pNext = &timelineSemaphore;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	if (dynamicRenderingAvailable) {
+		dynamicRendering.pNext = features.pNext;
+		features.pNext = &dynamicRendering;
+	}
+#endif
+
+#ifdef VK_KHR_synchronization2
+	if (synchronization2Available) {
+		synchronization2.pNext = features.pNext;
+		features.pNext = &synchronization2;
+	}
+#endif
+
+	pGetFeatures2(physicalDevice, &features);
+
+	VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+	descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = descriptorIndexingAvailable ? &descriptorIndexingProperties : nullptr;
+	pGetProperties2(physicalDevice, &properties2);
+
+	// The bindless texture table is a runtime sized sampler array, indexed non-uniformly, with
+	//  slots that may never be written, and that is updated while command buffers using it are pending
+	mBindlessTextures = descriptorIndexingAvailable &&
+		descriptorIndexing.runtimeDescriptorArray &&
+		descriptorIndexing.shaderSampledImageArrayNonUniformIndexing &&
+		descriptorIndexing.descriptorBindingPartiallyBound &&
+		descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind &&
+		descriptorIndexing.descriptorBindingUpdateUnusedWhilePending;
+
+	if (mBindlessTextures) {
+		mMaxBindlessTextures = std::min({
+			descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+			descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+			descriptorIndexingProperties.maxPerStageUpdateAfterBindResources
+		});
+
+		// Only turn on what we use, not everything the device reported
+		mDescriptorIndexing = {};
+		mDescriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		mDescriptorIndexing.runtimeDescriptorArray = VK_TRUE;
+		mDescriptorIndexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		mDescriptorIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+		mDescriptorIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		mDescriptorIndexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+		// Promoted to core in 1.2, before that the extension has to be enabled explicitly
+		if (mApiVersion < VK_API_VERSION_1_2) {
+			mExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		}
+	}
+
+	mTimelineSemaphores = timelineSemaphoreAvailable && timelineSemaphore.timelineSemaphore;
+
+	if (mTimelineSemaphores) {
+		mTimelineSemaphore = {};
+		mTimelineSemaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		mTimelineSemaphore.timelineSemaphore = VK_TRUE;
+
+		if (mApiVersion < VK_API_VERSION_1_2) {
+			mExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	mDynamicRendering = dynamicRenderingAvailable && dynamicRendering.dynamicRendering;
+
+	if (mDynamicRendering) {
+		mDynamicRenderingFeatures = {};
+		mDynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		mDynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+		if (mApiVersion < VK_API_VERSION_1_3) {
+			mExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
+	}
+#endif
+
+#ifdef VK_KHR_synchronization2
+	mSynchronization2 = synchronization2Available && synchronization2.synchronization2;
+
+	if (mSynchronization2) {
+		mSynchronization2Features = {};
+		mSynchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		mSynchronization2Features.synchronization2 = VK_TRUE;
+
+		if (mApiVersion < VK_API_VERSION_1_3) {
+			mExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		}
+	}
+#endif
+}
+
+void *VulkanDeviceFeatures::getCreateInfoChain()
+{
+	void *pNext = nullptr;
+
+	if (mBindlessTextures) {
+		mDescriptorIndexing.pNext = pNext;
+		pNext = &mDescriptorIndexing;
+	}
+
+	if (mTimelineSemaphores) {
+		mTimelineSemaphore.pNext = pNext;
+		pNext = &mTimelineSemaphore;
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	if (mDynamicRendering) {
+		mDynamicRenderingFeatures.pNext = pNext;
+		pNext = &mDynamicRenderingFeatures;
+	}
+#endif
+
+#ifdef VK_KHR_synchronization2
+	if (mSynchronization2) {
+		mSynchronization2Features.pNext = pNext;
+		pNext = &mSynchronization2Features;
+	}
+#endif
+
+	return pNext;
+}
+
+void VulkanDeviceFeatures::enableCoreFeatures(VkPhysicalDeviceFeatures &features) const
+{
+	features.drawIndirectFirstInstance = mDrawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
+	features.multiDrawIndirect = mMultiDrawIndirect ? VK_TRUE : VK_FALSE;
+}
+
+bool VulkanDeviceFeatures::hasExtension(const char *pName) const
+{
+	for (const VkExtensionProperties &extension : mAvailableExtensions) {
+		if (strcmp(extension.extensionName, pName) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -1,16 +1,18 @@
 #include "VulkanImage.h"
 
 #include <stdexcept>
+#include <vector>
 
+#include "BarrierBatcher.h"
 #include "VulkanCommandBuffers.h"
-#include "VulkanUtils.h"
 
 VkImageView createImageView(
 	VkDevice logicalDevice,
 	VkImage image,
 	VkFormat format,
 	VkImageAspectFlags aspectFlags,
-	uint32_t mMipLevels )
+	uint32_t mMipLevels,
+	VkComponentMapping components )
 {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -20,6 +22,9 @@ VkImageView createImageView(
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D; // Treat image as 2D texture
 	viewInfo.format = format;
 
+	// Lets 1 and 2 channel textures be sampled like RGBA ones, e.g. grayscale repeated into rgb
+	viewInfo.components = components;
+
 	// Describe what the image's purpose is and which part of the image should be accessed.
 	//  In this case, images are used as color targets without mipmapping levels or multiple layers.
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
@@ -77,82 +82,144 @@ void VulkanImage::createImage(
 	vkBindImageMemory(mLogicalDevice, mImage, mMemoryHandle, 0);
 }
 
-void VulkanImage::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mMipLevels)
+SingleTimeSubmission VulkanImage::copyBufferToImage(
+	VkBuffer buffer, std::vector<MipLevel> const &levels, uint32_t mipLevels)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(mLogicalDevice, mCommandPool);
+	std::vector<VkBufferImageCopy> regions;
+	regions.reserve(levels.size());
 
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
+	for (uint32_t level = 0; level < levels.size(); ++level)
+	{
+		// Tightly packed rows, so row length and image height are left at 0
+		VkBufferImageCopy region{};
+		region.bufferOffset = levels[level].offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
 
-	// Not using the barrier to transfer queue family ownership
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
 
-	barrier.image = mImage;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = mMipLevels;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { levels[level].width, levels[level].height, 1 };
 
-	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-	{
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-		if (vkutils::hasStencilComponent(mFormat))
-		{
-			barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
+		regions.push_back(region);
 	}
-	else
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	VkCommandBuffer commandBuffer = mpSingleTimeCommands->begin();
+
+	// Whatever the image held before is overwritten, so there is nothing to wait for
+	BarrierBatcher barriers;
+	barriers.addImage(mImage, range, 0, VK_IMAGE_LAYOUT_UNDEFINED, ResourceUsage::TransferDst);
+	barriers.flush(commandBuffer);
+
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		buffer,
+		mImage,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data()
+	);
+
+	if (levels.size() >= mipLevels)
 	{
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barriers.addImage(mImage, range, ResourceUsage::TransferDst, ResourceUsage::FragmentShaderSampled);
+		barriers.flush(commandBuffer);
 	}
 
-	VkPipelineStageFlags srcStage;
-	VkPipelineStageFlags dstStage;
+	return mpSingleTimeCommands->submit(commandBuffer);
+}
 
-	// Specify which types of operations involve the resource must happen before the barrier,
-	//  and which operations that involve the resource must wait on the barrier
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+bool VulkanImage::canBlitMipmaps() const
+{
+#ifdef VULKAN_RENDERER_CPU_MIPMAPS
+	// Forced off to compare against, or to get the same mipmaps on every driver
+	return false;
+#else
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, mFormat, &formatProperties);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+									VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	return (formatProperties.optimalTilingFeatures & required) == required;
+#endif
+}
 
-		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+SingleTimeSubmission VulkanImage::generateMipmaps(uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	// Check if image format supports linear blitting
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, mFormat, &formatProperties);
 
-		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	// For depth and stencil buffers
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
 	{
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		dstStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		throw std::runtime_error("Texture image format does not support linear blitting!");
 	}
-	else
+
+	VkCommandBuffer commandBuffer = mpSingleTimeCommands->begin();
+
+	VkImageSubresourceRange level{};
+	level.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	level.baseArrayLayer = 0;
+	level.layerCount = 1;
+	level.levelCount = 1;
+
+	// A level is done once it was blitted from, that transition goes out with the next level's
+	//  transition to be blitted from, so there is one barrier command per level instead of two
+	BarrierBatcher barriers;
+
+	int32_t mipWidth = width;
+	int32_t mipHeight = height;
+
+	for (uint32_t i = 1; i < mipLevels; ++i)
 	{
-		throw std::runtime_error("Unsupported layout transition!");
+		level.baseMipLevel = i - 1;
+		barriers.addImage(mImage, level, ResourceUsage::TransferDst, ResourceUsage::TransferSrc);
+		barriers.flush(commandBuffer);
+
+		VkImageBlit blit{};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+
+		vkCmdBlitImage(
+			commandBuffer,
+			mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR
+		);
+
+		barriers.addImage(mImage, level, ResourceUsage::TransferSrc, ResourceUsage::FragmentShaderSampled);
+
+		if (mipWidth > 1) mipWidth /= 2;
+		if (mipHeight > 1) mipHeight /= 2;
 	}
 
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		srcStage, dstStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
+	// The last level is only ever blitted to
+	level.baseMipLevel = mipLevels - 1;
+	barriers.addImage(mImage, level, ResourceUsage::TransferDst, ResourceUsage::FragmentShaderSampled);
+	barriers.flush(commandBuffer);
 
-	endSingleTimeCommands(mLogicalDevice, mCommandPool, mQueue, commandBuffer);
+	return mpSingleTimeCommands->submit(commandBuffer);
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "VulkanPipelineCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	// VkPipelineCacheHeaderVersionOne, read field by field since the data has no alignment guarantees
+	const size_t kHeaderSizeOffset = 0;
+	const size_t kHeaderVersionOffset = 4;
+	const size_t kVendorIdOffset = 8;
+	const size_t kDeviceIdOffset = 12;
+	const size_t kUuidOffset = 16;
+	const size_t kHeaderSize = kUuidOffset + VK_UUID_SIZE;
+
+	uint32_t readUint32(std::vector<char> const &data, size_t offset)
+	{
+		uint32_t value;
+		memcpy(&value, data.data() + offset, sizeof(value));
+
+		return value;
+	}
+}
+
+void VulkanPipelineCache::lazyInit(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, std::string const &path)
+{
+	mLogicalDevice = logicalDevice;
+	mPath = path;
+
+	vkGetPhysicalDeviceProperties(physicalDevice, &mProperties);
+
+	std::vector<char> data;
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+	if (file.is_open()) {
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+
+		if (!file) {
+			data.clear();
+		}
+	}
+
+	mIsWarm = isCompatible(data);
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = mIsWarm ? data.size() : 0;
+	cacheInfo.pInitialData = mIsWarm ? data.data() : nullptr;
+
+	if (vkCreatePipelineCache(logicalDevice, &cacheInfo, nullptr, &mPipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+}
+
+bool VulkanPipelineCache::isCompatible(std::vector<char> const &data) const
+{
+	if (data.size() < kHeaderSize) {
+		return false;
+	}
+
+	return readUint32(data, kHeaderSizeOffset) >= kHeaderSize
+		&& readUint32(data, kHeaderVersionOffset) == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& readUint32(data, kVendorIdOffset) == mProperties.vendorID
+		&& readUint32(data, kDeviceIdOffset) == mProperties.deviceID
+		&& memcmp(data.data() + kUuidOffset, mProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void VulkanPipelineCache::save() const
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(mLogicalDevice, mPipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(mLogicalDevice, mPipelineCache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	// Written next to the old file and swapped in, so a crash while writing leaves the old one intact
+	std::string tempPath = mPath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), size);
+
+		if (!file) {
+			std::remove(tempPath.c_str());
+			return;
+		}
+	}
+
+	// rename replaces the old file in one step on POSIX. On Windows it fails while the old file exists,
+	//  so it has to be removed first, and a crash in between loses the cache. The next run starts cold then.
+	if (std::rename(tempPath.c_str(), mPath.c_str()) != 0) {
+		std::remove(mPath.c_str());
+
+		if (std::rename(tempPath.c_str(), mPath.c_str()) != 0) {
+			std::remove(tempPath.c_str());
+		}
+	}
+}
+
+void VulkanPipelineCache::cleanUp()
+{
+	vkDestroyPipelineCache(mLogicalDevice, mPipelineCache, nullptr);
+	mPipelineCache = VK_NULL_HANDLE;
+}
\ No newline at end of file
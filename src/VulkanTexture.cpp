@@ -1,20 +1,183 @@
 #include "VulkanTexture.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <vector>
+
+namespace
+{
+	/**
+	 * stb_image always allocates the decoded image itself. While a decode target is armed, the
+	 *  first allocation of exactly the image size gets the target memory instead of the heap, so
+	 *  the decoder writes its texels straight into e.g. a mapped staging buffer.
+	 *
+	 * Some decode paths allocate a buffer of that size for intermediate results and then convert
+	 *  into another one. Then the result simply ends up on the heap and is copied over.
+	 */
+	struct DecodeTarget
+	{
+		void *pMemory = nullptr;
+		size_t size = 0;
+		bool isInUse = false;
+	};
+
+	thread_local DecodeTarget tDecodeTarget;
+
+	void *decodeMalloc(size_t size)
+	{
+		if (tDecodeTarget.pMemory && !tDecodeTarget.isInUse && size == tDecodeTarget.size)
+		{
+			tDecodeTarget.isInUse = true;
+			return tDecodeTarget.pMemory;
+		}
+
+		return malloc(size);
+	}
+
+	void *decodeRealloc(void *pMemory, size_t newSize)
+	{
+		// The target can't grow, move whatever stb_image wants to grow out to the heap
+		if (pMemory && pMemory == tDecodeTarget.pMemory)
+		{
+			void *pNewMemory = malloc(newSize);
+
+			if (pNewMemory)
+			{
+				memcpy(pNewMemory, pMemory, std::min(newSize, tDecodeTarget.size));
+				tDecodeTarget.isInUse = false;
+			}
+
+			return pNewMemory;
+		}
+
+		return realloc(pMemory, newSize);
+	}
+
+	void decodeFree(void *pMemory)
+	{
+		if (pMemory && pMemory == tDecodeTarget.pMemory)
+		{
+			tDecodeTarget.isInUse = false;
+			return;
+		}
+
+		free(pMemory);
+	}
+}
+
+#define STBI_MALLOC(size) decodeMalloc(size)
+#define STBI_REALLOC(pMemory, newSize) decodeRealloc(pMemory, newSize)
+#define STBI_FREE(pMemory) decodeFree(pMemory)
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "MipGenerator.h"
 #include "VulkanBuffer.h"
 #include "VulkanCommandBuffers.h"
 #include "VulkanImage.h"
+#include "VulkanUtils.h"
 
 namespace vkTextureUtils
 {
-	stbi_uc *loadTextureImage(std::string fileName, int *pTexWidth, int *pTexHeight, int *pTexChannels)
+	void queryTextureInfo(std::string fileName, int *pTexWidth, int *pTexHeight, int *pTexChannels)
+	{
+		if (!stbi_info(fileName.c_str(), pTexWidth, pTexHeight, pTexChannels))
+		{
+			throw std::runtime_error("Failed to read texture image header!");
+		}
+	}
+
+	int queryTextureChannels(std::string fileName)
+	{
+		int texWidth, texHeight, texChannels;
+		queryTextureInfo(fileName, &texWidth, &texHeight, &texChannels);
+
+		return texChannels;
+	}
+
+	VkFormat chooseTextureFormat(VkPhysicalDevice physicalDevice, int channels, TextureUsage usage)
+	{
+		bool isColor = usage == TextureUsage::Color;
+		std::vector<VkFormat> candidates;
+
+		// R8_SRGB and R8G8_SRGB are optional formats, so fall back to RGBA8 where they are missing
+		if (channels == 1)
+		{
+			candidates.push_back(isColor ? VK_FORMAT_R8_SRGB : VK_FORMAT_R8_UNORM);
+		}
+		else if (channels == 2)
+		{
+			candidates.push_back(isColor ? VK_FORMAT_R8G8_SRGB : VK_FORMAT_R8G8_UNORM);
+		}
+
+		candidates.push_back(isColor ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+
+		// Sampled with linear filtering. Blit support isn't required, without it the mipmaps are
+		//  made on the CPU instead.
+		return vkutils::findSupportedFormat(
+			physicalDevice,
+			candidates,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+		);
+	}
+
+	bool isSrgbFormat(VkFormat format)
+	{
+		return format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8G8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+	}
+
+	uint32_t getFormatChannels(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_SRGB:
+		case VK_FORMAT_R8_UNORM:
+			return 1;
+		case VK_FORMAT_R8G8_SRGB:
+		case VK_FORMAT_R8G8_UNORM:
+			return 2;
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			return 4;
+		default:
+			throw std::runtime_error("Unsupported texture format!");
+		}
+	}
+
+	/**
+	 * Single channel textures are grayscale, so the value is repeated into rgb. Two channel sRGB
+	 *  textures can only come from a gray + alpha source; two channel linear textures are kept as
+	 *  is since those are data like normal map xy, where the shader reconstructs z itself.
+	 */
+	VkComponentMapping getFormatComponentMapping(VkFormat format)
 	{
-		stbi_uc *pixels = stbi_load(fileName.c_str(), pTexWidth, pTexHeight, pTexChannels, STBI_rgb_alpha);
+		VkComponentMapping components{
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY
+		};
+
+		if (format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8_UNORM)
+		{
+			components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+		}
+		else if (format == VK_FORMAT_R8G8_SRGB)
+		{
+			components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+		}
+
+		return components;
+	}
+
+	stbi_uc *loadTextureImage(std::string fileName, int *pTexWidth, int *pTexHeight, int *pTexChannels, int desiredChannels)
+	{
+		stbi_uc *pixels = stbi_load(fileName.c_str(), pTexWidth, pTexHeight, pTexChannels, desiredChannels);
 
 		if (!pixels)
 		{
@@ -23,6 +186,38 @@ namespace vkTextureUtils
 
 		return pixels;
 	}
+
+	void loadTextureImageInto(std::string fileName, void *pDst, uint32_t width, uint32_t height, int desiredChannels)
+	{
+		size_t imageSize = static_cast<size_t>(width) * height * desiredChannels;
+		int texWidth, texHeight, texChannels;
+
+		tDecodeTarget = { pDst, imageSize, false };
+		stbi_uc *pixels = stbi_load(fileName.c_str(), &texWidth, &texHeight, &texChannels, desiredChannels);
+		tDecodeTarget = {};
+
+		if (!pixels)
+		{
+			throw std::runtime_error("Failed to load texture image!");
+		}
+
+		if (static_cast<uint32_t>(texWidth) != width || static_cast<uint32_t>(texHeight) != height)
+		{
+			if (pixels != pDst)
+			{
+				stbi_image_free(pixels);
+			}
+
+			throw std::runtime_error("Texture image size changed while loading!");
+		}
+
+		// Only when the decoder didn't write its result into pDst itself
+		if (pixels != pDst)
+		{
+			memcpy(pDst, pixels, imageSize);
+			stbi_image_free(pixels);
+		}
+	}
 }
 
 VulkanTexture::VulkanTexture(
@@ -30,10 +225,13 @@ VulkanTexture::VulkanTexture(
 	VkPhysicalDevice physicalDevice,
 	VkDevice logicalDevice,
 	VkMemoryPropertyFlags properties,
-	VkCommandPool commandPool,
-	VkQueue queue )
-	: VulkanImage(physicalDevice, logicalDevice, commandPool, queue)
+	SingleTimeCommandPool &singleTimeCommands,
+	vkTextureUtils::TextureUsage usage,
+	JobSystem *pJobSystem )
+	: VulkanImage(physicalDevice, logicalDevice, singleTimeCommands)
 	, mFileName(fileName)
+	, mUsage(usage)
+	, mpJobSystem(pJobSystem)
 {
 	createTextureImage(properties);
 	createTextureImageView();
@@ -45,98 +243,110 @@ void VulkanTexture::lazyInit(
 	VkPhysicalDevice physicalDevice,
 	VkDevice logicalDevice,
 	VkMemoryPropertyFlags properties,
-	VkCommandPool commandPool,
-	VkQueue queue )
+	SingleTimeCommandPool &singleTimeCommands,
+	vkTextureUtils::TextureUsage usage,
+	JobSystem *pJobSystem )
 {
 	mPhysicalDevice = physicalDevice;
 	mLogicalDevice = logicalDevice;
-	mCommandPool = commandPool;
-	mQueue = queue;
+	mpSingleTimeCommands = &singleTimeCommands;
 	mFileName = fileName;
+	mUsage = usage;
+	mpJobSystem = pJobSystem;
 
 	createTextureImage(properties);
 	createTextureImageView();
 	createTextureSampler();
 }
 
-void VulkanTexture::copyBufferToImage(VkBuffer buffer)
-{
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(mLogicalDevice, mCommandPool);
-
-	// Specify which part of the buffer to be copied to which part of the image
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { mWidth, mHeight, 1 };
-
-	vkCmdCopyBufferToImage(
-		commandBuffer,
-		buffer,
-		mImage,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
-
-	endSingleTimeCommands(mLogicalDevice, mCommandPool, mQueue, commandBuffer);
-}
-
+/**
+ * Mipmaps are blitted on the GPU when the format allows it. Otherwise the whole chain is built
+ *  on the CPU and uploaded together with level 0.
+ */
 void VulkanTexture::createTextureImage(VkMemoryPropertyFlags properties)
 {
 	int texWidth, texHeight, texChannels;
+	vkTextureUtils::queryTextureInfo(mFileName, &texWidth, &texHeight, &texChannels);
 
-	stbi_uc *pixels = vkTextureUtils::loadTextureImage(mFileName, &texWidth, &texHeight, &texChannels);
+	// Keep grayscale and two channel sources at 1 or 2 bytes per texel instead of padding them to RGBA
+	VkFormat format = vkTextureUtils::chooseTextureFormat(mPhysicalDevice, texChannels, mUsage);
+	uint32_t channels = vkTextureUtils::getFormatChannels(format);
 
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
 	mWidth = texWidth;
 	mHeight = texHeight;
 
-	mMipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+	mMipLevels = MipGenerator::getMipLevelCount(mWidth, mHeight);
+
+	createImage(
+		texWidth,
+		texHeight,
+		mMipLevels,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		properties
+	);
+
+	bool blitMipmaps = canBlitMipmaps();
+	std::vector<MipLevel> levels = MipGenerator::getChainLayout(mWidth, mHeight, blitMipmaps ? 1 : mMipLevels, channels);
+	VkDeviceSize stagingSize = MipGenerator::getChainSize(levels);
 
+	// Both the PNG decoder (previous row) and the mip generator (level 0) read back what they
+	//  wrote, which is very slow from uncached, write combined memory. Cached where possible.
 	VulkanBuffer stagingBuffer
 	{
 		mLogicalDevice,
 		mPhysicalDevice,
-		imageSize,
+		stagingSize,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_CACHED_BIT
 	};
 
-	// Send data to staging buffer
-	stagingBuffer.uploadData(pixels, imageSize);
+	// Decode straight into the staging buffer, the texels never sit in a heap copy of their own
+	uint8_t *pStaging = static_cast<uint8_t *>(stagingBuffer.map());
 
-	stbi_image_free(pixels);
+	// Nothing is queued on the GPU yet, so whatever throws in here can take the image down with it
+	try
+	{
+		vkTextureUtils::loadTextureImageInto(mFileName, pStaging, mWidth, mHeight, static_cast<int>(channels));
 
-	createImage(
-		texWidth,
-		texHeight,
-		mMipLevels,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		properties
-	);
+		if (!blitMipmaps)
+		{
+			MipGenerator(MipGenerator::Filter::Box, 0, mpJobSystem).generate(pStaging, levels, channels, vkTextureUtils::isSrgbFormat(format));
+		}
+	}
+	catch (...)
+	{
+		stagingBuffer.cleanUp();
 
-	// vkCmdCopyBufferToImage requires the image to be in the right layout first.
-	transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mMipLevels);
-	copyBufferToImage(stagingBuffer.getBufferHandle());
+		vkDestroyImage(mLogicalDevice, mImage, nullptr);
+		vkFreeMemory(mLogicalDevice, mMemoryHandle, nullptr);
+		mImage = VK_NULL_HANDLE;
+		mMemoryHandle = VK_NULL_HANDLE;
 
-	stagingBuffer.cleanUp();
+		throw;
+	}
+
+	stagingBuffer.unmap();
+
+	// Ready to sample after this if every level was uploaded
+	SingleTimeSubmission copy = copyBufferToImage(stagingBuffer.getBufferHandle(), levels, mMipLevels);
 
-	// Transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
-	generateMipmaps();
+	if (levels.size() < mMipLevels)
+	{
+		// Transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+		generateMipmaps(mWidth, mHeight, mMipLevels);
+	}
+
+	// Everything above is queued already, only the staging buffer has to outlive the copy
+	mpSingleTimeCommands->wait(copy);
+	stagingBuffer.cleanUp();
 }
 
 void VulkanTexture::createTextureImageView()
 {
+	mComponents = vkTextureUtils::getFormatComponentMapping(mFormat);
 	createPersistentImageView(VK_IMAGE_ASPECT_COLOR_BIT, mMipLevels);
 }
 
@@ -183,104 +393,4 @@ void VulkanTexture::createTextureSampler()
 	{
 		throw std::runtime_error("Failed to create texture sampler!");
 	}
-}
-
-void VulkanTexture::generateMipmaps()
-{
-	// Check if image format supports linear blitting
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, mFormat, &formatProperties);
-
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-	{
-		throw std::runtime_error("Texture image format does not support linear blitting!");
-	}
-
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(mLogicalDevice, mCommandPool);
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = mImage;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-
-	int32_t mipWidth = mWidth;
-	int32_t mipHeight = mHeight;
-
-	for (uint32_t i = 1; i < mMipLevels; ++i)
-	{
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		VkImageBlit blit{};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		vkCmdBlitImage(
-			commandBuffer,
-			mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit,
-			VK_FILTER_LINEAR
-		);
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		if (mipWidth > 1) mipWidth /= 2;
-		if (mipHeight > 1) mipHeight /= 2;
-	}
-
-	// This is for the mip level 0 since it isn't handled by the loop
-	barrier.subresourceRange.baseMipLevel = mMipLevels - 1;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	endSingleTimeCommands(mLogicalDevice, mCommandPool, mQueue, commandBuffer);
 }
\ No newline at end of file
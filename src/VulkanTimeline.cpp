@@ -0,0 +1,222 @@
+#include "VulkanTimeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "VulkanDevices.h"
+
+void VulkanTimeline::lazyInit(VkDevice logicalDevice, VulkanDeviceFeatures const &deviceFeatures)
+{
+	mLogicalDevice = logicalDevice;
+	mLastSubmittedValue = 0;
+	mCompletedValue = 0;
+
+	if (!deviceFeatures.supportsTimelineSemaphores()) {
+		return;
+	}
+
+	// Promoted from VK_KHR_timeline_semaphore, which only has the suffixed names
+	bool isCore = deviceFeatures.getApiVersion() >= VK_API_VERSION_1_2;
+
+	mpfnWaitSemaphores = (PFN_vkWaitSemaphores) vkGetDeviceProcAddr(
+		mLogicalDevice, isCore ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR");
+	mpfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue) vkGetDeviceProcAddr(
+		mLogicalDevice, isCore ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR");
+
+	// Stay on fences rather than fail if the driver doesn't hand out the entry points
+	if (!mpfnWaitSemaphores || !mpfnGetSemaphoreCounterValue) {
+		return;
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &mTimelineSemaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timeline semaphore!");
+	}
+}
+
+uint64_t VulkanTimeline::submit(VkQueue queue, VkSubmitInfo const &submitInfo)
+{
+	uint64_t value = mLastSubmittedValue + 1;
+
+	if (usesTimelineSemaphore()) {
+		// The timeline goes after the batch's own signal semaphores. Their values are ignored since
+		//  they are binary, but the value array has to line up with the semaphore array.
+		std::vector<VkSemaphore> signalSemaphores(
+			submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		signalSemaphores.push_back(mTimelineSemaphore);
+
+		std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+		signalValues.back() = value;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.pNext = submitInfo.pNext;
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo timelineSubmitInfo = submitInfo;
+		timelineSubmitInfo.pNext = &timelineInfo;
+		timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+
+		if (vkQueueSubmit(queue, 1, &timelineSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit command buffers!");
+		}
+	} else {
+		VkFence fence = acquireFence();
+
+		if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+			mFreeFences.push_back(fence);
+			throw std::runtime_error("Failed to submit command buffers!");
+		}
+
+		mPendingFences.push_back({ value, fence });
+	}
+
+	mLastSubmittedValue = value;
+
+	return value;
+}
+
+uint64_t VulkanTimeline::getCompletedValue()
+{
+	if (usesTimelineSemaphore()) {
+		uint64_t value = 0;
+
+		if (mpfnGetSemaphoreCounterValue(mLogicalDevice, mTimelineSemaphore, &value) == VK_SUCCESS) {
+			mCompletedValue = std::max(mCompletedValue, value);
+		}
+	} else {
+		retireFences();
+	}
+
+	return mCompletedValue;
+}
+
+bool VulkanTimeline::isComplete(uint64_t value)
+{
+	return value <= mCompletedValue || value <= getCompletedValue();
+}
+
+void VulkanTimeline::wait(uint64_t value)
+{
+	if (value <= mCompletedValue) {
+		return;
+	}
+
+	// Nothing would ever signal it
+	if (value > mLastSubmittedValue) {
+		throw std::runtime_error("Waiting for a timeline value that was never submitted!");
+	}
+
+	if (usesTimelineSemaphore()) {
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &mTimelineSemaphore;
+		waitInfo.pValues = &value;
+
+		if (mpfnWaitSemaphores(mLogicalDevice, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to wait for timeline semaphore!");
+		}
+
+		mCompletedValue = std::max(mCompletedValue, value);
+		return;
+	}
+
+	// Batches may finish out of order, so wait for every fence up to the first one at or past value
+	std::vector<VkFence> fences;
+
+	for (PendingFence const &pending : mPendingFences) {
+		fences.push_back(pending.fence);
+
+		if (pending.value >= value) {
+			break;
+		}
+	}
+
+	vkWaitForFences(mLogicalDevice, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+
+	retireFences();
+}
+
+void VulkanTimeline::destroyAfter(uint64_t value, std::function<void()> deleter)
+{
+	auto later = std::upper_bound(mDeletionQueue.begin(), mDeletionQueue.end(), value,
+		[](uint64_t value, PendingDeletion const &deletion) { return value < deletion.value; });
+
+	mDeletionQueue.insert(later, { value, std::move(deleter) });
+}
+
+void VulkanTimeline::collectGarbage()
+{
+	if (mDeletionQueue.empty()) {
+		return;
+	}
+
+	uint64_t completedValue = getCompletedValue();
+
+	while (!mDeletionQueue.empty() && mDeletionQueue.front().value <= completedValue) {
+		// Off the queue first, the deleter may queue up more
+		std::function<void()> deleter = std::move(mDeletionQueue.front().deleter);
+		mDeletionQueue.pop_front();
+
+		deleter();
+	}
+}
+
+void VulkanTimeline::cleanUp()
+{
+	wait(mLastSubmittedValue);
+	collectGarbage();
+
+	for (VkFence fence : mFreeFences) {
+		vkDestroyFence(mLogicalDevice, fence, nullptr);
+	}
+
+	mFreeFences.clear();
+
+	vkDestroySemaphore(mLogicalDevice, mTimelineSemaphore, nullptr);
+	mTimelineSemaphore = VK_NULL_HANDLE;
+}
+
+VkFence VulkanTimeline::acquireFence()
+{
+	retireFences();
+
+	if (!mFreeFences.empty()) {
+		VkFence fence = mFreeFences.back();
+		mFreeFences.pop_back();
+
+		vkResetFences(mLogicalDevice, 1, &fence);
+		return fence;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+	if (vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timeline fence!");
+	}
+
+	return fence;
+}
+
+void VulkanTimeline::retireFences()
+{
+	while (!mPendingFences.empty() && vkGetFenceStatus(mLogicalDevice, mPendingFences.front().fence) == VK_SUCCESS) {
+		mCompletedValue = mPendingFences.front().value;
+		mFreeFences.push_back(mPendingFences.front().fence);
+		mPendingFences.pop_front();
+	}
+}
\ No newline at end of file
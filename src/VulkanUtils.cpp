@@ -1,6 +1,7 @@
 #include "VulkanUtils.h"
 
 #include <iostream>
+#include <stdexcept>
 
 namespace vkutils
 {
@@ -58,12 +59,20 @@ namespace vkutils
 			{
 				return format;
 			}
-
-			throw std::runtime_error("Failed to find supported format");
 		}
 
-		// Some control flow issue here: Not all paths return a value. Throwing an exception as an else
-		//  case seems a bit weird.
+		// Only give up once every candidate has been checked, they are listed in order of preference
+		throw std::runtime_error("Failed to find supported format");
+	}
+
+	VkFormat findDepthFormat(VkPhysicalDevice physicalDevice)
+	{
+		return findSupportedFormat(
+			physicalDevice,
+			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		);
 	}
 
 	bool hasStencilComponent(VkFormat format)
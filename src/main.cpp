@@ -10,10 +10,10 @@
 #include <algorithm>
 #include <array>
 #include <chrono> // Precise timekeeping
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -23,14 +23,31 @@
 #include <string>
 #include <vector>
 
+#include "DescriptorAllocator.h"
+#include "DescriptorUpdateTemplate.h"
+#include "DrawList.h"
+#include "FrameCommandRecorder.h"
+#include "GeometryPool.h"
+#include "GpuCuller.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
 #include "Mesh.h"
+#include "PerDrawData.h"
+#include "PipelineLayoutCache.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "ShaderLibrary.h"
+#include "ShaderReflection.h"
 #include "Vertex.h"
 #include "VulkanBaseApplication.h"
+#include "VulkanBindlessTextures.h"
 #include "VulkanBuffer.h"
 #include "VulkanCommandBuffers.h"
-#include "VulkanDepthResources.h"
+#include "VulkanDevices.h"
 #include "VulkanImage.h"
+#include "VulkanPipelineCache.h"
 #include "VulkanTexture.h"
+#include "VulkanTimeline.h"
 #include "VulkanUtils.h"
 
 #ifdef _MSC_VER
@@ -39,11 +56,73 @@ constexpr char resource_dir[] = "../../resources/";
 constexpr char resource_dir[] = "../resources/";
 #endif
 
+// Relative to the working directory rather than resource_dir, what the driver compiled belongs to this
+//  machine and not in the repository
+constexpr char pipeline_cache_file[] = "pipeline_cache.bin";
+
 const uint32_t WIDTH = 800, HEIGHT = 600;
 
 // How many frames should be processed concurrently
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Upper bound for the threads recording draws each frame, the hardware may lower it further
+const uint32_t MAX_RECORDING_THREADS = 4;
+
+// Threads for the job system besides the main thread, 0 for one per remaining hardware thread
+const uint32_t JOB_WORKER_THREADS = 0;
+
+// The camera looks at the origin from here, depth range of its projection
+const glm::vec3 CAMERA_POSITION(2.0f, 2.0f, 2.0f);
+const float CAMERA_NEAR_PLANE = 0.1f, CAMERA_FAR_PLANE = 10.0f;
+
+// Cull and build the draws on the GPU and draw them indirectly. Without it, or without drawIndirectFirstInstance,
+//  every draw is recorded with vkCmdDrawIndexed from mDrawList, which stays as the reference to compare against.
+//  Off until cull.comp and the indirect draws have run clean under the validation layers, on lavapipe at least.
+const bool GPU_DRIVEN_DRAWS = false;
+
+// Upper bound for the objects in the scene, the size of the instance and indirect draw buffers
+const uint32_t MAX_INSTANCES = 16384;
+
+// Capacity of the vertex and index buffers every mesh is sub-allocated from
+const uint32_t GEOMETRY_POOL_VERTICES = 1 << 20;
+const uint32_t GEOMETRY_POOL_INDICES = 4 << 20;
+
+// Sample textures from one global table indexed per draw where the device has descriptor indexing. Without
+//  it the scene shader samples the texture at binding 1 of set 0. Off until bindless.frag and the update after
+//  bind table have run clean under the validation layers, on lavapipe at least.
+const bool USE_BINDLESS_TEXTURES = false;
+
+// Upper bound for the bindless texture table, the device limit may lower it further
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+// Material features of the scene's fragment shader. Folded in as specialization constants, so every
+//  combination is its own branch free pipeline compiled from the same SPIR-V.
+const bool SCENE_USE_TEXTURE = true;
+const bool SCENE_USE_VERTEX_COLOR = false;
+const bool SCENE_ALPHA_TEST = false;
+
+// Write set 0 with a descriptor update template where the device has them (1.1). Without it every set is
+//  written with vkUpdateDescriptorSets, to compare the two.
+const bool USE_DESCRIPTOR_UPDATE_TEMPLATES = true;
+
+// Begin the scene pass with vkCmdBeginRendering where the device has dynamic rendering (1.3, or
+//  VK_KHR_dynamic_rendering). Without it the render graph creates a render pass and framebuffers.
+const bool USE_DYNAMIC_RENDERING = true;
+
+// Record the render graph's barriers with vkCmdPipelineBarrier2 where the device has synchronization2 (1.3,
+//  or VK_KHR_synchronization2). Without it they go through vkCmdPipelineBarrier with coarser masks.
+const bool USE_SYNCHRONIZATION2 = true;
+
+/**
+ * constant_id of the specialization constants in simple.frag and bindless.frag
+ */
+enum SceneShaderConstant : uint32_t
+{
+	USE_TEXTURE_CONSTANT = 0,
+	USE_VERTEX_COLOR_CONSTANT = 1,
+	ALPHA_TEST_CONSTANT = 2
+};
+
 // List of required device extensions
 const std::vector<const char *> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -76,13 +155,25 @@ struct SwapChainSupportDetails
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+/**
+ * Only what changes once per frame. Transforms are per draw (PerDrawData) and per instance (InstanceData).
+ */
 struct UniformBufferObject
 {
-	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
 };
 
+/**
+ * What set 0 points at, packed the way mSceneDescriptorUpdate reads it. Only the bindings the scene's
+ *  shaders declare are written.
+ */
+struct SceneDescriptors
+{
+	VkDescriptorBufferInfo ubo;
+	VkDescriptorImageInfo texture;
+};
+
 class HelloTriangleApplication
 {
 public:
@@ -202,7 +293,9 @@ private:
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		// Ask for the newest version we know how to use; optional features are checked per device later
+		mInstanceApiVersion = VulkanBaseApplication::queryInstanceApiVersion();
+		appInfo.apiVersion = mInstanceApiVersion;
 
 		// Get info about required extensions
 		std::vector<const char *> extensions = getRequiredExtensions();
@@ -355,6 +448,11 @@ private:
 		} else {
 			throw std::runtime_error("[ERROR] Failed to find a suitable GPU!");
 		}
+
+		// Find out which of the optional features the picked device has, before creating the logical device
+		mDeviceFeatures.query(instance, physicalDevice, mInstanceApiVersion);
+
+		mUseBindlessTextures = USE_BINDLESS_TEXTURES && mDeviceFeatures.supportsBindlessTextures();
 	}
 
 	void createLogicalDevice()
@@ -381,15 +479,21 @@ private:
 		// Specify the set of device features that we'll be using
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		mDeviceFeatures.enableCoreFeatures(deviceFeatures);
+
+		// Required extensions plus the ones the optional features we found depend on
+		std::vector<const char *> extensions = deviceExtensions;
+		extensions.insert(extensions.end(), mDeviceFeatures.getExtensions().begin(), mDeviceFeatures.getExtensions().end());
 
 		// Create a logical device
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = mDeviceFeatures.getCreateInfoChain();	// Feature structs beyond VkPhysicalDeviceFeatures
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 
 		// These 2 fields enabledLayerCount and ppEnabledLayerNames are ignored by up-to-date implementation
 		//  of Vulkan, but it's still a good idea to set them for backward compatibility.
@@ -556,11 +660,21 @@ private:
 		createInfo.presentMode = presentMode;
 		createInfo.clipped = VK_TRUE;	// Clipping for better performance, we don't care about obscured pixels.
 
+		// On a resize the old swap chain is handed over, which lets the driver reuse its resources and
+		//  keep presenting what was already queued to it. VK_NULL_HANDLE the first time around.
+		VkSwapchainKHR oldSwapChain = swapChain;
+		createInfo.oldSwapchain = oldSwapChain;
+
 		// Actually create the swap chain
 		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 			throw std::runtime_error("[ERROR] Failed to create swap chain!");
 		}
 
+		// Retired now, images already acquired from it are not used anymore since the device is idle
+		if (oldSwapChain != VK_NULL_HANDLE) {
+			vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+		}
+
 		// Retrieve the handles of images in the swap chain. They are cleaned up automatically when the swap chain is destroyed.
 		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
 		swapChainImages.resize(imageCount);
@@ -581,434 +695,310 @@ private:
 	}
 
 	/**
-	 * Render pass object tells Vulkan about the framebuffer attachments for the rendering process.
-	 * Specify how many color and depth buffers will be used, and how many samples to use for each
-	 *  of them and how their contents should be handled over the rendering operations.
+	 * The frame as a render graph: one scene pass that draws into the acquired swap chain image and a
+	 *  depth image the graph owns. The graph derives the render pass, its load and store ops and the
+	 *  layout transitions from that, so nothing here says UNDEFINED or PRESENT_SRC_KHR anymore.
+	 *
+	 * With dynamic rendering there is no render pass at all, the graph gives the attachments to
+	 *  vkCmdBeginRendering every frame and the pipeline only depends on their formats.
 	 */
-	void createRenderPass()
+	void createRenderGraph()
 	{
-		// Have a single color buffer attachment represented by one of the images from the swap chain
-		VkAttachmentDescription colorAttachment{};
-		colorAttachment.format = swapChainImageFormat;
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;				// No multiplesampling, only use 1 sample
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;			// Clear the color attachment before drawing new frame
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;			// Rendered contents will be stored in memory to be read later
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;		// We don't care what previous layout the image was in
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;	// We want the image to be ready for presentation using the swap chain after rendering
-
-		// Every subpass references one or more attachments with VkAttachmentReference struct
-		VkAttachmentReference colorAttachmentRef{};
-		colorAttachmentRef.attachment = 0;	// Directly referenced "layout(location = 0) out vec4 outColor" directive in the fragment shader
-		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;	// We intend to use attachment as a color buffer
-
-		VkAttachmentReference depthAttachmentReference = mDepthResources.getDepthAttachmentReference();
-
-		VkSubpassDescription subpass{};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
-		subpass.pDepthStencilAttachment = &depthAttachmentReference;
-
-		VkSubpassDependency dependency{};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT; // Specify which operations to wait on
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, mDepthResources.getDepthAttachmentDescription(physicalDevice) };
-		VkRenderPassCreateInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		renderPassInfo.pAttachments = attachments.data();
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
-
-		if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create render pass!");
+		mRenderGraph.lazyInit(physicalDevice, device);
+
+		if (USE_DYNAMIC_RENDERING) {
+			mRenderGraph.useDynamicRendering(mDeviceFeatures);
 		}
-	}
 
-	// Create and bind descriptors for ubo and sampler
-	void createDescriptorSetLayout()
-	{
-		VkDescriptorSetLayoutBinding uboLayoutBinding{};
-		uboLayoutBinding.binding = 0; // Should match the descriptor in the vertex shader
-		uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor is ubo
-		uboLayoutBinding.descriptorCount = 1; // Number of values in the array; we can bind an array of ubo's
-		uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Vertex shader stage is going to reference this descriptor
-		uboLayoutBinding.pImmutableSamplers = nullptr; // For image sampling related descriptor
-
-		VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-		samplerLayoutBinding.binding = 1;
-		samplerLayoutBinding.descriptorCount = 1;
-		samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		samplerLayoutBinding.pImmutableSamplers = nullptr;
-		samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT; // Intend to use sampler descriptor in fragment shader
-
-		std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-
-		// All descriptor bindings are combined into a single VkDescriptorSetLayout
-		VkDescriptorSetLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-		layoutInfo.pBindings = bindings.data();
-
-		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create descriptor set layout!");
+		if (USE_SYNCHRONIZATION2) {
+			mRenderGraph.useSynchronization2(mDeviceFeatures);
 		}
-	}
 
-	/**
-	 * Descriptor sets can't be created directly, they must be allocated from a pool like command buffers.
-	 */
-	void createDescriptorPool()
-	{
-		// Describe which descriptor types our descriptor sets are going to contain and how many
-		std::array <VkDescriptorPoolSize, 2> poolSizes{};
+		RenderGraph::ImageDesc swapChainDesc{};
+		swapChainDesc.format = swapChainImageFormat;
+		swapChainDesc.extent = swapChainExtent;
 
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+		// The image comes back from presentation, and whatever was in it is cleared anyway
+		mSwapChainTarget = mRenderGraph.importImage(
+			"swapchain", swapChainDesc, ResourceUsage::Present, ResourceUsage::Present, false);
+
+		RenderGraph::ImageDesc depthDesc{};
+		depthDesc.format = vkutils::findDepthFormat(physicalDevice);
+		depthDesc.extent = swapChainExtent;
+		depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		if (vkutils::hasStencilComponent(depthDesc.format)) {
+			depthDesc.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		uint32_t depth = mRenderGraph.createImage("depth", depthDesc);
+
+		// The culling passes fill the indirect draws the scene pass draws, the graph puts the barriers in between
+		uint32_t drawBuffer = 0, countBuffer = 0;
+
+		if (mUseGpuCulling) {
+			drawBuffer = mRenderGraph.importBuffer("draws", ResourceUsage::IndirectCommandRead, ResourceUsage::IndirectCommandRead);
+			countBuffer = mRenderGraph.importBuffer("draw count", ResourceUsage::IndirectCommandRead, ResourceUsage::IndirectCommandRead);
+			mRenderGraph.setImportedBuffer(drawBuffer, mGpuCuller.getDrawBuffer());
+			mRenderGraph.setImportedBuffer(countBuffer, mGpuCuller.getCountBuffer());
+
+			uint32_t resetPass = mRenderGraph.addPass(
+				"cull reset",
+				RenderGraph::PassType::Transfer,
+				[this](VkCommandBuffer commandBuffer, RenderGraph::PassContext const &) {
+					mGpuCuller.recordReset(commandBuffer);
+				}
+			);
+			mRenderGraph.use(resetPass, countBuffer, ResourceUsage::TransferDst);
+
+			uint32_t cullPass = mRenderGraph.addPass(
+				"cull",
+				RenderGraph::PassType::Compute,
+				[this](VkCommandBuffer commandBuffer, RenderGraph::PassContext const &) {
+					mGpuCuller.recordCull(commandBuffer, mViewProjection);
+				}
+			);
+			mRenderGraph.use(cullPass, drawBuffer, ResourceUsage::ComputeShaderStorageWrite);
+			mRenderGraph.use(cullPass, countBuffer, ResourceUsage::ComputeShaderStorageWrite);
+		}
 
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+		// The draws are recorded into secondaries by mFrameRecorder, the graph only begins the render pass
+		mScenePass = mRenderGraph.addPass(
+			"scene",
+			RenderGraph::PassType::Graphics,
+			[this](VkCommandBuffer, RenderGraph::PassContext const &context) {
+				if (graphicsPipeline == VK_NULL_HANDLE) {
+					mFrameRecorder.recordPassDraws(static_cast<uint32_t>(currentFrame), context.inheritance, 0, {});
+					return;
+				}
+
+				if (mUseGpuCulling) {
+					// A handful of commands however many objects there are, not worth spreading over threads
+					mFrameRecorder.recordPassDraws(
+						static_cast<uint32_t>(currentFrame),
+						context.inheritance,
+						1,
+						[this](VkCommandBuffer commandBuffer, uint32_t, uint32_t) {
+							recordIndirectDraws(commandBuffer);
+						}
+					);
+					return;
+				}
+
+				mFrameRecorder.recordPassDraws(
+					static_cast<uint32_t>(currentFrame),
+					context.inheritance,
+					mDrawList.size(),
+					[this](VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) {
+						recordDraws(commandBuffer, first, last);
+					}
+				);
+			},
+			VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		);
 
-		// Allocate one descriptor for every frame
-		VkDescriptorPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size()); // Specify the max number of descriptor sets may be allocated
+		mRenderGraph.writeColor(mScenePass, mSwapChainTarget, VkClearColorValue{ { 0.0f, 0.0f, 0.0f, 1.0f } }); // 100% opacity black
+		mRenderGraph.writeDepth(mScenePass, depth, VkClearDepthStencilValue{ 1.0f, 0 });
 
-		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create descriptor pool!");
+		if (mUseGpuCulling) {
+			mRenderGraph.use(mScenePass, drawBuffer, ResourceUsage::IndirectCommandRead);
+			mRenderGraph.use(mScenePass, countBuffer, ResourceUsage::IndirectCommandRead);
 		}
+
+		mRenderGraph.compile();
+
+		// Owned by the graph, kept for creating the pipeline against. VK_NULL_HANDLE with dynamic rendering.
+		renderPass = mRenderGraph.getRenderPass(mScenePass);
 	}
 
 	/**
-	 * After a descriptor pool is created, we can go ahead and allocate the descriptor sets. We are
-	 *  going to create one descriptor set for each swap chain image, with the same layout. Need to store
-	 *  all copies of the same layout in one array because the function expects an array matching the
-	 *  number of sets.
-	 *
-	 * We don't need to explicitly clean up descriptor sets because they are freed when the descriptor pool
-	 *  is destroyed.
+	 * Picks the scene's shaders and reflects them, everything bound for them is derived from what they
+	 *  declare from here on.
 	 */
-	void createDescriptorSets()
+	void loadSceneShaders()
 	{
-		std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), mDescriptorSetLayout);
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = mDescriptorPool; // Descriptor pool to allocate the sets from
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size()); // Number of sets to allocate
-		allocInfo.pSetLayouts = layouts.data(); // Descriptor layout to base the sets on
+		mSceneVertexShader = ShaderLibrary::load("instance_vert.spv", std::string(resource_dir) + "shaders/");
+		mSceneFragmentShader = ShaderLibrary::load(
+			mUseBindlessTextures ? "bindless_frag.spv" : "frag.spv", std::string(resource_dir) + "shaders/");
 
-		mDescriptorSets.resize(swapChainImages.size());
+		mSceneReflection = ShaderReflection::reflect(mSceneVertexShader);
+		mSceneReflection.merge(ShaderReflection::reflect(mSceneFragmentShader));
 
-		if (vkAllocateDescriptorSets(device, &allocInfo, mDescriptorSets.data()) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to allocate descriptor sets!");
+		// The per-draw data is pushed
+		if (!mSceneReflection.getPushConstantRanges().empty()) {
+			mDrawData.setPushConstantRange(mSceneReflection.getPushConstantRanges().front());
 		}
+	}
 
-		// Allocated sets still need to be populated/configured
-		for (size_t i = 0; i < swapChainImages.size(); ++i) {
-			// Info about the buffer object that descriptor refers to
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = mpUniformBuffers[i]->getBufferHandle();
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
+	// Set 0 as the scene's shaders declare it: the ubo, and the sampler without bindless textures
+	void createDescriptorSetLayout()
+	{
+		mDescriptorSetLayout = mLayoutCache.getDescriptorSetLayout(mSceneReflection, 0);
+	}
 
-			// Info about the image that descriptor refers to
-			VkDescriptorImageInfo imageInfo{};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = mTexture.getTextureImageView();
-			imageInfo.sampler = mTexture.getTextureSampler();
-
-			// Tell Vulkan driver how configuration of descriptors is updated
-			std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = mDescriptorSets[i]; // Specify descriptor set to update
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0; // First index in the descriptor array to update; our descriptors aren't array
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Specify this descriptor refers to ubo
-			descriptorWrites[0].descriptorCount = 1; // How many descriptor want to update
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = mDescriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
-
-			// Apply the update
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	/**
+	 * With descriptor indexing, all textures live in one global array bound as set 1, and draws only
+	 *  push an index into it. Devices without it keep using the sampler at binding 1 of set 0.
+	 */
+	void createBindlessTextures()
+	{
+		if (!mUseBindlessTextures) {
+			return;
 		}
+
+		mBindlessTextures.lazyInit(device, std::min(MAX_BINDLESS_TEXTURES, mDeviceFeatures.getMaxBindlessTextures()));
 	}
 
 	/**
-	 * Simple helper function to load in the SPIR-V bytecode generated from the shaders
+	 * Descriptor sets can't be created directly, they must be allocated from a pool like command buffers.
+	 *  The allocator creates pools as they fill up, so nothing has to know in advance how many sets of
+	 *  which layout there will be. Layouts are shared through mLayoutCache.
 	 */
-	static std::vector<char> readFile(const std::string &filename)
+	void createDescriptorAllocator()
 	{
-		// We read from the end of the file, indicated by std::ios::ate.
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		mLayoutCache.lazyInit(device);
+		mDescriptorAllocator.lazyInit(device);
+	}
 
-		if (!file.is_open()) {
-			throw std::runtime_error("[ERROR] Failed to open file!");
+	/**
+	 * One descriptor set for each frame in flight, with the same layout, each pointing at that frame's
+	 *  uniform buffer. Every set is written in one go from a SceneDescriptors, the entries saying where
+	 *  each binding of the layout is in it.
+	 *
+	 * We don't need to explicitly clean up descriptor sets because they are freed when the allocator's
+	 *  pools are destroyed.
+	 */
+	void createDescriptorSets()
+	{
+		std::vector<DescriptorUpdateTemplate::Entry> entries;
+
+		for (ShaderReflection::Binding const &binding : mSceneReflection.getBindings()) {
+			if (binding.set != 0) {
+				continue;
+			}
+
+			DescriptorUpdateTemplate::Entry entry;
+			entry.binding = binding.binding;
+			entry.type = binding.type;
+
+			switch (binding.binding) {
+			case 0: entry.offset = offsetof(SceneDescriptors, ubo); break;
+			case 1: entry.offset = offsetof(SceneDescriptors, texture); break;
+			default:
+				throw std::runtime_error("[ERROR] Nothing to bind at binding " + std::to_string(binding.binding) + " of set 0!");
+			}
+
+			entries.push_back(entry);
 		}
 
-		// We read from end of file so that we can use the read position to determine the
-		//  size of the file and allocate a buffer.
-		size_t fileSize = (size_t) file.tellg();
-		std::vector<char> buffer(fileSize);
+		mSceneDescriptorUpdate.lazyInit(device, mDeviceFeatures, mDescriptorSetLayout, entries, USE_DESCRIPTOR_UPDATE_TEMPLATES);
 
-		// Seek back at the beginning of the file and read all of the bytes all of the bytes at once
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
+		mDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 
-		file.close();
+		// Allocated sets still need to be populated/configured
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+			mDescriptorSets[i] = mDescriptorAllocator.allocate(mDescriptorSetLayout);
+
+			SceneDescriptors descriptors{};
+
+			// Info about the buffer object that descriptor refers to
+			descriptors.ubo.buffer = mpUniformBuffers[i]->getBufferHandle();
+			descriptors.ubo.offset = 0;
+			descriptors.ubo.range = sizeof(UniformBufferObject);
 
-		return buffer;
+			// Info about the image that descriptor refers to
+			descriptors.texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			descriptors.texture.imageView = mTexture.getTextureImageView();
+			descriptors.texture.sampler = mTexture.getTextureSampler();
+
+			mSceneDescriptorUpdate.update(mDescriptorSets[i], &descriptors);
+		}
 	}
 
 	/**
-	 * SPIR-V bytecode must be wrapped in a VkShaderModule object before being passed to the
-	 *  graphics pipeline.
+	 * The layout only depends on the scene's shaders, so unlike the pipeline it survives swap chain
+	 *  recreation. The bindless texture table is set 1, its layout comes from mBindlessTextures since
+	 *  it needs binding flags the shaders can't express.
 	 */
-	VkShaderModule createShaderModule(const std::vector<char> &code)
+	void createPipelineLayout()
 	{
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-
-		// Reinterpret cast from char pointer to an uint32_t pointer. Data stored in a std::vector
-		//  default allocator already takes care of data alignment requirements of uint32_t.
-		createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+		std::map<uint32_t, VkDescriptorSetLayout> externalSets;
 
-		VkShaderModule shaderModule;
-		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create shader module!");
+		if (mUseBindlessTextures) {
+			externalSets[1] = mBindlessTextures.getDescriptorSetLayout();
 		}
 
-		return shaderModule;
+		pipelineLayout = mLayoutCache.getPipelineLayout(mSceneReflection, externalSets);
 	}
 
 	/**
-	 * The loading and linking of SPIR-V bytecode for execution on the GPU.
-	 * Creates shader modules for vertex shader stage and fragment shader stage, then creates
-	 *  the pipeline shader stages, finally assigns the shader stages to a pipeline stage.
+	 * Describes the scene pipeline and hands it to mPipelineStates, which compiles it on a worker unless
+	 *  the same state was compiled before. Until it is done, frames skip the scene's draws.
 	 */
 	void createGraphicsPipeline()
 	{
-		std::vector<char> vertShaderCode = readFile(std::string(resource_dir) + "shaders/vert.spv");
-		std::vector<char> fragShaderCode = readFile(std::string(resource_dir) + "shaders/frag.spv");
-
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
-		vertShaderStageInfo.pName = "main"; // Function to invoke in the shader, a.k.a the entrypoint
-
-		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
-		fragShaderStageInfo.pName = "main";
-
-		VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-		// Indicate the vertex data to pass onto the GPU
-		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-		VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = Vertex::getAttributeDescriptions();
-
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-		// What kind of geometry will be drawn from the vertices: point, line, line strip, triangle, triangle strip, etc.
-		// Also, no primitive restart
-		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-		// Viewport describes the region of the framebuffer that the output will be rendered to.
-		// Almost always (0, 0) to (width, height)
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)swapChainExtent.width;
-		viewport.height = (float)swapChainExtent.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
+		GraphicsPipelineDesc desc;
+		desc.vertexShader = mSceneVertexShader;
+		desc.fragmentShader = mSceneFragmentShader;
+		desc.fragmentConstants = {
+			{ USE_TEXTURE_CONSTANT, SCENE_USE_TEXTURE ? VK_TRUE : VK_FALSE },
+			{ USE_VERTEX_COLOR_CONSTANT, SCENE_USE_VERTEX_COLOR ? VK_TRUE : VK_FALSE },
+			{ ALPHA_TEST_CONSTANT, SCENE_ALPHA_TEST ? VK_TRUE : VK_FALSE }
+		};
 
-		// Set the scissor rectangle to cover the entire framebuffer so the rasterizer doesn't discard anything
-		VkRect2D scissor{};
-		scissor.offset = {0, 0};
-		scissor.extent = swapChainExtent;
+		// Vertices at binding 0, the transform of each instance at binding 1
+		desc.vertexBindings = { Vertex::getBindingDescription(), InstanceData::getBindingDescription() };
 
-		VkPipelineViewportStateCreateInfo viewportState{};
-		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.viewportCount = 1;
-		viewportState.pViewports = &viewport; // Can be a pointer to an array in the case of multiple viewports
-		viewportState.scissorCount = 1;
-		viewportState.pScissors = &scissor; // Can be a pointer to an array in the case of multiple scissor rectangles
-
-		VkPipelineRasterizationStateCreateInfo rasterizer{};
-		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizer.depthClampEnable = VK_FALSE; // Want to discard fragments outside the near and far planes as opposed to them being clamped to the planes.
-		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		rasterizer.depthBiasEnable = VK_FALSE;
-		rasterizer.depthBiasConstantFactor = 0.0f;
-		rasterizer.depthBiasClamp = 0.0f;
-		rasterizer.depthBiasSlopeFactor = 0.0f;
-
-		// Disable multisampling
-		VkPipelineMultisampleStateCreateInfo multisampling{};
-		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampling.sampleShadingEnable = VK_FALSE;
-		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		multisampling.minSampleShading = 1.0f;
-		multisampling.pSampleMask = nullptr;
-		multisampling.alphaToCoverageEnable = VK_FALSE;
-		multisampling.alphaToOneEnable = VK_FALSE;
-
-		VkPipelineDepthStencilStateCreateInfo depthStencil{};
-		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depthStencil.depthTestEnable = VK_TRUE;
-		depthStencil.depthWriteEnable = VK_TRUE;
-		depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-		depthStencil.depthBoundsTestEnable = VK_FALSE;
-		depthStencil.stencilTestEnable = VK_FALSE;
-
-		// Configuration per attached framebuffer
-		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_FALSE;
-		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-		// Global color blending settings
-		VkPipelineColorBlendStateCreateInfo colorBlending{};
-		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		colorBlending.logicOpEnable = VK_FALSE;
-		colorBlending.logicOp = VK_LOGIC_OP_COPY;
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
-		colorBlending.blendConstants[0] = 0.0f;
-		colorBlending.blendConstants[1] = 0.0f;
-		colorBlending.blendConstants[2] = 0.0f;
-		colorBlending.blendConstants[3] = 0.0f;
-
-		// Create pipeline layout object. Used to specify uniform values
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
-		pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout; // Specify the descriptor set layout for vertex shader to use ubo
-		pipelineLayoutInfo.pushConstantRangeCount = 0;
-		pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create pipeline layout!");
+		for (VkVertexInputAttributeDescription const &attribute : Vertex::getAttributeDescriptions()) {
+			desc.vertexAttributes.push_back(attribute);
 		}
-
-		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
-		pipelineInfo.pStages = shaderStages;
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &inputAssembly;
-		pipelineInfo.pViewportState = &viewportState;
-		pipelineInfo.pRasterizationState = &rasterizer;
-		pipelineInfo.pMultisampleState = &multisampling;
-		pipelineInfo.pDepthStencilState = &depthStencil;
-		pipelineInfo.pColorBlendState = &colorBlending;
-		pipelineInfo.pDynamicState = nullptr; // In case you want to change some values during rendering, extremely limited
-		pipelineInfo.layout = pipelineLayout;
-		pipelineInfo.renderPass = renderPass;
-		pipelineInfo.subpass = 0;
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Vulkan allows creation of new pipeline derived from existing pipeline
-		pipelineInfo.basePipelineIndex = -1;
-
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create graphics pipeline!");
+		for (VkVertexInputAttributeDescription const &attribute : InstanceData::getAttributeDescriptions()) {
+			desc.vertexAttributes.push_back(attribute);
 		}
 
-		vkDestroyShaderModule(device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	}
+		mSceneReflection.checkVertexInputs(desc.vertexAttributes);
 
-	void createFramebuffers()
-	{
-		swapChainFramebuffers.resize(swapChainImageViews.size());
+		desc.layout = pipelineLayout;
 
-		for (size_t i = 0; i < swapChainImageViews.size(); ++i) {
+		desc.colorFormats = { swapChainImageFormat };
+		desc.depthFormat = vkutils::findDepthFormat(physicalDevice);
+		desc.renderPass = renderPass;
 
-			std::array<VkImageView, 2> attachments = {
-				swapChainImageViews[i],
-				mDepthResources.getImageView()
-			};
+		mScenePipelineKey = mPipelineStates.prepare(desc);
+	}
 
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-			framebufferInfo.pAttachments = attachments.data();
-			framebufferInfo.width = swapChainExtent.width;
-			framebufferInfo.height = swapChainExtent.height;
-			framebufferInfo.layers = 1;
-
-			if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("[ERROR] Failed to create framebuffer!");
-			}
-		}
+	/**
+	 * Compiled pipelines from the last run, if it ran on the same device and driver. Shared by every
+	 *  pipeline, including the ones created again when the swap chain is recreated.
+	 */
+	void createPipelineCache()
+	{
+		mPipelineCache.lazyInit(physicalDevice, device, pipeline_cache_file);
+		mPipelineStates.lazyInit(device, mPipelineCache.getHandle(), mJobSystem);
 	}
 
 	/**
-	 * Need to create command pool before command buffers. Manage the memory used to store buffers.
+	 * Need to create command pool before command buffers. This one is for the short-lived upload and layout
+	 *  transition commands, the frames are recorded from mFrameRecorder's pools. Both submit through
+	 *  mTimeline, so uploads and frames are tracked on the same counter.
 	 */
 	void createCommandPool()
 	{
 		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
-		VkCommandPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();	// We record commands for drawing
-		poolInfo.flags = 0;	// We only record command buffers at the beginning of the program and execute them many times in the main loop
-
-		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to create command pool!");
-		}
-	}
-
-	void createDepthResources()
-	{
-		mDepthResources.lazyInit(physicalDevice, device, commandPool, graphicsQueue, swapChainExtent.width, swapChainExtent.height);
+		mTimeline.lazyInit(device, mDeviceFeatures);
+		mSingleTimeCommands.lazyInit(device, queueFamilyIndices.graphicsFamily.value(), graphicsQueue, &mTimeline);
 	}
 
 	void loadTexture(std::string textureDir)
 	{
-		mTexture.lazyInit(textureDir, physicalDevice, device, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, commandPool, graphicsQueue);
+		mTexture.lazyInit(
+			textureDir, physicalDevice, device, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mSingleTimeCommands,
+			vkTextureUtils::TextureUsage::Color, &mJobSystem );
+
+		if (mUseBindlessTextures) {
+			mTextureIndex = mBindlessTextures.addTexture(mTexture.getTextureImageView(), mTexture.getTextureSampler());
+		}
 	}
 
 	void loadModel(std::string modelDir)
@@ -1017,107 +1007,90 @@ private:
 	}
 
 	/**
-	 * Memory transfer between buffers requires command buffers, similar to drawing commands. Here,
-	 *  we must allocate a temporary command buffer. To optimize, a seperate command pool can be
-	 *  created for these short-lived command buffers.
+	 * Only the culling passes depend on the device, they need draws that start at an instance other than 0.
 	 */
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+	void createGpuCuller()
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+		mUseGpuCulling = GPU_DRIVEN_DRAWS && mDeviceFeatures.supportsDrawIndirectFirstInstance();
 
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
-		copyRegion.size = size;	// Size of the buffer being copied
-		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+		if (!mUseGpuCulling) {
+			return;
+		}
 
-		endSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
+		mGpuCuller.lazyInit(
+			physicalDevice,
+			device,
+			mDeviceFeatures,
+			MAX_INSTANCES,
+			ShaderLibrary::load("cull_comp.spv", std::string(resource_dir) + "shaders/"),
+			mDescriptorAllocator,
+			mLayoutCache,
+			mPipelineCache.getHandle() );
 	}
 
 	/**
-	 * This function utilizes a staging buffer to transfer the data from the CPU to an actual vertex buffer on
-	 *  the GPU. The reason for this because the vertex buffer would be allocated with a memory type that would
-	 *  be optimal for the graphics card to access (with VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT flag); however,
-	 *  this memory type is not accessible by the CPU. The staging buffer does have access to said memory type.
-	 *
-	 * The function is going to first create 2 buffers: a staging buffer and a vertex buffer. Pay attention to the
-	 *  VkMemoryPropertyFlags. The staging buffer uses the GPU memory that is visible to the host (the CPU), whereas
-	 *  the vertex buffer uses the device's dedicated local memory (as mentioned before). Then, the vertex data are
-	 *  copied from the CPU to the staging buffer. Finally, the vertex data are copied from the staging buffer to
-	 *  the vertex buffer.
+	 * The objects in the scene, each with the bounding sphere the culling pass tests. There is only the
+	 *  one mesh, drawn once at the origin.
 	 */
-	void createVertexBuffer()
+	void createInstances()
 	{
 		std::vector<Vertex> vertices = mMesh.getVertices();
 
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-		/* To create our staging buffer, we request to use a memory heap that
-		    is host coherent to ensure that mapped memory always matches the contents of
-		    the allocated memory. With this approach, performance might suffer
-		    slightly compared to explicit flushing. However, this is just a staging buffer
-		    so the performance hit doesn't matter.
-		*/
-		VulkanBuffer stagingBuffer{
-			/* VkDevice = */ device,
-			/* VkPhysicalDevice = */ physicalDevice,
-			/* VkDeviceSize = */ bufferSize,
-			/* VkBufferUsageFlags = */ VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			/* VkMemoryPropertyFlags = */ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-
-		mpVertexBuffer = std::make_shared<VulkanBuffer>(
-			/* VkDevice = */ device,
-			/* VkPhysicalDevice = */ physicalDevice,
-			/* VkDeviceSize = */ bufferSize,
-			/* VkBufferUsageFlags = */ VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			/* VkMemoryPropertyFlags = */ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
+		glm::vec3 boundsMin(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
 
-		//====================== Copy the vertex data to the staging buffer ======================
-		void *data;
-		// Map memory to access a region of a specified memory resource with an offset and size
-		vkMapMemory(device, stagingBuffer.getMemoryHandle(), 0, bufferSize, 0, &data);
-			memcpy(data, vertices.data(), (size_t) bufferSize);
-		vkUnmapMemory(device, stagingBuffer.getMemoryHandle());
+		for (Vertex const &vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
 
-		//================== Transfer data from staging buffer to vertex buffer ==================
-		copyBuffer(stagingBuffer.getBufferHandle(), mpVertexBuffer->getBufferHandle(), bufferSize);
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
 
-		// Clean up staging buffer
-		stagingBuffer.cleanUp();
-	}
+		for (Vertex const &vertex : vertices) {
+			radius = std::max(radius, glm::length(vertex.position - center));
+		}
 
-	void createIndexBuffer()
-	{
-		std::vector<uint32_t> indices = mMesh.getIndices();
+		GpuInstance instance{};
+		instance.model = glm::mat4(1.0f);
+		instance.boundingSphere = glm::vec4(center, radius);
+		instance.indexCount = mMeshAllocation.indexCount;
+		instance.firstIndex = mMeshAllocation.firstIndex;
+		instance.vertexOffset = static_cast<int32_t>(mMeshAllocation.firstVertex);
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		mInstances = { instance };
 
-		VulkanBuffer stagingBuffer{
-			device,
-			physicalDevice,
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-
-		mpIndexBuffer = std::make_shared<VulkanBuffer>(
-			device,
-			physicalDevice,
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
+		if (mUseGpuCulling) {
+			mGpuCuller.setInstances(mInstances);
+		}
+	}
 
-		void *data;
-		vkMapMemory(device, stagingBuffer.getMemoryHandle(), 0, bufferSize, 0, &data);
-			memcpy(data, indices.data(), (size_t) bufferSize);
-		vkUnmapMemory(device, stagingBuffer.getMemoryHandle());
+	/**
+	 * Transforms reach the vertex shader as per-instance vertex data, rewritten every frame. There is one
+	 *  buffer per frame in flight, so one frame can be written while the previous one is still drawn.
+	 */
+	void createInstanceBuffer()
+	{
+		mInstanceBuffer.lazyInit(physicalDevice, device, MAX_FRAMES_IN_FLIGHT, MAX_INSTANCES);
+	}
 
-		copyBuffer(stagingBuffer.getBufferHandle(), mpIndexBuffer->getBufferHandle(), bufferSize);
+	/**
+	 * Every mesh lives in the same pair of device local buffers, so a frame binds them once and all of its
+	 *  draws, whatever mesh they are of, can go into one multi-draw indirect call.
+	 */
+	void createGeometryPool()
+	{
+		mGeometryPool.lazyInit(
+			physicalDevice, device, mSingleTimeCommands, mTimeline, GEOMETRY_POOL_VERTICES, GEOMETRY_POOL_INDICES);
+	}
 
-		stagingBuffer.cleanUp();
+	/**
+	 * Copies the mesh into the geometry pool through a staging buffer. The upload is only submitted, the
+	 *  pool records a barrier so the frames submitted after it see the data.
+	 */
+	void uploadMesh()
+	{
+		mMeshAllocation = mGeometryPool.addMesh(mMesh.getVertices(), mMesh.getIndices());
 	}
 
 	/**
@@ -1127,13 +1100,14 @@ private:
 	 *  like doing update per frame is a terrible idea for Vulkan because of how many frames can be rendered
 	 *  at the same time).
 	 *
-	 * So, we are going to have as many ubo's as swap chain images, or one ubo per swap chain image.
+	 * So, we are going to have one ubo per frame in flight. A frame only writes its ubo once it waited for
+	 *  the last submission of the same frame slot, and unlike the swap chain image count this never changes.
 	 */
 	void createUniformBuffers()
 	{
 		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-		mpUniformBuffers.resize(swapChainImages.size());
+		mpUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
 		for (std::shared_ptr<VulkanBuffer> &pUniformBuffer : mpUniformBuffers) {
 			pUniformBuffer = std::make_shared<VulkanBuffer>(
@@ -1143,129 +1117,226 @@ private:
 				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
 			);
+
+			pUniformBuffer->map();	// Stays mapped, updateUniformBuffer writes through it
 		}
 	}
 
 	/**
-	 * Allocate and record the commands for each swap chain image. This is also where the draw call happens.
+	 * Command buffers are recorded anew every frame, so only the pools are set up here. Those
+	 *  don't depend on the swap chain and survive its recreation.
 	 */
-	void createCommandBuffers()
+	void createFrameRecorder()
 	{
-		commandBuffers.resize(swapChainFramebuffers.size());
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = commandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // Specify primary or secondary command buffers
-		allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
+		uint32_t workerCount = std::clamp(mJobSystem.getThreadCount(), 1u, MAX_RECORDING_THREADS);
 
-		if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to allocate command buffers!");
-		}
+		mFrameRecorder.lazyInit(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, workerCount, mJobSystem);
+	}
+
+	/**
+	 * Record this frame's commands for the acquired swap chain image by running the render graph, whose scene
+	 *  pass is where the draw calls happen. The frame's previous command buffers must be done executing, i.e.
+	 *  its timeline value waited on.
+	 */
+	VkCommandBuffer recordCommandBuffer(uint32_t imageIndex)
+	{
+		uint32_t frame = static_cast<uint32_t>(currentFrame);
 
-		for (size_t i = 0; i < commandBuffers.size(); ++i) {
-			VkCommandBufferBeginInfo beginInfo{};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = 0;
-			beginInfo.pInheritanceInfo = nullptr;
+		mFrameRecorder.resetFrame(frame);
 
-			// Start the recording of command buffer
-			if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-				throw std::runtime_error("[ERROR] Failed to start recording command buffer!");
+		mRenderGraph.setImportedImage(mSwapChainTarget, swapChainImages[imageIndex], swapChainImageViews[imageIndex]);
+
+		mInstanceBuffer.beginFrame(frame);
+
+		// Still compiling after a resize, the scene pass only clears until it is done
+		graphicsPipeline = mPipelineStates.get(mScenePipelineKey);
+
+		if (mUseGpuCulling) {
+			// The culling pass' draws start at their instance's index, so the transforms go in the same order
+			for (GpuInstance const &instance : mInstances) {
+				mInstanceBuffer.add(&instance.model, 1);
 			}
+		} else {
+			buildDrawList(frame);
+		}
 
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i]; // Specify attachments to bind, the color attachment
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = swapChainExtent;
+		VkCommandBuffer commandBuffer = mFrameRecorder.begin(frame);
+		mRenderGraph.execute(commandBuffer);
+		++mRecordedFrames;
 
-			std::array<VkClearValue, 2> clearValues; 
-			clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f }; // Load operation for color attachment: we clear color with 100% opacity black
-			clearValues[1].depthStencil = { 1.0f, 0 };
+		return mFrameRecorder.end(frame);
+	}
 
-			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
+	/**
+	 * Collects this frame's draws and sorts them so the ones sharing a pipeline and material are recorded
+	 *  back to back. Every instance is of mMesh, so they all end up in one instanced draw.
+	 */
+	void buildDrawList(uint32_t frame)
+	{
+		mDrawList.clear();
+
+		std::vector<glm::mat4> transforms;
+		transforms.reserve(mInstances.size());
+
+		for (GpuInstance const &instance : mInstances) {
+			transforms.push_back(instance.model);
+		}
 
-			// Our render pass commands are embedded in the primary command buffer itself. No secondary command buffers.
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		addMeshInstances(mMeshAllocation, transforms.data(), static_cast<uint32_t>(transforms.size()), frame);
 
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		mDrawList.sort(&mJobSystem);
+	}
 
-				// Bind the vertex buffer to the graphic pipeline
-				VkBuffer vertexBuffers[] = { mpVertexBuffer->getBufferHandle() };
-				VkDeviceSize offsets[] = { 0 };
-				vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+	/**
+	 * Adds one draw of count copies of the mesh, one per transform. The transforms are appended to this
+	 *  frame's instance buffer and the draw is sorted by the copy nearest to the camera.
+	 */
+	void addMeshInstances(MeshAllocation const &mesh, glm::mat4 const *pTransforms, uint32_t count, uint32_t frame)
+	{
+		if (count == 0) {
+			return;
+		}
 
-				// Bind index buffer
-				vkCmdBindIndexBuffer(commandBuffers[i], mpIndexBuffer->getBufferHandle(), 0, VK_INDEX_TYPE_UINT32);
+		DrawItem draw{};
+		draw.pipeline = graphicsPipeline;
+		draw.pipelineLayout = pipelineLayout;
+		draw.descriptorSet = mDescriptorSets[frame];
+		draw.vertexBuffer = mGeometryPool.getVertexBuffer();
+		draw.indexBuffer = mGeometryPool.getIndexBuffer();
+		draw.instanceBuffer = mInstanceBuffer.getBuffer(frame);
+		draw.indexCount = mesh.indexCount;
+		draw.firstIndex = mesh.firstIndex;
+		draw.vertexOffset = static_cast<int32_t>(mesh.firstVertex);
+		draw.firstInstance = mInstanceBuffer.add(pTransforms, count);
+		draw.instanceCount = count;
+
+		// The copies are placed by their own transforms, the draw itself isn't moved
+		draw.drawData.model = glm::mat4(1.0f);
+		draw.drawData.materialIndex = mTextureIndex;
+
+		float viewDepth = std::numeric_limits<float>::max();
+		for (uint32_t instance = 0; instance < count; ++instance) {
+			viewDepth = std::min(viewDepth, glm::length(glm::vec3(pTransforms[instance][3]) - CAMERA_POSITION));
+		}
 
-				// Bind the right descriptor set for each swap chain image to the descriptor in the shader
-				// We also specify that we bind this descriptor set to the graphics pipeline, as opposed to compute pipeline
-				vkCmdBindDescriptorSets(
-					commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &mDescriptorSets[i], 0, nullptr);
+		draw.sortKey = DrawList::makeSortKey(
+			0, 0, draw.drawData.materialIndex, DrawList::getDepthBucket(viewDepth, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE));
 
-				// Draw using the index buffer
-				vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(mMesh.getIndices().size()), 1, 0, 0, 0);
+		mDrawList.add(draw);
+	}
 
-			vkCmdEndRenderPass(commandBuffers[i]);
+	/**
+	 * Runs on the recording threads, each with its own secondary command buffer. Nothing is inherited
+	 *  from the primary, so every secondary binds what its draws use; mDrawList leaves out the binds
+	 *  that are the same as the previous draw's.
+	 */
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t lastDraw)
+	{
+		setViewportAndScissor(commandBuffer);
 
-			// End the recording of command buffer
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("[ERROR] Failed to end recording command buffer!");
-			}
+		// The texture table is bound once for the whole command buffer
+		if (mUseBindlessTextures) {
+			VkDescriptorSet textureTable = mBindlessTextures.getDescriptorSet();
+			vkCmdBindDescriptorSets(
+				commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureTable, 0, nullptr);
 		}
+
+		mDrawList.record(commandBuffer, firstDraw, lastDraw, mDrawData);
+	}
+
+	/**
+	 * The pipelines leave viewport and scissor dynamic, and secondaries don't inherit them from the
+	 *  primary, so every secondary that draws sets them to the whole swap chain image.
+	 */
+	void setViewportAndScissor(VkCommandBuffer commandBuffer)
+	{
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(swapChainExtent.width);
+		viewport.height = static_cast<float>(swapChainExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{};
+		scissor.offset = { 0, 0 };
+		scissor.extent = swapChainExtent;
+
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+
+	/**
+	 * The GPU driven counterpart of recordDraws: everything is bound once and the culling pass' output
+	 *  is drawn in one go. All instances share the geometry pool, the pipeline and the material.
+	 */
+	void recordIndirectDraws(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		setViewportAndScissor(commandBuffer);
+
+		mGeometryPool.bind(commandBuffer);
+
+		VkBuffer instanceBuffer = mInstanceBuffer.getBuffer(static_cast<uint32_t>(currentFrame));
+		VkDeviceSize instanceOffset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
+
+		VkDescriptorSet descriptorSet = mDescriptorSets[currentFrame];
+		vkCmdBindDescriptorSets(
+			commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+		PerDrawData drawData;
+		drawData.materialIndex = mTextureIndex;
+		mDrawData.record(commandBuffer, pipelineLayout, drawData);
+
+		if (mUseBindlessTextures) {
+			VkDescriptorSet textureTable = mBindlessTextures.getDescriptorSet();
+			vkCmdBindDescriptorSets(
+				commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureTable, 0, nullptr);
+		}
+
+		mGpuCuller.recordDraws(commandBuffer);
 	}
 
 	/**
 	 * Create semaphores for all the frames, each frame should have its own set of semaphores.
-	 * Also create fences for CPU-GPU synchronization.
+	 * CPU-GPU synchronization goes through mTimeline, a frame only remembers the value its submission signals.
+	 *  Value 0 is always complete, which is what the very first frame waits on.
 	 */
 	void createSyncObjects()
 	{
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-		imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+		mFrameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+		mImageTimelineValues.assign(swapChainImages.size(), 0);
 
 		VkSemaphoreCreateInfo semaphoreInfo{};
 		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		VkFenceCreateInfo fenceInfo{};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;	// Initialize the fence to signaled state for the very first frame to be drawn
-
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-				vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
 				throw std::runtime_error("[ERROR] Failed to create synchronization objects for a frame!");
 			}
 		}
 	}
 
-	void updateUniformBuffer(uint32_t currentImage)
+	void updateUniformBuffer(uint32_t frame)
 	{
-		static auto startTime = std::chrono::high_resolution_clock::now();
-
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float timeElasped = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
 		UniformBufferObject ubo{};
-		//ubo.model = glm::rotate(glm::mat4(1.0f), timeElasped * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.model = glm::mat4(1.0f);
-		ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f);
+		ubo.view = glm::lookAt(CAMERA_POSITION, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		ubo.proj = glm::perspective(
+			glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 
 		// glm was original made for OpenGL, where Y coordinate of the clip coordinates is inverted, we need to flip
 		//  this dimension for Vulkan
 		ubo.proj[1][1] *= -1; // We flip the sign on the scaling factor of the Y axis in the projection matrix
 
-		void *data;
-		vkMapMemory(device, mpUniformBuffers[currentImage]->getMemoryHandle(), 0, sizeof(ubo), 0, &data);
-			memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(device, mpUniformBuffers[currentImage]->getMemoryHandle());
+		mViewProjection = ubo.proj * ubo.view; // What the culling pass tests against
+
+		mpUniformBuffers[frame]->uploadData(&ubo, sizeof(ubo));
 	}
 
 	/**
@@ -1274,14 +1345,17 @@ private:
 	 * (3) Return the image to the swap chain for presentation
 	 *
 	 * Some sort of concurrency is implemented in this function, i.e. GPU-GPU synchronization is done with 2 semaphores,
-	 *  and CPU-GPU synchronization is done with fences.
+	 *  and CPU-GPU synchronization is done with values on mTimeline (a timeline semaphore, or fences without one).
 	 * This function now can also detect if the current swap chain is either suboptimal or out-of-date. In the case of
 	 *  the swap chain being out-of-date, the current swap chain will be cleaned up and a new swap chain is created.
 	 */
 	void drawFrame()
 	{
 		// Wait for the previous command buffer from previous frame to finish executing
-		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		mTimeline.wait(mFrameTimelineValues[currentFrame]);
+
+		// Whatever was only waiting on the GPU to be done with it, e.g. staging buffers
+		mTimeline.collectGarbage();
 
 		//============================ (1) Acquire an image from the swap chain =======================
 		uint32_t imageIndex;
@@ -1295,15 +1369,11 @@ private:
 			throw std::runtime_error("[ERROR] Failed to acquire swap chain image!");
 		}
 
-		// At this point, we know what swap chain we are going to use, so we are going to update ubo
-		updateUniformBuffer(imageIndex);
+		// The frame slot is free again, so is its ubo
+		updateUniformBuffer(static_cast<uint32_t>(currentFrame));
 
-		// Check if a previous frame is using this image, i.e. there is its fence to wait on
-		if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-			vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
-		}
-		// Mark the image as now being used by this frame
-		imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+		// Check if a previous frame is using this image, 0 if none ever did
+		mTimeline.wait(mImageTimelineValues[imageIndex]);
 
 		//=== (2) Execute the command buffer with acquired image as attachment in the framebuffer =====
 		VkSubmitInfo submitInfo{};
@@ -1314,18 +1384,18 @@ private:
 		submitInfo.waitSemaphoreCount = 1;		// Signal to wait for
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
+		VkCommandBuffer commandBuffer = recordCommandBuffer(imageIndex);
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+		submitInfo.pCommandBuffers = &commandBuffer;
 
 		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 		submitInfo.signalSemaphoreCount = 1;	// Semaphore to signal when command buffer(s) have finished execution
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		vkResetFences(device, 1, &inFlightFences[currentFrame]);	// Manually reset the fence to unsignaled state before using the fence
-
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-			throw std::runtime_error("[ERROR] Failed to submit draw command buffer!");
-		}
+		// Both this frame slot and the image are free again once the GPU reaches this value
+		uint64_t frameValue = mTimeline.submit(graphicsQueue, submitInfo);
+		mFrameTimelineValues[currentFrame] = frameValue;
+		mImageTimelineValues[imageIndex] = frameValue;
 
 		//=================== (3) Return the image to the swap chain for presentation =================
 		VkPresentInfoKHR presentInfo{};
@@ -1356,36 +1426,31 @@ private:
 
 	void cleanupSwapChain()
 	{
-		mDepthResources.cleanUp();
-
-		for (VkFramebuffer &framebuffer : swapChainFramebuffers) {
-			vkDestroyFramebuffer(device, framebuffer, nullptr);
-		}
+		mPipelineStates.waitIdle(); // Compiles still going may use the render pass
+		mRenderGraph.cleanUp(); // Render pass, framebuffers and the depth image
 
-		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		destroySwapChainImageViews();
 
-		vkDestroyPipeline(device, graphicsPipeline, nullptr);
-		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-		vkDestroyRenderPass(device, renderPass, nullptr);
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		swapChain = VK_NULL_HANDLE;
+	}
 
+	void destroySwapChainImageViews()
+	{
 		for (VkImageView &imageView : swapChainImageViews) {
 			vkDestroyImageView(device, imageView, nullptr);
 		}
-
-		vkDestroySwapchainKHR(device, swapChain, nullptr);
-
-		// We clean up uniform buffers here because it is dependent on the number of swap chain images
-		for (std::shared_ptr<VulkanBuffer> &pUniformBuffer : mpUniformBuffers) {
-			pUniformBuffer->cleanUp();
-		}
-
-		vkDestroyDescriptorPool(device, mDescriptorPool, nullptr);
 	}
 
 	/**
 	 * To handle when the window got resized, at which time the swap chain would be obsolete and incompatible
-	 *  with the new window surface. We must first know when the window size got changed, clean up current swap chain
-	 *  and recreate the swap chain.
+	 *  with the new window surface. We must first know when the window size got changed and recreate the swap
+	 *  chain, with the old one handed over to the new one.
+	 *
+	 * Only what depends on the size is recreated: the swap chain image views and the render graph's images
+	 *  and framebuffers. The pipeline sets viewport and scissor while recording, and uniform buffers and
+	 *  descriptor sets are per frame in flight. Should the surface format change, the render pass and with it
+	 *  the pipeline are recreated too.
 	 *
 	 * In the case of window minimization, the framebuffer size would become 0, we need to handle that as well by
 	 *  pausing the entire program until the window is in the foreground again.
@@ -1403,50 +1468,87 @@ private:
 
 		vkDeviceWaitIdle(device); // Wait to make sure that we don't use resources that may still be in use
 
-		cleanupSwapChain();
+		VkFormat oldFormat = swapChainImageFormat;
 
+		destroySwapChainImageViews();
 		createSwapChain();
+		mImageTimelineValues.assign(swapChainImages.size(), 0); // The image count may change, and the device is idle anyway
 		createImageViewsForSwapChain(); // Image views are based directly on the number of swap chain images
-		createRenderPass(); // Render pass is dependent on the format of swap chain image. However, it's rare that image format would change during window resize
 
-		createGraphicsPipeline(); // Viewport and scissor rectangle size are specified during graphics pipeline creation
-		createDepthResources();
-		createFramebuffers();
-		createUniformBuffers();
-		createDescriptorPool();
-		createDescriptorSets();
-		createCommandBuffers();
+		if (swapChainImageFormat == oldFormat) {
+			mRenderGraph.resize(swapChainExtent);
+			return;
+		}
+
+		// A new format makes the render pass incompatible, so the graph is declared again
+		mPipelineStates.waitIdle();
+		mRenderGraph.cleanUp();
+		createRenderGraph();
+		createGraphicsPipeline(); // Compiles in the background, frames only clear until it is done
 	}
 
 	void initVulkan()
 	{
+		mJobSystem.lazyInit(JOB_WORKER_THREADS);
+
 		createBaseApplication();
 
 		createSurface();
 		pickPhysicalDevice();
 		createLogicalDevice();
+		createPipelineCache();
+		createDescriptorAllocator();
+		createGpuCuller();
 
 		createSwapChain();
 		createImageViewsForSwapChain();
-		createRenderPass();
+		createRenderGraph();
+		loadSceneShaders();
 		createDescriptorSetLayout();
+		createBindlessTextures();
+		createPipelineLayout();
+
+		// Nothing is drawn yet, so the first compile may as well be waited for
+		auto pipelineStartTime = std::chrono::high_resolution_clock::now();
 
 		createGraphicsPipeline();
-		createDepthResources();
-		createFramebuffers();
+		mPipelineStates.wait(mScenePipelineKey);
+		mPipelineStates.setFallback(mScenePipelineKey); // Drawn with should a later scene pipeline fail to compile
+
+		double pipelineMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - pipelineStartTime).count();
+
+		std::cout << "[INFO] Graphics pipeline created in " << pipelineMilliseconds << " ms with a "
+			<< (mPipelineCache.isWarm() ? "warm" : "cold") << " pipeline cache" << std::endl;
+		std::cout << "[INFO] Rendering with "
+			<< (mRenderGraph.usesDynamicRendering() ? "dynamic rendering" : "render passes") << std::endl;
+		std::cout << "[INFO] Recording barriers with "
+			<< (mRenderGraph.usesSynchronization2() ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier") << std::endl;
 
 		createCommandPool();
+		createGeometryPool();
+
+		// Parsing the model is CPU only, it runs on a worker while this thread decodes and uploads the texture
+		JobCounter modelLoaded;
+		mJobSystem.run([this]() { loadModel(std::string(resource_dir) + "models/viking_room.obj"); }, &modelLoaded);
+
+		// The job counts down modelLoaded on this stack, so it has to be done before an exception can leave
+		try {
+			loadTexture(std::string(resource_dir) + "textures/viking_room.png");
+		} catch (...) {
+			mJobSystem.wait(modelLoaded);
+			throw;
+		}
 
-		loadTexture(std::string(resource_dir) + "textures/viking_room.png");
-		loadModel(std::string(resource_dir) + "models/viking_room.obj");
+		mJobSystem.wait(modelLoaded);
 
-		createVertexBuffer();
-		createIndexBuffer();
+		uploadMesh();
+		createInstances();
+		createInstanceBuffer();
 		createUniformBuffers();
-		createDescriptorPool();
 		createDescriptorSets();
 
-		createCommandBuffers();
+		createFrameRecorder();
 
 		createSyncObjects();
 	}
@@ -1460,26 +1562,64 @@ private:
 
 		// Wait for logical device to finish operations before cleanup
 		vkDeviceWaitIdle(device);
+
+		reportBarriers();
+	}
+
+	// What the render graph recorded per frame, to compare with USE_SYNCHRONIZATION2 off
+	void reportBarriers()
+	{
+		if (mRecordedFrames == 0) {
+			return;
+		}
+
+		BarrierBatcher const &barriers = mRenderGraph.getBarrierBatcher();
+		double frames = static_cast<double>(mRecordedFrames);
+
+		std::cout << "[INFO] " << barriers.getBarrierCount() / frames << " barriers in "
+			<< barriers.getCommandCount() / frames << " barrier commands per frame over "
+			<< mRecordedFrames << " frames" << std::endl;
 	}
 
 	void cleanup()
 	{
 		cleanupSwapChain();
 
+		for (std::shared_ptr<VulkanBuffer> &pUniformBuffer : mpUniformBuffers) {
+			pUniformBuffer->cleanUp();
+		}
+
+		mSceneDescriptorUpdate.cleanUp();
+		mDescriptorAllocator.cleanUp();	// Frees mDescriptorSets and the culling set
+
 		mTexture.cleanUp();
 
-		vkDestroyDescriptorSetLayout(device, mDescriptorSetLayout, nullptr);
+		if (mUseBindlessTextures) {
+			mBindlessTextures.cleanUp();
+		}
+
+		mGeometryPool.cleanUp();
+
+		if (mUseGpuCulling) {
+			mGpuCuller.cleanUp();
+		}
 
-		mpIndexBuffer->cleanUp();
-		mpVertexBuffer->cleanUp();
+		mInstanceBuffer.cleanUp();
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
 			vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-			vkDestroyFence(device, inFlightFences[i], nullptr);
 		}
 
-		vkDestroyCommandPool(device, commandPool, nullptr);
+		mFrameRecorder.cleanUp();
+
+		mSingleTimeCommands.cleanUp();
+		mTimeline.cleanUp();	// Also runs the deletions still queued on it
+		mPipelineStates.cleanUp();
+		mLayoutCache.cleanUp();	// Set layouts and pipeline layouts
+
+		mPipelineCache.save();
+		mPipelineCache.cleanUp();
 		vkDestroyDevice(device, nullptr);
 		vkDestroySurfaceKHR(instance, surface, nullptr);
 
@@ -1487,59 +1627,89 @@ private:
 
 		glfwDestroyWindow(window);
 		glfwTerminate();
+
+		mJobSystem.cleanUp();
 	}
 
 	GLFWwindow *window;
 
 	VulkanBaseApplication baseApp;
 	VkInstance instance;
+	uint32_t mInstanceApiVersion = VK_API_VERSION_1_0;
 
 	VkSurfaceKHR surface;	// Connect between Vulkan and window system
 
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;		// Logical device handle
 
+	VulkanDeviceFeatures mDeviceFeatures;	// Optional features of physicalDevice, decides which render paths are used
+
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;	// Handles of images in the swap chain
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 
-	VkRenderPass renderPass;
+	RenderGraph mRenderGraph;	// Owns the render pass, framebuffers and depth image, and transitions the swap chain image
+	uint32_t mSwapChainTarget = 0;	// The graph's handle for the acquired swap chain image
+	uint32_t mScenePass = 0;
+	uint64_t mRecordedFrames = 0;	// Times the graph was executed, for reportBarriers
+	VkRenderPass renderPass;	// mScenePass's render pass, VK_NULL_HANDLE with dynamic rendering
 
+	PipelineLayoutCache mLayoutCache;	// Owns mDescriptorSetLayout and pipelineLayout
 	VkDescriptorSetLayout mDescriptorSetLayout;
 	VkPipelineLayout pipelineLayout;
-	VkPipeline graphicsPipeline;
 
-	std::vector<VkFramebuffer> swapChainFramebuffers;
+	// The scene's SPIR-V and what it declares
+	std::vector<uint32_t> mSceneVertexShader;
+	std::vector<uint32_t> mSceneFragmentShader;
+	ShaderReflection mSceneReflection;
+	VulkanPipelineCache mPipelineCache;	// Saved to disk at shutdown, loaded at the next startup
+	PipelineStateCache mPipelineStates;	// Owns every pipeline
+	uint64_t mScenePipelineKey = 0;
+	VkPipeline graphicsPipeline = VK_NULL_HANDLE;	// This frame's scene pipeline, VK_NULL_HANDLE while it compiles
 
-	VkCommandPool commandPool;
-	std::vector<VkCommandBuffer> commandBuffers;
+	VulkanTimeline mTimeline;	// Every submission to graphicsQueue, frames and uploads alike
+	JobSystem mJobSystem;	// Worker threads for anything that can run off the main thread
+	SingleTimeCommandPool mSingleTimeCommands;	// Uploads and layout transitions
+	FrameCommandRecorder mFrameRecorder;	// Per frame in flight command pools, the frame is recorded anew each time
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;	// Signals an image has been acquired and ready for rendering
 	std::vector<VkSemaphore> renderFinishedSemaphores;	// Signals rendering has finished and presentation can happen
-	std::vector<VkFence> inFlightFences;				// To perform CPU-GPU synchronization
-	std::vector<VkFence> imagesInFlight;				// Keep track which swap chain image the frame in flight is using
+	std::vector<uint64_t> mFrameTimelineValues;		// Value on mTimeline each frame in flight waits for before reuse
+	std::vector<uint64_t> mImageTimelineValues;		// Same for the last frame that rendered to each swap chain image
 	size_t currentFrame = 0;	// Keeps track of current frame so that we use the correct semaphore objects
 
 	bool framebufferResized = false;
 
 	// There must be a better way for "delayed" initialization
-	std::shared_ptr<VulkanBuffer> mpVertexBuffer = nullptr;
-	std::shared_ptr<VulkanBuffer> mpIndexBuffer = nullptr;
 	std::vector<std::shared_ptr<VulkanBuffer>> mpUniformBuffers;	// Multiple uniform buffers
 
-	VkDescriptorPool mDescriptorPool;
+	DescriptorAllocator mDescriptorAllocator;	// Sets that live as long as the application
 	std::vector<VkDescriptorSet> mDescriptorSets;
+	DescriptorUpdateTemplate mSceneDescriptorUpdate;	// Writes mDescriptorSets from a SceneDescriptors
 
 	VulkanTexture mTexture;
 
-	VulkanDepthResources mDepthResources;
+	VulkanBindlessTextures mBindlessTextures;
+	uint32_t mTextureIndex = 0;	// Slot of mTexture in the bindless texture table
 
 	Mesh mMesh;
+	GeometryPool mGeometryPool;	// Vertices and indices of every mesh
+	MeshAllocation mMeshAllocation;	// Where mMesh is in mGeometryPool
+
+	DrawList mDrawList;	// This frame's draws, rebuilt and sorted every frame when not culling on the GPU
+
+	std::vector<GpuInstance> mInstances;	// Everything in the scene
+	GpuCuller mGpuCuller;
+	InstanceBuffer mInstanceBuffer;	// This frame's transforms, per-instance vertex data
+	PerDrawDataBinder mDrawData;
+	bool mUseGpuCulling = false;
+	bool mUseBindlessTextures = false;
+	glm::mat4 mViewProjection{ 1.0f };
 };
 
 int main()
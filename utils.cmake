@@ -11,6 +11,10 @@ function(setBuildProperties target)
 	setupVulkan(${target})
 	linkGLFW3(${target})
 
+	# The CPU mip generator splits its rows across std::threads
+	find_package(Threads REQUIRED)
+	target_link_libraries(${target} Threads::Threads)
+
 	# Can add different configurations for different operating systems. Here's the config for Windows
 	message(STATUS "Adding MSVC compiler flags suppressing warnings 4267 and 4250")
 	# Suppresses the compiler warning that is specified by nnnn
@@ -24,8 +28,6 @@ function(findVulkan)
 	if(NOT VULKAN_SDK AND NOT DEFINED ENV{VULKAN_SDK})
 		set(VULKAN_SDK "VULKAN_SDK-NOTFOUND")
 	endif()
-
-	# TODO: Add glsl compiler program
 endfunction(findVulkan)
 
 function(setupVulkan target)
@@ -175,4 +177,84 @@ function(_findGLFW3_sourcepkg target)
 	set(GLFW_INCLUDE_DIRS "${GLFW_DIR}/include" PARENT_SCOPE)
 
 	set(GLFW_FROM_SOURCE TRUE CACHE INTERNAL "Indicates that GLFW is being built from a source package" FORCE)
-endfunction(_findGLFW3_sourcepkg)
\ No newline at end of file
+endfunction(_findGLFW3_sourcepkg)
+
+# A CPU benchmark built from bench/<target>.cpp and the renderer sources it measures, see the
+# VULKAN_RENDERER_BENCHMARKS option. Doesn't need GLFW, or a GPU to run. With NULL_VULKAN it is built
+# against the Vulkan headers and links bench/NullVulkan.cpp in place of the loader.
+function(addBenchmark target)
+	cmake_parse_arguments(BENCHMARK "NULL_VULKAN" "" "" ${ARGN})
+
+	add_executable(${target} "${PROJECT_SOURCE_DIR}/bench/${target}.cpp" ${BENCHMARK_UNPARSED_ARGUMENTS})
+	target_include_directories(${target} PRIVATE "${PROJECT_SOURCE_DIR}/include")
+
+	if(BENCHMARK_NULL_VULKAN)
+		if(NOT DEFINED Vulkan_INCLUDE_DIR)
+			findVulkan()
+		endif()
+
+		target_sources(${target} PRIVATE "${PROJECT_SOURCE_DIR}/bench/NullVulkan.cpp")
+		target_include_directories(${target} PRIVATE ${Vulkan_INCLUDE_DIR})
+		linkGLM(${target})
+	endif()
+
+	find_package(Threads REQUIRED)
+	target_link_libraries(${target} Threads::Threads)
+endfunction(addBenchmark)
+
+# Compiles shaders in resources/shaders with glslangValidator at build time and embeds the SPIR-V in
+# the target, see ShaderLibrary. Each argument is "<source> <name of the .spv> [glslangValidator flags]",
+# the same shaders compile.bat builds. glslangValidator is required, the .spv files in resources/shaders
+# are only built by compile.bat, so without it the target would read whatever old ones are there.
+function(embedShaders target)
+	find_program(GLSLANG_VALIDATOR glslangValidator HINTS "$ENV{VULKAN_SDK}/bin" "$ENV{VULKAN_SDK}/Bin")
+
+	if(NOT GLSLANG_VALIDATOR)
+		message(FATAL_ERROR "glslangValidator could not be found. Install the Vulkan SDK, or turn off "
+			"VULKAN_RENDERER_EMBED_SHADERS and build the .spv files with resources/shaders/compile.bat.")
+	endif()
+
+	set(SHADER_DIR "${CMAKE_BINARY_DIR}/shaders")
+	file(MAKE_DIRECTORY "${SHADER_DIR}")
+
+	set(SHADER_HEADERS "")
+	set(SHADER_INCLUDES "")
+	set(SHADER_ENTRIES "")
+
+	foreach(SHADER ${ARGN})
+		separate_arguments(SHADER)
+		list(GET SHADER 0 SHADER_SOURCE)
+		list(GET SHADER 1 SHADER_NAME)
+		list(REMOVE_AT SHADER 0 1)
+
+		string(MAKE_C_IDENTIFIER "${SHADER_NAME}" SHADER_IDENTIFIER)
+		set(SHADER_SOURCE_PATH "${PROJECT_SOURCE_DIR}/resources/shaders/${SHADER_SOURCE}")
+		set(SHADER_SPV_PATH "${SHADER_DIR}/${SHADER_NAME}")
+		set(SHADER_HEADER_PATH "${SHADER_DIR}/${SHADER_IDENTIFIER}.h")
+
+		add_custom_command(
+			OUTPUT "${SHADER_HEADER_PATH}"
+			COMMAND "${GLSLANG_VALIDATOR}" -V --target-env vulkan1.0 ${SHADER} -o "${SHADER_SPV_PATH}" "${SHADER_SOURCE_PATH}"
+			COMMAND "${CMAKE_COMMAND}" "-DINPUT=${SHADER_SPV_PATH}" "-DOUTPUT=${SHADER_HEADER_PATH}" "-DNAME=${SHADER_IDENTIFIER}"
+				-P "${PROJECT_SOURCE_DIR}/embedSpirv.cmake"
+			DEPENDS "${SHADER_SOURCE_PATH}" "${PROJECT_SOURCE_DIR}/embedSpirv.cmake"
+			COMMENT "Compiling shader ${SHADER_NAME}"
+			VERBATIM
+		)
+
+		list(APPEND SHADER_HEADERS "${SHADER_HEADER_PATH}")
+		string(APPEND SHADER_INCLUDES "#include \"${SHADER_IDENTIFIER}.h\"\n")
+		string(APPEND SHADER_ENTRIES "\t{ \"${SHADER_NAME}\", ${SHADER_IDENTIFIER}, sizeof(${SHADER_IDENTIFIER}) / sizeof(uint32_t) },\n")
+	endforeach()
+
+	# Only replaced when the list changed, so configuring again doesn't rebuild ShaderLibrary.cpp
+	file(WRITE "${SHADER_DIR}/EmbeddedShaderTable.inc.in"
+		"// Generated by embedShaders in utils.cmake, do not edit\n${SHADER_INCLUDES}\nconst EmbeddedShader kEmbeddedShaders[] = {\n${SHADER_ENTRIES}};\n")
+	configure_file("${SHADER_DIR}/EmbeddedShaderTable.inc.in" "${SHADER_DIR}/EmbeddedShaderTable.inc" COPYONLY)
+
+	add_custom_target(${target}Shaders DEPENDS ${SHADER_HEADERS})
+	add_dependencies(${target} ${target}Shaders)
+
+	target_include_directories(${target} PRIVATE "${SHADER_DIR}")
+	target_compile_definitions(${target} PRIVATE VULKAN_RENDERER_EMBEDDED_SHADERS)
+endfunction(embedShaders)
\ No newline at end of file